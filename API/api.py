@@ -1,9 +1,14 @@
-from flask import Flask, request, jsonify
+from flask import Flask, request, jsonify, Response, stream_with_context, g
 import ctypes
 import os
+import atexit
+import json
+import threading
+import time
 from flask_restful import Api
 
 from test_sensor_data import sensor_array
+import wire_frame
 
 
 app = Flask(__name__)
@@ -19,6 +24,28 @@ class SensorResult(ctypes.Structure):
         ("Wavelength", ctypes.c_float)
     ]
 
+# Resultado de um canal na leitura em lote (struct SensorSample do sensor_bridge.c)
+class SensorSample(ctypes.Structure):
+    _fields_ = [
+        ("channel", ctypes.c_int32),
+        ("status", ctypes.c_int32),
+        ("timestamp_ns", ctypes.c_uint64),
+        ("raw_clear", ctypes.c_uint16),
+        ("raw_red", ctypes.c_uint16),
+        ("raw_green", ctypes.c_uint16),
+        ("raw_blue", ctypes.c_uint16),
+        ("conf", ctypes.c_uint16),
+        ("saturated", ctypes.c_uint16),
+        ("R", ctypes.c_float),
+        ("G", ctypes.c_float),
+        ("B", ctypes.c_float),
+        ("Intensity", ctypes.c_float),
+        ("Wavelength", ctypes.c_float)
+    ]
+
+BRIDGE_OK = 0
+BRIDGE_ERR_ISOLATED = -3
+
 #gcc -shared -o libsensors.dll test.c -m64, compilar o código em C com isto 
 #(feel free de compor o caminho e assim só é preciso haver um .so ou um .dll)
 #
@@ -27,18 +54,192 @@ class SensorResult(ctypes.Structure):
 
 
 HERE = os.path.dirname(os.path.abspath(__file__))
-lib_path = os.path.join(HERE, "..", "build", "sensor_bridge.so")
+# SENSOR_BRIDGE escolhe outra biblioteca, ex.: build/sensor_bridge_sim.so
+# ("make sim") para usar o barramento simulado (SENSOR_BUS=sim:)
+lib_path = os.environ.get("SENSOR_BRIDGE", os.path.join(HERE, "..", "build", "sensor_bridge.so"))
 lib = ctypes.CDLL(lib_path)
 
 # Define os tipos de entrada e saída da função C
 lib.get_sensor_readings.argtypes = [ctypes.c_int, ctypes.c_int]
 lib.get_sensor_readings.restype = SensorResult
 
+# Sessão persistente: o barramento I2C é aberto uma vez e mantido aberto
+lib.sensor_session_init.argtypes = [ctypes.c_char_p]
+lib.sensor_session_init.restype = ctypes.c_int
+lib.sensor_session_read.argtypes = [ctypes.c_int, ctypes.c_int]
+lib.sensor_session_read.restype = SensorResult
+lib.sensor_session_sweep.argtypes = [ctypes.c_uint, ctypes.c_int, ctypes.POINTER(SensorResult)]
+lib.sensor_session_sweep.restype = ctypes.c_int
+lib.sensor_set_auto_exposure.argtypes = [ctypes.c_int]
+lib.sensor_set_auto_exposure.restype = ctypes.c_int
+lib.sensor_set_retry.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int]
+lib.sensor_set_retry.restype = ctypes.c_int
+lib.sensor_session_shutdown.argtypes = []
+lib.sensor_session_shutdown.restype = None
+
+lib.sensor_ring_attach.argtypes = [ctypes.c_char_p]
+lib.sensor_ring_attach.restype = ctypes.c_int
+lib.sensor_ring_read.argtypes = [ctypes.c_uint, ctypes.c_int, ctypes.POINTER(SensorResult), ctypes.c_int]
+lib.sensor_ring_read.restype = ctypes.c_int
+lib.sensor_ring_next.argtypes = [ctypes.c_uint64, ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(SensorSample), ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_uint64)]
+lib.sensor_ring_next.restype = ctypes.c_int
+lib.sensor_encode_frame.argtypes = [ctypes.POINTER(SensorSample), ctypes.c_int, ctypes.c_uint64, ctypes.c_int, ctypes.c_void_p, ctypes.c_int]
+lib.sensor_encode_frame.restype = ctypes.c_int
+lib.sensor_read_batch.argtypes = [ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(SensorSample), ctypes.c_int, ctypes.c_int]
+lib.sensor_read_batch.restype = ctypes.c_int
+lib.sensor_read_batch_cached.argtypes = [ctypes.c_uint64, ctypes.c_int, ctypes.c_int, ctypes.POINTER(SensorSample), ctypes.c_int, ctypes.c_int]
+lib.sensor_read_batch_cached.restype = ctypes.c_int
+
+# Varrimentos assíncronos: start devolve logo um handle, o resultado é recolhido depois
+lib.sensor_sweep_start.argtypes = [ctypes.c_uint64, ctypes.c_int, ctypes.c_int, ctypes.c_void_p, ctypes.c_void_p]
+lib.sensor_sweep_start.restype = ctypes.c_int
+lib.sensor_sweep_poll.argtypes = [ctypes.c_int]
+lib.sensor_sweep_poll.restype = ctypes.c_int
+lib.sensor_sweep_complete.argtypes = [ctypes.c_int, ctypes.POINTER(SensorSample), ctypes.c_int]
+lib.sensor_sweep_complete.restype = ctypes.c_int
+lib.sensor_sweep_cancel.argtypes = [ctypes.c_int]
+lib.sensor_sweep_cancel.restype = ctypes.c_int
+
+# Métricas do processo: histogramas de latência (transações I2C, escritas nos
+# muxes, varrimentos) e contadores por sensor, mantidos pelo sensor_bridge
+lib.sensor_metrics_name.argtypes = [ctypes.c_int]
+lib.sensor_metrics_name.restype = ctypes.c_char_p
+lib.sensor_metrics_latency.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_double), ctypes.c_int, ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_double)]
+lib.sensor_metrics_latency.restype = ctypes.c_int
+lib.sensor_metrics_quantile.argtypes = [ctypes.c_int, ctypes.c_double]
+lib.sensor_metrics_quantile.restype = ctypes.c_double
+lib.sensor_metrics_channels.argtypes = [ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64), ctypes.c_int]
+lib.sensor_metrics_channels.restype = ctypes.c_int
+
+# tempo máximo à espera de uma frame do daemon (ex.: após mudar a sensibilidade)
+RING_TIMEOUT_MS = 3000
+# até 8 multiplexers (0x70..0x77) com 8 canais cada: o sensor n é o canal n % 8 do mux n // 8
+MAX_SENSORS = 64
+# AUTO_EXPOSURE=1 ajusta o tempo de integração e o ganho de cada sensor à luz
+# que recebe (com o daemon usar "acqd -a"); por omissão a configuração é fixa e
+# as contagens de leituras diferentes comparam-se diretamente
+AUTO_EXPOSURE = os.environ.get("AUTO_EXPOSURE", "0") != "0"
+# repetições de uma transação I2C falhada (com espera a dobrar a partir de
+# I2C_BACKOFF_US); um sensor que falha três varrimentos seguidos fica isolado
+# (status -3) até responder de novo
+I2C_RETRIES = int(os.environ.get("I2C_RETRIES", "2"))
+I2C_BACKOFF_US = int(os.environ.get("I2C_BACKOFF_US", "500"))
+# tempo máximo de cada transação (I2C_TIMEOUT do adaptador, partilhado com os
+# outros programas que usam o barramento); -1 deixa o valor do adaptador
+I2C_TIMEOUT_MS = int(os.environ.get("I2C_TIMEOUT_MS", "-1"))
+# idade máxima (ms) de uma leitura reaproveitada de outro pedido; um pedido pode
+# indicar "max_age_ms", e 0 obriga a ler o hardware
+MAX_AGE_MS = int(os.environ.get("MAX_AGE_MS", "100"))
+# /stream: taxa máxima de frames por cliente e número de clientes em simultâneo
+STREAM_MAX_HZ = float(os.environ.get("STREAM_MAX_HZ", "20"))
+STREAM_MAX_CLIENTS = int(os.environ.get("STREAM_MAX_CLIENTS", "16"))
+# sem frames durante este tempo envia-se um comentário para manter a ligação
+STREAM_KEEPALIVE_MS = 15000
+# um varrimento assíncrono não recolhido ao fim deste tempo é libertado no
+# próximo POST /sweeps (o bridge só tem 8 em simultâneo)
+SWEEP_TTL_S = float(os.environ.get("SWEEP_TTL_S", "60"))
+
+# limites (segundos) dos buckets dos histogramas exportados em /metrics
+LATENCY_BUCKETS = [0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005,
+                   0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                   0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0]
+LATENCY_QUANTILES = [0.5, 0.9, 0.99, 1.0]
+
+# Se o daemon de aquisição (build/acqd) estiver a correr, as leituras vêm da memória
+# partilhada e a API não acede ao barramento; caso contrário abre a sessão I2C.
+# Só no primeiro pedido e não no import: com debug=True o reloader importa o módulo
+# também no processo que vigia os ficheiros, que nunca serve pedidos
+use_ring = False
+session_started = False
+session_start_lock = threading.Lock()
+
+def start_session():
+    global use_ring, session_started
+    with session_start_lock:
+        if session_started:
+            return
+        lib.sensor_set_auto_exposure(1 if AUTO_EXPOSURE else 0)
+        lib.sensor_set_retry(I2C_RETRIES, I2C_BACKOFF_US, I2C_TIMEOUT_MS)
+        attached = lib.sensor_ring_attach(None)
+        use_ring = attached == 0
+        if use_ring:
+            print("A usar as frames do daemon de aquisição")
+        elif attached == -2:
+            # o daemon está a correr e é dono do barramento: não o abrir também
+            print("ERRO: o daemon de aquisição está a correr mas a sua memória partilhada não está "
+                  "acessível (o utilizador da API tem de pertencer ao grupo do acqd -g); "
+                  "as leituras vão falhar")
+        elif lib.sensor_session_init(None) != 0:
+            print("Aviso: não foi possível abrir o barramento I2C, nova tentativa no pedido seguinte")
+        atexit.register(lib.sensor_session_shutdown)
+        session_started = True
+
 #oque vai na mensagem do gui para o controlador
 class SensorRequest():
     sensors: list[int]
     sensitivity: int 
 
+def sensors_mask(sensors):
+    mask = 0
+    for i in range(min(len(sensors), MAX_SENSORS)):
+        if sensors[i]:
+            mask |= (1 << i)
+    return mask
+
+def build_sensor_list(sensors, results, n):
+    sensor_list=[]
+    by_channel = {results[k].channel: results[k] for k in range(max(n, 0))}
+
+    for i in range(min(len(sensors), MAX_SENSORS)):
+        
+        sensor = {"number" : i+1}
+
+        if sensors[i] and i in by_channel:
+            sensor_result = by_channel[i]
+
+            sensor["R"] = sensor_result.R
+            sensor["B"] = sensor_result.B
+            sensor["G"] = sensor_result.G
+            sensor["Intensity"] = sensor_result.Intensity
+            sensor["Wavelength"] = sensor_result.Wavelength
+            sensor["status"] = sensor_result.status
+            sensor["timestamp_ns"] = sensor_result.timestamp_ns
+            sensor["raw"] = {
+                "C" : sensor_result.raw_clear,
+                "R" : sensor_result.raw_red,
+                "G" : sensor_result.raw_green,
+                "B" : sensor_result.raw_blue
+            }
+            sensor["conf"] = sensor_result.conf
+            # tempo de integração e ganhos aplicados, para normalizar as contagens
+            sensor.update(wire_frame.decode_conf(sensor_result.conf))
+            sensor["saturated"] = bool(sensor_result.saturated)
+
+        else:
+            sensor["R"] = "-"
+            sensor["B"] = "-"
+            sensor["G"] = "-"
+            sensor["Intensity"] = "-"
+            sensor["Wavelength"] = "-"
+        
+        sensor_list.append(sensor)
+
+    return sensor_list
+
+# tamanho máximo de uma frame binária: cabeçalho + 64 sensores
+FRAME_MAX_SIZE = wire_frame.HEADER.size + MAX_SENSORS * wire_frame.RECORD.size
+
+def wants_binary():
+    # o cliente escolhe o formato binário com "Accept: application/x-veml-frame"
+    best = request.accept_mimetypes.best_match(["application/json", wire_frame.MIME_TYPE])
+    return best == wire_frame.MIME_TYPE
+
+def encode_frame(results, n, seq, sensitivity):
+    # frame binária (CONF + contagens C/R/G/B por sensor), ou None se o bridge não a suporta
+    buf = ctypes.create_string_buffer(FRAME_MAX_SIZE)
+    size = lib.sensor_encode_frame(results, max(n, 0), seq, sensitivity, buf, FRAME_MAX_SIZE)
+    return buf.raw[:size] if size >= 0 else None
+
 @app.post("/read_sensors")
 def read_sensors():
     
@@ -46,45 +247,272 @@ def read_sensors():
 
     sensors = data.get("sensors")
     sensitivity = data.get("sensitivity")
-    
-    sensor_list=[]
+    max_age_ms = int(data.get("max_age_ms", MAX_AGE_MS))
+
+    # ler todos os sensores selecionados numa única chamada (um só varrimento,
+    # ou a última frame do daemon se estiver a correr); os sensores lidos há
+    # menos de max_age_ms vêm da cache sem acesso ao barramento
+    results = (SensorSample * MAX_SENSORS)()
+    n = lib.sensor_read_batch_cached(sensors_mask(sensors), int(sensitivity), max_age_ms,
+                                     results, MAX_SENSORS, RING_TIMEOUT_MS)
 
     print(sensor_array)
-    for i in range(8):
-        
-        #inicializar o vetors
-        sen_data = [1,2,3,4,5]
+    if wants_binary():
+        frame = encode_frame(results, n, 0, int(sensitivity))
+        if frame is not None:
+            return Response(frame, mimetype=wire_frame.MIME_TYPE)
+    return jsonify(build_sensor_list(sensors, results, n))
 
-        if sensors[i]:
-            #ler os sensores
-            sensor_result=lib.get_sensor_readings(i,int(sensitivity))
+# sensores pedidos e instante de início de cada varrimento assíncrono, por handle
+pending_sweeps = {}
+pending_lock = threading.Lock()
 
-            sen_data[0] = sensor_result.R
-            sen_data[1] = sensor_result.G
-            sen_data[2] = sensor_result.B
-            sen_data[3] = sensor_result.Intensity
-            sen_data[4] = sensor_result.Wavelength
+def release_sweep(handle):
+    # devolve os sensores pedidos, ou None se o handle já não existe
+    with pending_lock:
+        entry = pending_sweeps.pop(handle, None)
+    return entry[0] if entry is not None else None
 
-        else:
-            sen_data[0]= "-"
-            sen_data[1]= "-"
-            sen_data[2]= "-"
-            sen_data[3]= "-"
-            sen_data[4]= "-"
-            
-        sensor = {
-        "number" : i+1,
-        "R" : sen_data[0],
-        "B" : sen_data[1],
-        "G" : sen_data[2],
-        "Intensity" : sen_data[3],
-        "Wavelength" : sen_data[4]
-        }
-        
-        sensor_list.append(sensor)
+def reap_sweeps():
+    # liberta os varrimentos que nenhum cliente veio buscar
+    now = time.monotonic()
+    with pending_lock:
+        expired = [h for h, (_, started) in pending_sweeps.items() if now - started > SWEEP_TTL_S]
+        for handle in expired:
+            del pending_sweeps[handle]
+    for handle in expired:
+        lib.sensor_sweep_cancel(handle)
 
-    
-    return jsonify(sensor_list)
+@app.post("/sweeps")
+def start_sweep():
+    # inicia o varrimento e responde logo, sem esperar pela integração dos sensores
+    reap_sweeps()
+    data = request.get_json()
+
+    sensors = data.get("sensors")
+    sensitivity = data.get("sensitivity")
+
+    handle = lib.sensor_sweep_start(sensors_mask(sensors), int(sensitivity), RING_TIMEOUT_MS, None, None)
+    if handle < 0:
+        return jsonify({"error": "too many sweeps in progress"}), 503
+
+    with pending_lock:
+        pending_sweeps[handle] = (sensors, time.monotonic())
+    return jsonify({"id": handle}), 202
+
+@app.get("/sweeps/<int:handle>")
+def get_sweep(handle):
+    # consulta e remoção sob o mesmo lock: um DELETE ou outro GET concorrente
+    # não pode libertar o handle entre as duas
+    with pending_lock:
+        entry = pending_sweeps.get(handle)
+        if entry is None:
+            return jsonify({"error": "unknown sweep"}), 404
+
+        state = lib.sensor_sweep_poll(handle)
+        if state == 0:
+            return jsonify({"id": handle, "state": "running"}), 202
+        del pending_sweeps[handle]
+
+    sensors = entry[0]
+    results = (SensorSample * MAX_SENSORS)()
+    n = lib.sensor_sweep_complete(handle, results, MAX_SENSORS) if state == 1 else -1
+    if n < 0:
+        # a biblioteca já não conhece o handle (libertado ou inválido)
+        return jsonify({"error": "sweep released"}), 410
+    if wants_binary():
+        frame = encode_frame(results, n, handle, -1)
+        if frame is not None:
+            return Response(frame, mimetype=wire_frame.MIME_TYPE)
+    return jsonify(build_sensor_list(sensors, results, n))
+
+@app.delete("/sweeps/<int:handle>")
+def cancel_sweep(handle):
+    # o cliente desistiu: liberta o handle (um varrimento a decorrer acaba sozinho)
+    if release_sweep(handle) is None:
+        return jsonify({"error": "unknown sweep"}), 404
+
+    lib.sensor_sweep_cancel(handle)
+    return "", 204
+
+# clientes ligados ao /stream
+stream_clients = 0
+stream_lock = threading.Lock()
+
+def stream_event(seq, sensors, results, n):
+    # só os sensores pedidos pelo cliente, cada frame é um evento SSE
+    selected = [s for s in build_sensor_list(sensors, results, n) if sensors[s["number"] - 1]]
+    payload = json.dumps({"seq": seq, "sensors": selected})
+    return f"id: {seq}\nevent: frame\ndata: {payload}\n\n"
+
+def ring_stream(mask, sensitivity, period, after_seq, event, keepalive):
+    # cada frame nova do daemon, no máximo uma por período (frames intermédias são saltadas)
+    results = (SensorSample * MAX_SENSORS)()
+    seq = ctypes.c_uint64(after_seq)
+    while True:
+        n = lib.sensor_ring_next(seq.value, mask, sensitivity, results, MAX_SENSORS,
+                                 STREAM_KEEPALIVE_MS, ctypes.byref(seq))
+        if n < 0:
+            return
+        if n == 0:
+            yield keepalive
+            continue
+
+        sent = time.monotonic()
+        yield event(seq.value, results, n)
+        time.sleep(max(0.0, period - (time.monotonic() - sent)))
+
+def session_stream(mask, sensitivity, period, event):
+    # sem daemon: um varrimento por período; clientes simultâneos partilham
+    # os varrimentos através da cache e do coalescing do sensor_bridge
+    results = (SensorSample * MAX_SENSORS)()
+    max_age_ms = int(period * 1000)
+    seq = 0
+    while True:
+        start = time.monotonic()
+        n = lib.sensor_read_batch_cached(mask, max(sensitivity, 0), max_age_ms,
+                                         results, MAX_SENSORS, RING_TIMEOUT_MS)
+        seq += 1
+        yield event(seq, results, n)
+        time.sleep(max(0.0, period - (time.monotonic() - start)))
+
+@app.get("/stream")
+def stream():
+    # Server-Sent Events: /stream?channels=1,2,5&max_hz=5&sensitivity=0
+    # channels usa a numeração "number" das respostas (1..64), por omissão todos;
+    # sem sensitivity segue a sensibilidade do daemon. Com "Accept: application/x-veml-frame"
+    # a resposta é uma sequência de frames binárias concatenadas (ver wire_frame.py)
+    global stream_clients
+
+    channels = request.args.get("channels")
+    try:
+        numbers = [int(c) for c in channels.split(",")] if channels else range(1, MAX_SENSORS + 1)
+        max_hz = min(float(request.args.get("max_hz", STREAM_MAX_HZ)), STREAM_MAX_HZ)
+        sensitivity = int(request.args.get("sensitivity", -1))
+        # um cliente que volta a ligar indica a última frame recebida
+        after_seq = int(request.headers.get("Last-Event-ID", "0") or 0)
+    except ValueError:
+        return jsonify({"error": "invalid stream parameters"}), 400
+
+    sensors = [0] * MAX_SENSORS
+    for number in numbers:
+        if 1 <= number <= MAX_SENSORS:
+            sensors[number - 1] = 1
+    mask = sensors_mask(sensors)
+    if mask == 0 or max_hz <= 0:
+        return jsonify({"error": "invalid stream parameters"}), 400
+
+    with stream_lock:
+        if stream_clients >= STREAM_MAX_CLIENTS:
+            return jsonify({"error": "too many streams"}), 503
+        stream_clients += 1
+
+    period = 1.0 / max_hz
+    binary = wants_binary()
+    if binary:
+        event = lambda seq, results, n: encode_frame(results, n, seq, sensitivity) or b""
+        keepalive = b""
+        mimetype = wire_frame.MIME_TYPE
+    else:
+        event = lambda seq, results, n: stream_event(seq, sensors, results, n)
+        keepalive = ": keepalive\n\n"
+        mimetype = "text/event-stream"
+
+    def generate():
+        global stream_clients
+        try:
+            if use_ring:
+                yield from ring_stream(mask, sensitivity, period, after_seq, event, keepalive)
+            else:
+                yield from session_stream(mask, sensitivity, period, event)
+        finally:
+            with stream_lock:
+                stream_clients -= 1
+
+    return Response(stream_with_context(generate()), mimetype=mimetype,
+                    headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"})
+
+# duração dos pedidos à API, por endpoint: [contagens por bucket, total, soma]
+request_latency = {}
+request_latency_lock = threading.Lock()
+
+@app.before_request
+def start_timer():
+    g.request_start = time.monotonic()
+    if not session_started:
+        start_session()
+
+@app.after_request
+def record_latency(response):
+    # nos /stream só conta até à primeira resposta
+    start = getattr(g, "request_start", None)
+    if start is not None and request.url_rule is not None:
+        elapsed = time.monotonic() - start
+        with request_latency_lock:
+            entry = request_latency.setdefault(request.url_rule.rule, [[0] * len(LATENCY_BUCKETS), 0, 0.0])
+            for k, bound in enumerate(LATENCY_BUCKETS):
+                if elapsed <= bound:
+                    entry[0][k] += 1
+            entry[1] += 1
+            entry[2] += elapsed
+    return response
+
+def histogram_lines(name, labels, cumulative, count, total):
+    lines = []
+    for bound, n in zip(LATENCY_BUCKETS, cumulative):
+        lines.append(f'{name}_bucket{{{labels},le="{bound:g}"}} {n}')
+    lines.append(f'{name}_bucket{{{labels},le="+Inf"}} {count}')
+    lines.append(f'{name}_sum{{{labels}}} {total:.9f}')
+    lines.append(f'{name}_count{{{labels}}} {count}')
+    return lines
+
+@app.get("/metrics")
+def metrics():
+    # formato de texto do Prometheus; com o daemon a correr as latências do
+    # barramento e os contadores por sensor ficam no processo do acqd
+    lines = ["# HELP veml_latency_seconds Latency of I2C transactions, mux writes and sensor sweeps",
+             "# TYPE veml_latency_seconds histogram"]
+    bounds = (ctypes.c_double * len(LATENCY_BUCKETS))(*LATENCY_BUCKETS)
+    cumulative = (ctypes.c_uint64 * len(LATENCY_BUCKETS))()
+    count = ctypes.c_uint64()
+    total = ctypes.c_double()
+    ops = []
+    metric = 0
+    while (name := lib.sensor_metrics_name(metric)) is not None:
+        if lib.sensor_metrics_latency(metric, bounds, len(LATENCY_BUCKETS), cumulative,
+                                      ctypes.byref(count), ctypes.byref(total)) == 0:
+            labels = f'op="{name.decode()}"'
+            lines += histogram_lines("veml_latency_seconds", labels, cumulative, count.value, total.value)
+            ops.append((metric, labels))
+        metric += 1
+
+    lines += ["# HELP veml_latency_quantile_seconds Latency quantiles (1.0 is the maximum)",
+              "# TYPE veml_latency_quantile_seconds gauge"]
+    for metric, labels in ops:
+        for q in LATENCY_QUANTILES:
+            lines.append(f'veml_latency_quantile_seconds{{{labels},quantile="{q:g}"}} '
+                         f'{lib.sensor_metrics_quantile(metric, q):.9f}')
+
+    # contadores por sensor, com a numeração "number" das respostas (1..64)
+    samples = (ctypes.c_uint64 * MAX_SENSORS)()
+    errors = (ctypes.c_uint64 * MAX_SENSORS)()
+    saturated = (ctypes.c_uint64 * MAX_SENSORS)()
+    n = lib.sensor_metrics_channels(samples, errors, saturated, MAX_SENSORS)
+    active = [i for i in range(max(n, 0)) if samples[i] or errors[i]]
+    for name, values, help_text in (("veml_sensor_samples_total", samples, "Successful sensor reads"),
+                                    ("veml_sensor_errors_total", errors, "Failed sensor reads"),
+                                    ("veml_sensor_saturated_total", saturated, "Sensor reads with a clipped channel")):
+        lines += [f"# HELP {name} {help_text}", f"# TYPE {name} counter"]
+        lines += [f'{name}{{sensor="{i + 1}"}} {values[i]}' for i in active]
+
+    lines += ["# HELP api_request_duration_seconds Time to answer an API request (streams: first response)",
+              "# TYPE api_request_duration_seconds histogram"]
+    with request_latency_lock:
+        for rule, (cumulative_api, count_api, total_api) in sorted(request_latency.items()):
+            lines += histogram_lines("api_request_duration_seconds", f'endpoint="{rule}"',
+                                     cumulative_api, count_api, total_api)
+
+    return Response("\n".join(lines) + "\n", mimetype="text/plain; version=0.0.4")
 
 @app.post('/')
 def home():    
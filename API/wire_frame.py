@@ -0,0 +1,93 @@
+# Descodificador do formato binário das frames (src/wire_frame.h)
+#
+# Cabeçalho de 56 bytes little-endian seguido de um registo por sensor
+# (CONF e contagens C, R, G, B em uint16), pela ordem dos índices dos sensores.
+# As frames delimitam-se a si próprias e podem vir concatenadas (ex.: /stream).
+import struct
+
+MIME_TYPE = "application/x-veml-frame"
+
+MAGIC = b"VMLF"
+VERSION = 1
+HEADER = struct.Struct("<4sBBHQQQQQIHH")
+RECORD = struct.Struct("<HHHHH")
+
+
+# campos do registo CONF do VEML3328 (src/veml3328.c): IT nos bits 5:4, ganho
+# nos bits 11:10 e ganho digital (DG) nos bits 13:12
+CONF_IT_MS = (50.0, 100.0, 200.0, 400.0)
+CONF_GAIN = (1.0, 2.0, 4.0, 0.5)
+CONF_DG = (1.0, 2.0, 4.0, 1.0)
+
+
+def decode_conf(conf):
+    # tempo de integração (ms), ganho e ganho digital com que a amostra foi tirada;
+    # as contagens são proporcionais a it_ms * gain * dg
+    return {
+        "it_ms": CONF_IT_MS[(conf >> 4) & 0x3],
+        "gain": CONF_GAIN[(conf >> 10) & 0x3],
+        "dg": CONF_DG[(conf >> 12) & 0x3],
+    }
+
+
+class FrameFormatError(ValueError):
+    pass
+
+
+def frame_size(buf, offset=0):
+    # tamanho da frame que começa em 'offset', ou None se o cabeçalho ainda não chegou
+    if len(buf) - offset < HEADER.size:
+        return None
+    header = HEADER.unpack_from(buf, offset)
+    if header[0] != MAGIC or header[1] != VERSION:
+        raise FrameFormatError("not a sensor frame")
+    header_size, channel_mask, record_size = header[3], header[7], header[10]
+    return header_size + bin(channel_mask).count("1") * record_size
+
+
+def decode(buf, offset=0):
+    # devolve (frame, bytes consumidos); frame["sensors"] tem um dict por sensor
+    size = frame_size(buf, offset)
+    if size is None or len(buf) - offset < size:
+        raise FrameFormatError("truncated frame")
+
+    (_, _, sensitivity, header_size, seq, timestamp_ns, wall_ns,
+     channel_mask, valid_mask, spread_ns, record_size, _) = HEADER.unpack_from(buf, offset)
+
+    sensors = []
+    pos = offset + header_size
+    for i in range(64):
+        if not channel_mask & (1 << i):
+            continue
+        conf, c, r, g, b = RECORD.unpack_from(buf, pos)
+        pos += record_size
+        sensors.append({
+            "number": i + 1,
+            "valid": bool(valid_mask & (1 << i)),
+            "conf": conf,
+            "raw": {"C": c, "R": r, "G": g, "B": b},
+        })
+
+    frame = {
+        "seq": seq,
+        "sensitivity": sensitivity,
+        "timestamp_ns": timestamp_ns,
+        "wall_ns": wall_ns,
+        "spread_ns": spread_ns,
+        "sensors": sensors,
+    }
+    return frame, size
+
+
+def decode_stream(chunks):
+    # frames concatenadas, recebidas em pedaços arbitrários (ex.: response.iter_content())
+    pending = b""
+    for chunk in chunks:
+        pending += chunk
+        while True:
+            size = frame_size(pending)
+            if size is None or len(pending) < size:
+                break
+            frame, _ = decode(pending)
+            pending = pending[size:]
+            yield frame
@@ -1,5 +1,5 @@
 import tkinter
-from tkinter import PhotoImage,Toplevel
+from tkinter import PhotoImage,Toplevel,messagebox
 from functools import partial
 from datetime import datetime
 import time
@@ -413,7 +413,7 @@ class MyGUI:
         self.hour_label.config(text = now.strftime("%H:%M:%S"))
 
         ip_raspberry = "10.54.117.64" 
-        url = f"http://{ip_raspberry}:5000/read_sensors"
+        url = f"http://{ip_raspberry}:5000/sweeps"
 
         data = {
             "sensors": self.sensor_states,
@@ -423,8 +423,21 @@ class MyGUI:
         self.waiting_window("the simulation \nis running ",url,data)
 
     def process_results(self,response, window_to_close):
-        if response.status_code == 200:
-            sensor_array = response.json()
+        # sem resposta, ou varrimento recusado/perdido (503, 404...): avisar e não mexer nos valores
+        if response is None or response.status_code != 200:
+            if response is None:
+                detail = "no answer from the Raspberry Pi"
+            else:
+                try:
+                    detail = response.json().get("error", response.reason)
+                except ValueError:
+                    detail = response.reason
+                detail = f"{response.status_code}: {detail}"
+            window_to_close.destroy()
+            messagebox.showerror("Simulation failed", detail)
+            return
+
+        sensor_array = response.json()
 
         self.error_flag = [0,0,0,0,0,0,0,0]
         
@@ -551,7 +564,18 @@ class MyGUI:
 
         def fazer_pedido():
         # Isto corre "ao lado" do programa principal
-            response = requests.post(url, json=data)
+            # inicia o varrimento e vai perguntando pelo resultado, assim nenhum
+            # pedido fica aberto na API enquanto os sensores integram
+            try:
+                response = requests.post(url, json=data)
+                if response.status_code == 202:
+                    sweep_url = f"{url}/{response.json()['id']}"
+                    response = requests.get(sweep_url)
+                    while response.status_code == 202:
+                        time.sleep(0.1)
+                        response = requests.get(sweep_url)
+            except requests.RequestException:
+                response = None
             self.window.after(0, self.process_results, response, new_window)
            
         # Cria e inicia a thread
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "veml3328.h"
+#include "tca9548a.h"
+#include "sweep.h"
+#include "acq_group.h"
+#include "shm_ring.h"
+#include "autoexp.h"
+#include "sample_timer.h"
+#include "recorder.h"
+
+#define I2C_DEV_PATH    "/dev/i2c-1"
+#define READ_MARGIN_NS  1000000ull      // read 1 ms after an integration cycle ends
+#define RETRY_BACKOFF_US 500            // first wait before retrying a failed transaction
+
+/* Same configuration as the API bridge, so frames are interchangeable */
+static const veml3328_cfg_t daemon_cfg = {
+    .gain_factor = 4.0f,
+    .dg_factor   = 2.0f,
+    .sens_factor = 0.0f,
+    .it_ms       = 400.0f,
+    .ds_it_ms    = 100.0f,
+    .dark_offset = 0
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int sig) {
+    (void)sig;
+    running = 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "USAGE: %s [-b bus]... [-t muxes]... [-m sensor_mask] [-s sensitivity 0|1] [-i it_ms] [-a] [-n shm_name] [-g group]\n"
+        "       [-r dir [-S segment_mb] [-k keep_segments]] [-R retries] [-T timeout_ms]\n"
+        "  Samples all selected sensors continuously and publishes every sweep\n"
+        "  into the shared memory ring (default %s), which the group given\n"
+        "  with -g (default %s) may read and post sensitivity requests to.\n"
+        "  -b may be repeated: every bus is swept in parallel by its own thread.\n"
+        "  muxes: comma separated addresses (e.g. 0x70,0x71) or \"auto\" (default 0x70);\n"
+        "  one -t for all buses or one per bus, in -b order.\n"
+        "  Sensors are numbered bus after bus; on each bus sensor n is channel\n"
+        "  n %% 8 of the (n / 8)-th mux.\n"
+        "  -a ranges integration time and gain per sensor (-i is then ignored);\n"
+        "  each frame records the CONF every sensor was read with.\n"
+        "  Sweeps start on a fixed period aligned to the sensors' integration\n"
+        "  cycle; each frame records its tick and wake-up delay.\n"
+        "  -r also appends every frame to a segmented log in dir (read it back\n"
+        "  with recdump); -k deletes the oldest segments beyond that count.\n"
+        "  -R retries a failed bus transaction (default 2, backoff from %d us);\n"
+        "  a sensor failing 3 sweeps in a row is left out and re-probed.\n"
+        "  -T sets the adapter timeout of i2c-dev buses (I2C_TIMEOUT, shared by\n"
+        "  every user of the adapter); by default it is left alone.\n",
+        prog, SHM_RING_NAME, SHM_RING_GROUP, RETRY_BACKOFF_US);
+}
+
+static uint64_t wall_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char *argv[]) {
+    const char *bus_paths[ACQ_MAX_BUSES];
+    const char *topo_specs[ACQ_MAX_BUSES];
+    int num_buses = 0;
+    int num_specs = 0;
+    const char *shm_name = SHM_RING_NAME;
+    const char *shm_group = SHM_RING_GROUP;
+    uint64_t mask = 0;                      // 0: every sensor of every bus
+    int sensitivity = 0;
+    float it_ms = daemon_cfg.it_ms;
+    int auto_exposure = 0;
+    const char *record_dir = NULL;
+    size_t segment_mb = 0;                  // 0: RECORDER_SEGMENT_SIZE
+    int keep_segments = 0;                  // 0: keep all
+    int retries = 2;
+    int timeout_ms = -1;                    // -1: leave the adapter timeout alone
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:m:s:i:an:g:r:S:k:R:T:h")) != -1) {
+        switch (opt) {
+            case 'b':
+                if (num_buses == ACQ_MAX_BUSES) {
+                    fprintf(stderr, "At most %d buses\n", ACQ_MAX_BUSES);
+                    return EXIT_FAILURE;
+                }
+                bus_paths[num_buses++] = optarg;
+                break;
+            case 't':
+                if (num_specs == ACQ_MAX_BUSES) {
+                    fprintf(stderr, "At most %d mux lists\n", ACQ_MAX_BUSES);
+                    return EXIT_FAILURE;
+                }
+                topo_specs[num_specs++] = optarg;
+                break;
+            case 'm': mask = strtoull(optarg, NULL, 0); break;
+            case 's': sensitivity = atoi(optarg) != 0; break;
+            case 'i': it_ms = (float)atof(optarg); break;
+            case 'a': auto_exposure = 1; break;
+            case 'n': shm_name = optarg; break;
+            case 'g': shm_group = optarg; break;
+            case 'r': record_dir = optarg; break;
+            case 'S': segment_mb = (size_t)strtoul(optarg, NULL, 0); break;
+            case 'k': keep_segments = atoi(optarg); break;
+            case 'R': retries = atoi(optarg); break;
+            case 'T': timeout_ms = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (num_buses == 0) {
+        bus_paths[num_buses++] = I2C_DEV_PATH;
+    }
+
+    if (it_ms <= 0.0f || retries < 0 || (num_specs > 1 && num_specs != num_buses)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* One worker per bus, all sweeping in step */
+    acq_group_t group;
+    int ret = acq_group_open(&group, bus_paths, num_buses, num_specs > 0 ? topo_specs : NULL, num_specs);
+    if (ret != ACQ_GROUP_OK) {
+        fprintf(stderr, "Failed to open the buses (%s)\n",
+                ret == ACQ_GROUP_ERR_INVALID ? "more than 64 sensors" : "bus or mux not found");
+        return EXIT_FAILURE;
+    }
+
+    if (mask == 0) {
+        mask = acq_group_all_sensors(&group);
+    }
+    if ((mask & ~acq_group_all_sensors(&group)) != 0) {
+        fprintf(stderr, "Sensor mask 0x%llx exceeds the %d sensors of the buses\n",
+                (unsigned long long)mask, group.num_sensors);
+        acq_group_close(&group);
+        return EXIT_FAILURE;
+    }
+
+    if (acq_group_set_retry(&group, retries, RETRY_BACKOFF_US, timeout_ms) != ACQ_GROUP_OK) {
+        fprintf(stderr, "Warning: cannot set the adapter timeout to %d ms\n", timeout_ms);
+    }
+
+    recorder_t rec;
+    if (record_dir != NULL && recorder_open(&rec, record_dir, segment_mb * 1024 * 1024, keep_segments) != RECORDER_OK) {
+        fprintf(stderr, "Cannot record into %s\n", record_dir);
+        acq_group_close(&group);
+        return EXIT_FAILURE;
+    }
+
+    shm_ring_t *ring = shm_ring_create(shm_name, shm_group);
+    if (ring == NULL) {
+        if (record_dir != NULL) {
+            recorder_close(&rec);
+        }
+        acq_group_close(&group);
+        return EXIT_FAILURE;
+    }
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    for (int b = 0; b < num_buses; b++) {
+        printf("Bus %s: sensors %d..%d\n", bus_paths[b], group.bus[b].first_sensor,
+               group.bus[b].first_sensor + group.bus[b].num_sensors - 1);
+    }
+    printf("Acquisition started on %d bus(es) (mask 0x%llx), publishing to %s\n",
+           num_buses, (unsigned long long)mask, shm_name);
+
+    veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+    autoexp_t ae;
+    autoexp_init(&ae, 0, 0);
+
+    sample_timer_t timer;
+    sample_timer_init(&timer, (uint64_t)(it_ms * 1000000.0f), 0);
+    uint64_t tick_ns = 0;                   // tick of the next frame, 0 before the first wait
+    int missed = 0;
+    uint64_t anchor_ns = 0;                 // integration cycle the timer is aligned to
+    uint64_t anchor_period_ns = 0;
+    uint64_t isolated = 0;
+
+    while (running) {
+        /* A consumer may ask for another sensitivity */
+        uint32_t request = atomic_load(&ring->sens_request);
+        if (request != SHM_RING_NO_REQUEST) {
+            sensitivity = (request != 0);
+        }
+
+        /* The period is the longest integration time in use */
+        uint64_t period_ns = 0;
+        for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+            veml3328_cfg_t base = daemon_cfg;
+            base.it_ms = it_ms;
+            base.sens_factor = (float)sensitivity;
+            if (auto_exposure) {
+                autoexp_cfg(&ae, i, &base, &cfg[i]);
+            } else {
+                cfg[i] = base;
+            }
+            veml3328_cfg_t applied;
+            veml3328_decode_cfg(veml3328_encode_cfg(&cfg[i]), base.ds_it_ms, base.dark_offset, &applied);
+            uint64_t cycle_ns = (uint64_t)(applied.it_ms * 1000000.0f);
+            if ((mask & (1ull << i)) && cycle_ns > period_ns) {
+                period_ns = cycle_ns;
+            }
+        }
+
+        acq_frame_t frame = {0};
+        frame.sensitivity = (uint8_t)sensitivity;
+        frame.tick_ns = tick_ns;
+        frame.late_ns = (tick_ns != 0) ? (uint32_t)timer.last_late_ns : 0;
+        frame.missed_ticks = (uint32_t)missed;
+
+        (void)acq_group_sweep(&group, mask, cfg, &frame, NULL);
+        frame.wall_ns = wall_now_ns();
+
+        uint64_t now_isolated = acq_group_isolated(&group) & mask;
+        if (now_isolated != isolated) {
+            fprintf(stderr, "Isolated sensors: 0x%llx\n", (unsigned long long)now_isolated);
+            isolated = now_isolated;
+        }
+        for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+            frame.conf[i] = veml3328_encode_cfg(&cfg[i]);
+            if (!auto_exposure) {
+                continue;
+            }
+            if (frame.valid_mask & (1ull << i)) {
+                (void)autoexp_update(&ae, i, &cfg[i], &frame.raw[i]);
+            } else if (mask & (1ull << i)) {
+                autoexp_lost(&ae, i);
+            }
+        }
+
+        shm_ring_publish(ring, &frame);
+        if (record_dir != NULL && recorder_append(&rec, &frame) != RECORDER_OK) {
+            fprintf(stderr, "Recording failed, continuing without it\n");
+            recorder_close(&rec);
+            record_dir = NULL;
+        }
+
+        /* One sweep per integration cycle, just after the sensors latch it.
+           A reconfiguration restarts the cycle, so re-anchor on it */
+        uint64_t ready_ns = acq_group_ready_ns(&group, mask);
+        if (ready_ns != anchor_ns || period_ns != anchor_period_ns) {
+            sample_timer_align(&timer, period_ns, ready_ns + READ_MARGIN_NS);
+            anchor_ns = ready_ns;
+            anchor_period_ns = period_ns;
+        }
+
+        missed = sample_timer_wait(&timer, &tick_ns);
+        if (missed < 0) {
+            fprintf(stderr, "Sampling timer failed (%d)\n", missed);
+            break;
+        }
+    }
+
+    printf("Acquisition stopped after %llu frames\n", (unsigned long long)shm_ring_head(ring));
+    printf("Timing: %llu ticks, %llu missed, late min %.1f / mean %.1f / max %.1f us, jitter %.1f us\n",
+           (unsigned long long)timer.stats.ticks, (unsigned long long)timer.stats.missed,
+           timer.stats.min_late_ns / 1000.0, timer.stats.mean_late_ns / 1000.0,
+           timer.stats.max_late_ns / 1000.0, sample_timer_jitter_ns(&timer.stats) / 1000.0);
+    sample_timer_close(&timer);
+
+    if (record_dir != NULL) {
+        printf("Recorded %llu frames in %llu segment(s) to %s\n", (unsigned long long)rec.frames,
+               (unsigned long long)rec.segments, record_dir);
+        recorder_close(&rec);
+    }
+
+    acq_group_close(&group);
+    shm_ring_close(ring);
+    shm_ring_unlink(shm_name);
+    return EXIT_SUCCESS;
+}
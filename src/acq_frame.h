@@ -0,0 +1,34 @@
+#ifndef ACQ_FRAME_H
+#define ACQ_FRAME_H
+
+#include <stdint.h>
+#include "veml3328.h"
+
+#define ACQ_MAX_CHANNELS 64                     // 8 muxes x 8 channels (topology.h)
+#define ACQ_MAX_BUSES    6                      // i2c-1, 3, 4, 5, 6 on a Pi 4
+
+/*
+ * One acquisition sweep: the raw counts of every sampled sensor plus the
+ * CONF value each sensor was integrating with, so consumers can normalize
+ * the counts without talking to the hardware. Entries are indexed by sensor:
+ * the sensors of the first bus (mux position * 8 + channel), then those of
+ * the next bus, and so on; bus_sensors gives the share of each bus.
+ */
+typedef struct {
+    uint64_t seq;                               // frame sequence number, starts at 1
+    uint64_t timestamp_ns;                      // CLOCK_MONOTONIC at harvest
+    uint64_t wall_ns;                           // CLOCK_REALTIME at harvest
+    uint64_t tick_ns;                           // scheduled sampling tick (CLOCK_MONOTONIC), 0 if unscheduled
+    uint64_t channel_mask;                      // sensors sampled
+    uint64_t valid_mask;                        // sensors read successfully
+    uint32_t spread_ns;                         // first to last sensor read of the sweep
+    uint32_t late_ns;                           // wake-up delay after tick_ns
+    uint32_t missed_ticks;                      // ticks skipped before this one (overrun)
+    uint8_t sensitivity;                        // 1 = low sensitivity (1/3)
+    uint8_t num_buses;
+    uint8_t bus_sensors[ACQ_MAX_BUSES];         // sensors per bus, in index order
+    uint16_t conf[ACQ_MAX_CHANNELS];            // CONF value per sensor
+    veml3328_raw_data_t raw[ACQ_MAX_CHANNELS];
+} acq_frame_t;
+
+#endif // ACQ_FRAME_H
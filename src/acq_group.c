@@ -0,0 +1,278 @@
+#include "acq_group.h"
+#include "i2c_driver_pi.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert(ACQ_MAX_BUSES <= I2C_MAX_BUSES, "every bus of a group needs a driver context");
+
+static uint64_t bus_mask(const acq_bus_t *bus, uint64_t mask) {
+    uint64_t local = mask >> bus->first_sensor;
+    if (bus->num_sensors < 64) {
+        local &= (1ull << bus->num_sensors) - 1;
+    }
+    return local;
+}
+
+/* One bus's share of the current sweep; runs unlocked */
+static void bus_sweep(acq_bus_t *bus, uint64_t mask, const veml3328_cfg_t *cfg,
+                      acq_frame_t *frame, uint64_t start_ns) {
+    sweep_sleep_until_ns(start_ns);
+
+    bus->done = 0;
+    (void)sweep_run_sensors(&bus->sweep, bus_mask(bus, mask),
+                            cfg + bus->first_sensor, frame->raw + bus->first_sensor,
+                            bus->read_ns, &bus->done);
+}
+
+static void *bus_worker(void *arg) {
+    acq_bus_t *bus = arg;
+    acq_group_t *group = bus->group;
+
+    uint64_t seen = 0;
+    pthread_mutex_lock(&group->lock);
+    for (;;) {
+        while (!group->stop && group->generation == seen) {
+            pthread_cond_wait(&group->start, &group->lock);
+        }
+        if (group->stop) {
+            break;
+        }
+        seen = group->generation;
+
+        uint64_t mask = group->mask;
+        const veml3328_cfg_t *cfg = group->cfg;
+        acq_frame_t *frame = group->frame;
+        uint64_t start_ns = group->start_ns;
+        pthread_mutex_unlock(&group->lock);
+
+        bus_sweep(bus, mask, cfg, frame, start_ns);
+
+        pthread_mutex_lock(&group->lock);
+        if (--group->pending == 0) {
+            pthread_cond_signal(&group->finished);
+        }
+    }
+    pthread_mutex_unlock(&group->lock);
+
+    return NULL;
+}
+
+/* Stop and join the first 'count' workers */
+static void stop_workers(acq_group_t *group, int count) {
+    pthread_mutex_lock(&group->lock);
+    group->stop = 1;
+    pthread_cond_broadcast(&group->start);
+    pthread_mutex_unlock(&group->lock);
+
+    for (int b = 0; b < count; b++) {
+        pthread_join(group->bus[b].thread, NULL);
+    }
+}
+
+static void close_buses(acq_group_t *group, int count) {
+    for (int b = 0; b < count; b++) {
+        (void)sweep_disable_all(&group->bus[b].sweep);
+        i2c_close_bus(group->bus[b].fd);
+    }
+}
+
+int acq_group_open(acq_group_t *group, const char *const *bus_paths, int num_buses,
+                   const char *const *mux_specs, int num_specs) {
+    if (group == NULL || bus_paths == NULL || num_buses < 1 || num_buses > ACQ_MAX_BUSES ||
+        (mux_specs != NULL && num_specs != 1 && num_specs != num_buses)) {
+        return ACQ_GROUP_ERR_INVALID;
+    }
+
+    memset(group, 0, sizeof(*group));
+
+    int opened = 0;
+    int ret = ACQ_GROUP_OK;
+    for (int b = 0; b < num_buses && ret == ACQ_GROUP_OK; b++) {
+        acq_bus_t *bus = &group->bus[b];
+        bus->group = group;
+        const char *spec = (mux_specs == NULL) ? NULL : mux_specs[num_specs == 1 ? 0 : b];
+
+        bus->fd = i2c_open_bus(bus_paths[b]);
+        if (bus->fd < 0) {
+            ret = ACQ_GROUP_ERR_BUS;
+            break;
+        }
+        opened++;
+
+        topo_t topo;
+        if (topo_from_spec(&topo, bus->fd, spec) != TOPO_OK) {
+            fprintf(stderr, "No mux topology '%s' on %s\n", spec != NULL ? spec : "0x70", bus_paths[b]);
+            ret = ACQ_GROUP_ERR_BUS;
+            break;
+        }
+
+        bus->first_sensor = group->num_sensors;
+        bus->num_sensors = topo_num_sensors(&topo);
+        if (group->num_sensors + bus->num_sensors > ACQ_MAX_CHANNELS) {
+            ret = ACQ_GROUP_ERR_INVALID;
+            break;
+        }
+        group->num_sensors += bus->num_sensors;
+        sweep_init_topology(&bus->sweep, bus->fd, &topo, VEML3328_I2C_ADDR);
+    }
+
+    if (ret != ACQ_GROUP_OK) {
+        close_buses(group, opened);
+        return ret;
+    }
+
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->start, NULL);
+    pthread_cond_init(&group->finished, NULL);
+    group->num_buses = num_buses;
+
+    /* A single bus is swept by the caller: no thread hand-off */
+    if (num_buses > 1) {
+        for (int b = 0; b < num_buses; b++) {
+            if (pthread_create(&group->bus[b].thread, NULL, bus_worker, &group->bus[b]) != 0) {
+                stop_workers(group, b);
+                close_buses(group, num_buses);
+                pthread_cond_destroy(&group->finished);
+                pthread_cond_destroy(&group->start);
+                pthread_mutex_destroy(&group->lock);
+                group->num_buses = 0;
+                return ACQ_GROUP_ERR_BUS;
+            }
+        }
+    }
+
+    return ACQ_GROUP_OK;
+}
+
+void acq_group_close(acq_group_t *group) {
+    if (group == NULL || group->num_buses == 0) {
+        return;
+    }
+
+    if (group->num_buses > 1) {
+        stop_workers(group, group->num_buses);
+    }
+
+    close_buses(group, group->num_buses);
+    pthread_cond_destroy(&group->finished);
+    pthread_cond_destroy(&group->start);
+    pthread_mutex_destroy(&group->lock);
+    group->num_buses = 0;
+    group->num_sensors = 0;
+}
+
+uint64_t acq_group_all_sensors(const acq_group_t *group) {
+    if (group == NULL || group->num_sensors == 0) {
+        return 0;
+    }
+    if (group->num_sensors >= 64) {
+        return ~0ull;
+    }
+
+    return (1ull << group->num_sensors) - 1;
+}
+
+uint64_t acq_group_ready_ns(const acq_group_t *group, uint64_t mask) {
+    if (group == NULL) {
+        return 0;
+    }
+
+    uint64_t ready_ns = 0;
+    for (int b = 0; b < group->num_buses; b++) {
+        uint64_t t = sweep_ready_ns(&group->bus[b].sweep, bus_mask(&group->bus[b], mask));
+        if (t > ready_ns) {
+            ready_ns = t;
+        }
+    }
+    return ready_ns;
+}
+
+int acq_group_set_retry(acq_group_t *group, int retries, uint32_t backoff_us, int timeout_ms) {
+    if (group == NULL || retries < 0) {
+        return ACQ_GROUP_ERR_INVALID;
+    }
+
+    int ret = ACQ_GROUP_OK;
+    for (int b = 0; b < group->num_buses; b++) {
+        if (i2c_bus_set_retry(group->bus[b].fd, retries, backoff_us) < 0 ||
+            i2c_bus_set_limits(group->bus[b].fd, timeout_ms, -1) < 0) {
+            ret = ACQ_GROUP_ERR_BUS;
+        }
+    }
+    return ret;
+}
+
+uint64_t acq_group_isolated(const acq_group_t *group) {
+    if (group == NULL) {
+        return 0;
+    }
+
+    uint64_t isolated = 0;
+    for (int b = 0; b < group->num_buses; b++) {
+        isolated |= group->bus[b].sweep.tripped << group->bus[b].first_sensor;
+    }
+    return isolated;
+}
+
+int acq_group_sweep(acq_group_t *group, uint64_t mask, const veml3328_cfg_t cfg[SWEEP_MAX_SENSORS],
+                    acq_frame_t *frame, uint64_t read_ns[SWEEP_MAX_SENSORS]) {
+    if (group == NULL || cfg == NULL || frame == NULL || group->num_buses == 0) {
+        return ACQ_GROUP_ERR_INVALID;
+    }
+
+    mask &= acq_group_all_sensors(group);
+    uint64_t start_ns = sweep_now_ns();
+
+    if (group->num_buses == 1) {
+        bus_sweep(&group->bus[0], mask, cfg, frame, start_ns);
+    } else {
+        start_ns += ACQ_GROUP_ALIGN_NS;
+
+        pthread_mutex_lock(&group->lock);
+        group->mask = mask;
+        group->cfg = cfg;
+        group->frame = frame;
+        group->start_ns = start_ns;
+        group->pending = group->num_buses;
+        group->generation++;
+        pthread_cond_broadcast(&group->start);
+        while (group->pending > 0) {
+            pthread_cond_wait(&group->finished, &group->lock);
+        }
+        pthread_mutex_unlock(&group->lock);
+    }
+
+    /* Merge: bus-local results into frame indices */
+    uint64_t first_ns = UINT64_MAX;
+    uint64_t last_ns = 0;
+    frame->channel_mask = mask;
+    frame->valid_mask = 0;
+    frame->num_buses = (uint8_t)group->num_buses;
+    for (int b = 0; b < group->num_buses; b++) {
+        const acq_bus_t *bus = &group->bus[b];
+        frame->bus_sensors[b] = (uint8_t)bus->num_sensors;
+        frame->valid_mask |= bus->done << bus->first_sensor;
+
+        for (int i = 0; i < bus->num_sensors; i++) {
+            if (!(bus->done & (1ull << i))) {
+                continue;
+            }
+            uint64_t t = bus->read_ns[i];
+            if (t < first_ns) {
+                first_ns = t;
+            }
+            if (t > last_ns) {
+                last_ns = t;
+            }
+            if (read_ns != NULL) {
+                read_ns[bus->first_sensor + i] = t;
+            }
+        }
+    }
+
+    frame->timestamp_ns = (last_ns != 0) ? last_ns : sweep_now_ns();
+    frame->spread_ns = (last_ns >= first_ns) ? (uint32_t)(last_ns - first_ns) : 0;
+    return ACQ_GROUP_OK;
+}
@@ -0,0 +1,96 @@
+#ifndef ACQ_GROUP_H
+#define ACQ_GROUP_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "acq_frame.h"
+#include "sweep.h"
+#include "topology.h"
+
+/* Error codes */
+#define ACQ_GROUP_OK             0
+#define ACQ_GROUP_ERR_BUS       -1      // a bus failed to open or has no mux
+#define ACQ_GROUP_ERR_INVALID   -2      // bad arguments or more than 64 sensors
+
+/* Workers start their sweeps together at now + this lead, so a wake-up
+   delay of one thread does not skew its bus against the others */
+#define ACQ_GROUP_ALIGN_NS      200000ull
+
+struct acq_group;
+
+/* One bus of the group and the worker thread sweeping it */
+typedef struct {
+    struct acq_group *group;
+    int fd;
+    sweep_ctx_t sweep;
+    int first_sensor;                   // frame index of this bus's sensor 0
+    int num_sensors;
+    pthread_t thread;
+    uint64_t done;                      // sensors read in the last sweep (bus-local bits)
+    uint64_t read_ns[SWEEP_MAX_SENSORS];
+} acq_bus_t;
+
+/*
+ * Buses sampled in parallel, one worker thread per bus (a single bus is
+ * swept by the calling thread). Every sweep of the group starts on all buses
+ * at the same instant and the results merge into one acq_frame_t, so the
+ * sensor count can grow with the number of buses instead of being limited
+ * by the bandwidth of one.
+ */
+typedef struct acq_group {
+    int num_buses;
+    int num_sensors;
+    acq_bus_t bus[ACQ_MAX_BUSES];
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;               // a new sweep was posted
+    pthread_cond_t finished;            // a worker finished its part
+    uint64_t generation;                // sweeps posted so far
+    int pending;                        // workers still sweeping
+    int stop;
+
+    /* Current sweep, valid while pending > 0 */
+    uint64_t mask;
+    const veml3328_cfg_t *cfg;
+    acq_frame_t *frame;
+    uint64_t start_ns;
+} acq_group_t;
+
+/*
+ * Open 'num_buses' buses. mux_specs[i] is the topology of bus i (see
+ * topo_from_spec); with num_specs == 1 the same spec applies to every bus,
+ * and mux_specs may be NULL for the default single mux. More than
+ * ACQ_MAX_BUSES buses is ACQ_GROUP_ERR_INVALID.
+ */
+int acq_group_open(acq_group_t *group, const char *const *bus_paths, int num_buses,
+                   const char *const *mux_specs, int num_specs);
+
+/* Stop the workers, disable every mux and close the buses */
+void acq_group_close(acq_group_t *group);
+
+/*
+ * Sweep the sensors in 'mask' on all buses at once. cfg is indexed by frame
+ * sensor index. Fills frame->raw, valid_mask, channel_mask, timestamp_ns,
+ * spread_ns and the bus layout; read_ns (optional) receives the read time of
+ * each sensor. Returns ACQ_GROUP_OK or ACQ_GROUP_ERR_INVALID.
+ */
+int acq_group_sweep(acq_group_t *group, uint64_t mask, const veml3328_cfg_t cfg[SWEEP_MAX_SENSORS],
+                    acq_frame_t *frame, uint64_t read_ns[SWEEP_MAX_SENSORS]);
+
+/* Latest sweep_ready_ns() of the sensors in 'mask' across the buses */
+uint64_t acq_group_ready_ns(const acq_group_t *group, uint64_t mask);
+
+/* Per-transaction retries with backoff and the adapter timeout (negative:
+   leave the adapter alone, as it is shared with other users of the bus) on
+   every bus; see i2c_bus_set_retry and i2c_bus_set_limits.
+   Call between sweeps. Returns ACQ_GROUP_OK, ACQ_GROUP_ERR_INVALID for
+   negative 'retries', or ACQ_GROUP_ERR_BUS if a bus refused a setting. */
+int acq_group_set_retry(acq_group_t *group, int retries, uint32_t backoff_us, int timeout_ms);
+
+/* Sensors isolated by the circuit breaker of their bus (frame indices) */
+uint64_t acq_group_isolated(const acq_group_t *group);
+
+/* Mask of every sensor of every bus */
+uint64_t acq_group_all_sensors(const acq_group_t *group);
+
+#endif // ACQ_GROUP_H
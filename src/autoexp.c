@@ -0,0 +1,160 @@
+#include "autoexp.h"
+
+#include <stddef.h>
+
+typedef struct {
+    float it_ms;
+    float gain;
+    float dg;
+} autoexp_step_t;
+
+/* Shortest integration time first; within one, most responsive first. Digital
+   gain only extends 4x analog gain since it amplifies the noise as well */
+static const autoexp_step_t ladder[] = {
+    {  50.0f, 4.0f, 4.0f }, {  50.0f, 4.0f, 2.0f }, {  50.0f, 4.0f, 1.0f },
+    {  50.0f, 2.0f, 1.0f }, {  50.0f, 1.0f, 1.0f }, {  50.0f, 0.5f, 1.0f },
+    { 100.0f, 4.0f, 4.0f }, { 100.0f, 4.0f, 2.0f }, { 100.0f, 4.0f, 1.0f },
+    { 100.0f, 2.0f, 1.0f }, { 100.0f, 1.0f, 1.0f }, { 100.0f, 0.5f, 1.0f },
+    { 200.0f, 4.0f, 4.0f }, { 200.0f, 4.0f, 2.0f }, { 200.0f, 4.0f, 1.0f },
+    { 200.0f, 2.0f, 1.0f }, { 200.0f, 1.0f, 1.0f }, { 200.0f, 0.5f, 1.0f },
+    { 400.0f, 4.0f, 4.0f }, { 400.0f, 4.0f, 2.0f }, { 400.0f, 4.0f, 1.0f },
+    { 400.0f, 2.0f, 1.0f }, { 400.0f, 1.0f, 1.0f }, { 400.0f, 0.5f, 1.0f },
+};
+
+#define NUM_STEPS       ((int)(sizeof(ladder) / sizeof(ladder[0])))
+#define INITIAL_STEP    2           // 50 ms, 4x: short, and mid-range responsivity
+
+/* A clipped sample only bounds the light from below: assume this much more */
+#define SATURATION_STEP 4.0f
+
+static void step_cfg(int step, const veml3328_cfg_t *base, veml3328_cfg_t *out) {
+    *out = *base;
+    out->it_ms = ladder[step].it_ms;
+    out->gain_factor = ladder[step].gain;
+    out->dg_factor = ladder[step].dg;
+}
+
+/* First step whose predicted peak (rate x exposure) lies in the narrowed window */
+static int select_step(const autoexp_t *ae, float rate, const veml3328_cfg_t *base) {
+    float low = ae->low * AUTOEXP_HYSTERESIS;
+    float high = ae->high / AUTOEXP_HYSTERESIS;
+
+    int min_step = 0;
+    int max_step = 0;
+    float min_e = 0.0f;
+    float max_e = 0.0f;
+    for (int i = 0; i < NUM_STEPS; i++) {
+        veml3328_cfg_t cfg;
+        step_cfg(i, base, &cfg);
+        float e = veml3328_cfg_exposure(&cfg);
+        float predicted = rate * e;
+        if (predicted >= low && predicted <= high) {
+            return i;
+        }
+
+        if (i == 0 || e < min_e) {
+            min_e = e;
+            min_step = i;
+        }
+        if (i == 0 || e > max_e) {
+            max_e = e;
+            max_step = i;
+        }
+    }
+
+    /* Out of range: as close as the sensor gets */
+    return (rate * max_e < low) ? max_step : min_step;
+}
+
+static uint16_t peak_counts(const veml3328_raw_data_t *raw) {
+    uint16_t peak = raw->clear;
+    if (raw->red > peak) {
+        peak = raw->red;
+    }
+    if (raw->green > peak) {
+        peak = raw->green;
+    }
+    if (raw->blue > peak) {
+        peak = raw->blue;
+    }
+    return peak;
+}
+
+void autoexp_init(autoexp_t *ae, uint16_t low, uint16_t high) {
+    if (ae == NULL) {
+        return;
+    }
+
+    ae->low = (low != 0) ? low : AUTOEXP_DEFAULT_LOW;
+    ae->high = (high != 0) ? high : AUTOEXP_DEFAULT_HIGH;
+    for (int i = 0; i < AUTOEXP_MAX_SENSORS; i++) {
+        ae->sensor[i].step = INITIAL_STEP;
+        ae->sensor[i].good_step = INITIAL_STEP;
+        ae->sensor[i].has_good = 0;
+        ae->sensor[i].saturated = 0;
+    }
+}
+
+int autoexp_num_steps(void) {
+    return NUM_STEPS;
+}
+
+void autoexp_cfg(const autoexp_t *ae, int sensor, const veml3328_cfg_t *base, veml3328_cfg_t *out) {
+    if (ae == NULL || base == NULL || out == NULL) {
+        return;
+    }
+    if (sensor < 0 || sensor >= AUTOEXP_MAX_SENSORS) {
+        *out = *base;
+        return;
+    }
+
+    step_cfg(ae->sensor[sensor].step, base, out);
+}
+
+int autoexp_update(autoexp_t *ae, int sensor, const veml3328_cfg_t *used,
+                   const veml3328_raw_data_t *raw) {
+    if (ae == NULL || used == NULL || raw == NULL || sensor < 0 || sensor >= AUTOEXP_MAX_SENSORS) {
+        return -1;
+    }
+
+    float exposure = veml3328_cfg_exposure(used);
+    if (exposure <= 0.0f) {
+        return -1;
+    }
+
+    autoexp_sensor_t *s = &ae->sensor[sensor];
+    uint16_t peak = peak_counts(raw);
+
+    s->saturated = (peak >= AUTOEXP_SATURATION);
+    if (s->saturated) {
+        s->step = (uint8_t)select_step(ae, SATURATION_STEP * peak / exposure, used);
+        return 0;
+    }
+
+    /* Counts per unit of exposure; a dark reading still has to move up */
+    float rate = (peak > 0 ? peak : 1) / exposure;
+    int next = select_step(ae, rate, used);
+
+    if (peak < ae->low || peak > ae->high) {
+        s->step = (uint8_t)next;
+        return 0;
+    }
+
+    /* In the window: only move for a shorter integration time */
+    s->good_step = s->step;
+    s->has_good = 1;
+    if (ladder[next].it_ms < used->it_ms) {
+        s->step = (uint8_t)next;
+    }
+    return 1;
+}
+
+void autoexp_lost(autoexp_t *ae, int sensor) {
+    if (ae == NULL || sensor < 0 || sensor >= AUTOEXP_MAX_SENSORS) {
+        return;
+    }
+
+    if (ae->sensor[sensor].has_good) {
+        ae->sensor[sensor].step = ae->sensor[sensor].good_step;
+    }
+}
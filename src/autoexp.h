@@ -0,0 +1,67 @@
+#ifndef AUTOEXP_H
+#define AUTOEXP_H
+
+#include <stdint.h>
+#include "veml3328.h"
+
+/*
+ * Per-sensor auto-ranging of integration time and gain.
+ *
+ * Settings come from a fixed ladder ordered by integration time (shortest
+ * first) and, within one integration time, by decreasing responsivity with
+ * analog gain preferred over digital gain. After every sample the controller
+ * estimates the light level from the largest of C/R/G/B and moves to the
+ * first ladder step predicted to land inside the target window, i.e. the
+ * shortest integration time and the highest gain that neither saturates nor
+ * wastes resolution. The last step that gave an in-window sample is kept per
+ * sensor, so a sensor that was lost (read error) resumes from it.
+ *
+ * Only integration time, gain and digital gain are ranged: sensitivity,
+ * ds_it_ms and dark_offset are taken from the caller's base configuration.
+ */
+
+#define AUTOEXP_MAX_SENSORS     64
+#define AUTOEXP_SATURATION      0xFFFF      // a channel at this count is clipped
+
+/* Default target window for the largest channel, in counts */
+#define AUTOEXP_DEFAULT_LOW     4000
+#define AUTOEXP_DEFAULT_HIGH    50000
+
+/* A new step must be predicted inside the window narrowed by this factor on
+   both sides; the current step is kept while it stays in the full window */
+#define AUTOEXP_HYSTERESIS      1.25f
+
+typedef struct {
+    uint8_t step;               // ladder step of the next sample
+    uint8_t good_step;          // last step that produced an in-window sample
+    uint8_t has_good;
+    uint8_t saturated;          // last sample was clipped
+} autoexp_sensor_t;
+
+typedef struct {
+    uint16_t low;
+    uint16_t high;
+    autoexp_sensor_t sensor[AUTOEXP_MAX_SENSORS];
+} autoexp_t;
+
+/* Start every sensor at the initial step; low/high 0 take the defaults */
+void autoexp_init(autoexp_t *ae, uint16_t low, uint16_t high);
+
+/* Number of steps in the ladder */
+int autoexp_num_steps(void);
+
+/* Configuration of 'sensor' for its next sample */
+void autoexp_cfg(const autoexp_t *ae, int sensor, const veml3328_cfg_t *base, veml3328_cfg_t *out);
+
+/*
+ * Feed a sample of 'sensor' taken with 'used' and choose the next step.
+ * Returns 1 if the sample was inside the window, 0 if it was clipped or
+ * outside it (still valid unless clipped), -1 on bad arguments.
+ */
+int autoexp_update(autoexp_t *ae, int sensor, const veml3328_cfg_t *used,
+                   const veml3328_raw_data_t *raw);
+
+/* A read of 'sensor' failed: fall back to its last good step */
+void autoexp_lost(autoexp_t *ae, int sensor);
+
+#endif // AUTOEXP_H
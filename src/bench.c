@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "i2c_driver_pi.h"
+#include "veml3328.h"
+#include "tca9548a.h"
+#include "sweep.h"
+#include "topology.h"
+
+#define I2C_DEV_PATH        "/dev/i2c-1"
+#define DEFAULT_ITERATIONS  1000
+#define DEFAULT_SWEEPS      200
+#define VEML3328_REG_ID     0x0C
+
+/* Percentile summary of one measured operation, in ns */
+typedef struct {
+    const char *name;
+    int count;
+    int errors;
+    uint64_t min;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+    double mean;
+} bench_result_t;
+
+static const veml3328_cfg_t bench_cfg = {
+    .gain_factor = 1.0f,
+    .dg_factor   = 1.0f,
+    .sens_factor = 0.0f,
+    .it_ms       = 50.0f,
+    .ds_it_ms    = 100.0f,
+    .dark_offset = 0
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "USAGE: %s [-b bus] [-t muxes] [-n iterations] [-w sweeps] [-i it_ms] [-o file]\n"
+        "  Measures the latency of single bus transactions and of full sweeps on\n"
+        "  a real bus (default %s) or a simulated one (sim:...), and prints\n"
+        "  percentiles. -o appends the run as one JSON line to 'file' for\n"
+        "  regression tracking.\n",
+        prog, I2C_DEV_PATH);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static uint64_t percentile(const uint64_t *sorted, int n, double p) {
+    int rank = (int)(p * n + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > n) {
+        rank = n;
+    }
+    return sorted[rank - 1];
+}
+
+static void summarize(bench_result_t *res, const char *name, uint64_t *samples, int n, int errors) {
+    memset(res, 0, sizeof(*res));
+    res->name = name;
+    res->count = n;
+    res->errors = errors;
+    if (n == 0) {
+        return;
+    }
+
+    qsort(samples, (size_t)n, sizeof(samples[0]), compare_u64);
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += (double)samples[i];
+    }
+
+    res->min = samples[0];
+    res->p50 = percentile(samples, n, 0.50);
+    res->p90 = percentile(samples, n, 0.90);
+    res->p99 = percentile(samples, n, 0.99);
+    res->p999 = percentile(samples, n, 0.999);
+    res->max = samples[n - 1];
+    res->mean = sum / n;
+}
+
+static void print_result(const bench_result_t *res) {
+    printf("%-20s %7d %6d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+           res->name, res->count, res->errors,
+           res->min / 1000.0, res->p50 / 1000.0, res->p90 / 1000.0, res->p99 / 1000.0,
+           res->p999 / 1000.0, res->max / 1000.0, res->mean / 1000.0);
+}
+
+static void json_result(FILE *f, const bench_result_t *res, int last) {
+    fprintf(f,
+        "{\"name\":\"%s\",\"count\":%d,\"errors\":%d,\"min_ns\":%llu,\"p50_ns\":%llu,"
+        "\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu,\"mean_ns\":%.0f}%s",
+        res->name, res->count, res->errors,
+        (unsigned long long)res->min, (unsigned long long)res->p50, (unsigned long long)res->p90,
+        (unsigned long long)res->p99, (unsigned long long)res->p999, (unsigned long long)res->max,
+        res->mean, last ? "" : ",");
+}
+
+/* Print 'text' as a JSON string body (bus paths may hold any character) */
+static void json_escape(FILE *f, const char *text) {
+    for (const char *p = text; *p != '\0'; p++) {
+        if (*p == '"' || *p == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*p, f);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *bus_path = I2C_DEV_PATH;
+    const char *mux_spec = NULL;
+    const char *out_path = NULL;
+    int iterations = DEFAULT_ITERATIONS;
+    int sweeps = DEFAULT_SWEEPS;
+    float it_ms = bench_cfg.it_ms;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:n:w:i:o:h")) != -1) {
+        switch (opt) {
+            case 'b': bus_path = optarg; break;
+            case 't': mux_spec = optarg; break;
+            case 'n': iterations = atoi(optarg); break;
+            case 'w': sweeps = atoi(optarg); break;
+            case 'i': it_ms = (float)atof(optarg); break;
+            case 'o': out_path = optarg; break;
+            default:
+                usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (iterations <= 0 || sweeps <= 0 || it_ms <= 0.0f) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int fd = i2c_open_bus(bus_path);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to open I2C bus %s\n", bus_path);
+        return EXIT_FAILURE;
+    }
+
+    topo_t topo;
+    if (topo_from_spec(&topo, fd, mux_spec) != TOPO_OK) {
+        fprintf(stderr, "No mux topology '%s' on %s\n", mux_spec != NULL ? mux_spec : "0x70", bus_path);
+        i2c_close_bus(fd);
+        return EXIT_FAILURE;
+    }
+
+    sweep_ctx_t ctx;
+    sweep_init_topology(&ctx, fd, &topo, VEML3328_I2C_ADDR);
+    uint64_t mask = topo_all_sensors(&topo);
+    int num_sensors = topo_num_sensors(&topo);
+
+    int max_samples = (iterations > sweeps) ? iterations : sweeps;
+    uint64_t *samples = malloc((size_t)max_samples * sizeof(uint64_t));
+    if (samples == NULL) {
+        i2c_close_bus(fd);
+        return EXIT_FAILURE;
+    }
+
+    enum { B_WRITE_READ, B_READ_ALL, B_SELECT, B_SWEEP, NUM_BENCH };
+    bench_result_t results[NUM_BENCH];
+    int errors;
+
+    /* Single transactions against sensor 0 */
+    sweep_select_channel(&ctx, 0);
+    veml3328_config(fd, VEML3328_I2C_ADDR);
+
+    errors = 0;
+    for (int i = 0; i < iterations; i++) {
+        uint8_t reg = VEML3328_REG_ID;
+        uint8_t id[2];
+        uint64_t t0 = sweep_now_ns();
+        errors += (i2c_write_read(fd, VEML3328_I2C_ADDR, &reg, 1, id, 2) < 0);
+        samples[i] = sweep_now_ns() - t0;
+    }
+    summarize(&results[B_WRITE_READ], "i2c_write_read", samples, iterations, errors);
+
+    errors = 0;
+    for (int i = 0; i < iterations; i++) {
+        veml3328_raw_data_t raw;
+        uint64_t t0 = sweep_now_ns();
+        errors += (veml3328_read_all(fd, VEML3328_I2C_ADDR, &raw) != VEML3328_OK);
+        samples[i] = sweep_now_ns() - t0;
+    }
+    summarize(&results[B_READ_ALL], "veml3328_read_all", samples, iterations, errors);
+
+    errors = 0;
+    for (int i = 0; i < iterations; i++) {
+        uint64_t t0 = sweep_now_ns();
+        errors += (tca_select_channel(fd, topo.mux_addr[0], i % TOPO_CHANNELS_PER_MUX) != TCA_OK);
+        samples[i] = sweep_now_ns() - t0;
+    }
+    summarize(&results[B_SELECT], "tca_select_channel", samples, iterations, errors);
+
+    /* Full sweeps: one configuring sweep, then steady-state sweeps back-to-back */
+    veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        cfg[i] = bench_cfg;
+        cfg[i].it_ms = it_ms;
+    }
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+
+    sweep_invalidate(&ctx);
+    uint64_t done = 0;
+    uint64_t t0 = sweep_now_ns();
+    sweep_run_sensors(&ctx, mask, cfg, raw, NULL, &done);
+    uint64_t first_sweep_ns = sweep_now_ns() - t0;
+
+    errors = 0;
+    uint64_t samples_read = 0;
+    uint64_t total_ns = 0;
+    for (int i = 0; i < sweeps; i++) {
+        /* Forget the last samples, or the sweep would wait for fresh ones:
+           re-reading the latched counts measures the bus alone */
+        ctx.sample_valid = 0;
+        t0 = sweep_now_ns();
+        sweep_run_sensors(&ctx, mask, cfg, raw, NULL, &done);
+        samples[i] = sweep_now_ns() - t0;
+        total_ns += samples[i];
+        samples_read += (uint64_t)__builtin_popcountll(done);
+        errors += (done != mask);
+    }
+    summarize(&results[B_SWEEP], "sweep", samples, sweeps, errors);
+    sweep_disable_all(&ctx);
+
+    /* Back-to-back reads measure the bus; fresh samples are bounded by IT */
+    double bus_rate = (total_ns > 0) ? samples_read * 1e9 / (double)total_ns : 0.0;
+    double period_ns = results[B_SWEEP].mean > it_ms * 1e6 ? results[B_SWEEP].mean : it_ms * 1e6;
+    double fresh_rate = num_sensors * 1e9 / period_ns;
+
+    printf("Bus %s, %d sensor(s), %d iterations, %d sweeps (IT %.0f ms)\n",
+           bus_path, num_sensors, iterations, sweeps, it_ms);
+    printf("%-20s %7s %6s %9s %9s %9s %9s %9s %9s %9s\n",
+           "us", "count", "errors", "min", "p50", "p90", "p99", "p99.9", "max", "mean");
+    for (int b = 0; b < NUM_BENCH; b++) {
+        print_result(&results[b]);
+    }
+    printf("First (configuring) sweep: %.1f ms\n", first_sweep_ns / 1e6);
+    printf("Throughput: %.0f samples/s back-to-back, %.1f fresh samples/s\n", bus_rate, fresh_rate);
+
+    int ret = EXIT_SUCCESS;
+    if (out_path != NULL) {
+        FILE *f = fopen(out_path, "a");
+        if (f == NULL) {
+            perror("fopen");
+            ret = EXIT_FAILURE;
+        } else {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+
+            fprintf(f, "{\"time\":%lld,\"bus\":\"", (long long)ts.tv_sec);
+            json_escape(f, bus_path);
+            fprintf(f, "\",\"sensors\":%d,\"it_ms\":%.0f,\"results\":[", num_sensors, it_ms);
+            for (int b = 0; b < NUM_BENCH; b++) {
+                json_result(f, &results[b], b == NUM_BENCH - 1);
+            }
+            fprintf(f, "],\"first_sweep_ns\":%llu,\"bus_samples_per_s\":%.1f,\"fresh_samples_per_s\":%.2f}\n",
+                    (unsigned long long)first_sweep_ns, bus_rate, fresh_rate);
+            fclose(f);
+        }
+    }
+
+    free(samples);
+    i2c_close_bus(fd);
+    return ret;
+}
@@ -0,0 +1,120 @@
+#include "coalesce.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct coalesce_waiter {
+    struct coalesce_waiter *next;
+    uint64_t mask;
+    void *results;
+    uint64_t done;
+    int finished;
+} coalesce_waiter_t;
+
+int coalescer_init(coalescer_t *c, size_t elem_size, coalesce_sweep_fn sweep, void *user) {
+    if (c == NULL || sweep == NULL || elem_size == 0) {
+        return -1;
+    }
+
+    memset(c, 0, sizeof(*c));
+    c->buffer = malloc(elem_size * COALESCE_MAX_SENSORS);
+    if (c->buffer == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->finished, NULL);
+    c->sweep = sweep;
+    c->user = user;
+    c->elem_size = elem_size;
+    return 0;
+}
+
+void coalescer_destroy(coalescer_t *c) {
+    if (c == NULL || c->buffer == NULL) {
+        return;
+    }
+
+    pthread_cond_destroy(&c->finished);
+    pthread_mutex_destroy(&c->lock);
+    free(c->buffer);
+    c->buffer = NULL;
+}
+
+/* Run the queued callers' sweep; called and returns with the lock held */
+static void lead_sweep(coalescer_t *c) {
+    coalesce_waiter_t *waiters = c->queued;
+    uint64_t mask = c->queue_mask;
+    int sensitivity = c->queue_sensitivity;
+
+    c->busy = 1;
+    c->running = waiters;
+    c->run_mask = mask;
+    c->run_sensitivity = sensitivity;
+    c->queued = NULL;
+    c->queue_mask = 0;
+    c->sweeps++;
+
+    /* Other callers may join while the bus is busy, and a queue for another
+       sensitivity may form */
+    pthread_cond_broadcast(&c->finished);
+    pthread_mutex_unlock(&c->lock);
+    uint64_t done = c->sweep(c->user, mask, sensitivity, c->buffer);
+    pthread_mutex_lock(&c->lock);
+
+    for (coalesce_waiter_t *w = c->running; w != NULL; w = w->next) {
+        for (int i = 0; i < COALESCE_MAX_SENSORS; i++) {
+            if (w->mask & (1ull << i)) {
+                memcpy((char *)w->results + (size_t)i * c->elem_size,
+                       (const char *)c->buffer + (size_t)i * c->elem_size, c->elem_size);
+            }
+        }
+        w->done = done & w->mask;
+        w->finished = 1;
+        c->requests++;
+    }
+
+    c->running = NULL;
+    c->busy = 0;
+    pthread_cond_broadcast(&c->finished);
+}
+
+uint64_t coalescer_sweep(coalescer_t *c, uint64_t mask, int sensitivity, void *results) {
+    if (c == NULL || results == NULL || mask == 0) {
+        return 0;
+    }
+
+    coalesce_waiter_t self = {
+        .next = NULL,
+        .mask = mask,
+        .results = results,
+        .done = 0,
+        .finished = 0
+    };
+
+    pthread_mutex_lock(&c->lock);
+    if (c->busy && c->run_sensitivity == sensitivity && (mask & ~c->run_mask) == 0) {
+        self.next = c->running;
+        c->running = &self;
+    } else {
+        /* One sensitivity per sweep: wait for a queue asking for another one to leave */
+        while (c->queued != NULL && c->queue_sensitivity != sensitivity) {
+            pthread_cond_wait(&c->finished, &c->lock);
+        }
+        self.next = c->queued;
+        c->queued = &self;
+        c->queue_mask |= mask;
+        c->queue_sensitivity = sensitivity;
+    }
+
+    while (!self.finished) {
+        if (!c->busy && c->queued != NULL) {
+            lead_sweep(c);
+        } else {
+            pthread_cond_wait(&c->finished, &c->lock);
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return self.done;
+}
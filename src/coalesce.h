@@ -0,0 +1,55 @@
+#ifndef COALESCE_H
+#define COALESCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Request coalescing for sweeps. Callers that arrive while a sweep is on the
+ * bus join it if it covers their sensors (and sensitivity); the others are
+ * merged into one follow-up sweep over the union of their masks, run by
+ * whichever waiter gets there first. Bus load therefore depends on how
+ * often sweeps can run, not on how many callers ask.
+ *
+ * Results are arrays of COALESCE_MAX_SENSORS elements of 'elem_size' bytes,
+ * indexed by sensor; each caller receives the elements of its own mask.
+ */
+
+#define COALESCE_MAX_SENSORS    64
+
+/* Sweep 'mask' into 'results' (sensor-indexed); returns the mask read successfully */
+typedef uint64_t (*coalesce_sweep_fn)(void *user, uint64_t mask, int sensitivity, void *results);
+
+struct coalesce_waiter;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    coalesce_sweep_fn sweep;
+    void *user;
+    size_t elem_size;
+    void *buffer;                       // results of the running sweep
+
+    int busy;                           // a sweep is on the bus
+    int run_sensitivity;
+    uint64_t run_mask;
+    struct coalesce_waiter *running;    // callers served by the running sweep
+    int queue_sensitivity;
+    uint64_t queue_mask;
+    struct coalesce_waiter *queued;     // callers waiting for the next sweep
+
+    uint64_t requests;                  // callers served
+    uint64_t sweeps;                    // sweeps run for them
+} coalescer_t;
+
+/* Returns 0, or -1 if the result buffer cannot be allocated */
+int coalescer_init(coalescer_t *c, size_t elem_size, coalesce_sweep_fn sweep, void *user);
+
+void coalescer_destroy(coalescer_t *c);
+
+/* Sweep 'mask' (possibly shared with concurrent callers) into 'results'.
+   Only the elements of 'mask' are written. Returns the mask read successfully. */
+uint64_t coalescer_sweep(coalescer_t *c, uint64_t mask, int sensitivity, void *results);
+
+#endif // COALESCE_H
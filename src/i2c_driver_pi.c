@@ -1,60 +1,378 @@
 #include "i2c_driver_pi.h"
+#include "log.h"
+#include "metrics.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <sys/ioctl.h>
 #include <linux/i2c.h>
 #include <linux/i2c-dev.h>
 
+/*
+ * Per-fd bus context. The adapter capabilities are queried once and the
+ * slave address currently bound with I2C_SLAVE is remembered, so the driver
+ * only rebinds when the target address actually changes.
+ *
+ * Only buses opened by i2c_open_bus have a context. Every transaction looks
+ * its context up, so the lookup takes no lock: a slot's fd is published
+ * atomically once the slot is filled in, and the slot's own lock only
+ * serialises claiming and releasing it. Bus threads never contend.
+ */
+typedef struct {
+    atomic_int fd;              // -1 when the slot is free
+    pthread_mutex_t lock;       // held while the slot is claimed or released
+    const i2c_backend_t *backend;   // NULL: Linux i2c-dev
+    int slave_valid;            // slave_addr is bound on the fd
+    uint8_t slave_addr;
+    unsigned long funcs;        // I2C_FUNCS bitmap of the adapter
+    int retries;                // extra attempts of a failed transaction
+    uint32_t backoff_us;        // wait before the first retry, doubled after each
+} i2c_bus_ctx_t;
+
+typedef struct {
+    const char *prefix;
+    const i2c_backend_t *backend;
+} i2c_backend_entry_t;
+
+static i2c_backend_entry_t backends[I2C_MAX_BACKENDS];
+static pthread_mutex_t backends_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static i2c_bus_ctx_t bus_ctx[I2C_MAX_BUSES] = {
+    [0 ... I2C_MAX_BUSES - 1] = { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER }
+};
+
+/* Context of a bus opened by i2c_open_bus, or NULL */
+static i2c_bus_ctx_t *bus_ctx_get(int fd) {
+    if (fd < 0) {
+        return NULL;
+    }
+
+    for (int i = 0; i < I2C_MAX_BUSES; i++) {
+        if (atomic_load_explicit(&bus_ctx[i].fd, memory_order_acquire) == fd) {
+            return &bus_ctx[i];
+        }
+    }
+    return NULL;
+}
+
+/* Fill in a slot for a newly opened 'fd'. Returns NULL when every slot is taken. */
+static i2c_bus_ctx_t *bus_ctx_add(int fd, const i2c_backend_t *backend) {
+    for (int i = 0; i < I2C_MAX_BUSES; i++) {
+        i2c_bus_ctx_t *ctx = &bus_ctx[i];
+        pthread_mutex_lock(&ctx->lock);
+        if (atomic_load_explicit(&ctx->fd, memory_order_relaxed) >= 0) {
+            pthread_mutex_unlock(&ctx->lock);
+            continue;
+        }
+
+        ctx->backend = backend;
+        ctx->slave_valid = 0;
+        ctx->slave_addr = 0;
+        ctx->retries = 0;
+        ctx->backoff_us = 0;
+        if (backend != NULL) {
+            ctx->funcs = I2C_FUNC_I2C;      // Backends take combined transfers
+        } else if (ioctl(fd, I2C_FUNCS, &ctx->funcs) < 0) {
+            ctx->funcs = 0;                 // Unknown adapter, stick to plain read/write
+        }
+
+        atomic_store_explicit(&ctx->fd, fd, memory_order_release);
+        pthread_mutex_unlock(&ctx->lock);
+        return ctx;
+    }
+    return NULL;
+}
+
+static void bus_ctx_release(int fd) {
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    atomic_store_explicit(&ctx->fd, -1, memory_order_release);
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+static int has_func(const i2c_bus_ctx_t *ctx, unsigned long func) {
+    return ctx != NULL && (ctx->funcs & func) == func;
+}
+
+int i2c_register_backend(const char *prefix, const i2c_backend_t *backend) {
+    if (prefix == NULL || backend == NULL || backend->open == NULL || backend->transfer == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int ret = -1;
+    pthread_mutex_lock(&backends_lock);
+    for (int i = 0; i < I2C_MAX_BACKENDS; i++) {
+        if (backends[i].prefix == NULL || strcmp(backends[i].prefix, prefix) == 0) {
+            backends[i].prefix = prefix;
+            backends[i].backend = backend;
+            ret = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&backends_lock);
+
+    return ret;
+}
+
+static const i2c_backend_t *backend_for_path(const char *dev_path) {
+    const i2c_backend_t *backend = NULL;
+
+    pthread_mutex_lock(&backends_lock);
+    for (int i = 0; i < I2C_MAX_BACKENDS && backends[i].prefix != NULL; i++) {
+        if (strncmp(dev_path, backends[i].prefix, strlen(backends[i].prefix)) == 0) {
+            backend = backends[i].backend;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&backends_lock);
+
+    return backend;
+}
+
 int i2c_open_bus(const char *dev_path) {
-    
+    if (dev_path == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const i2c_backend_t *backend = backend_for_path(dev_path);
+    if (backend != NULL) {
+        int fd = backend->open(dev_path);
+        if (fd < 0) {
+            fprintf(stderr, "Failed to open %s bus %s\n", backend->name, dev_path);
+            return -1;
+        }
+
+        if (bus_ctx_add(fd, backend) == NULL) {
+            fprintf(stderr, "Too many open I2C buses\n");
+            if (backend->close != NULL) {
+                backend->close(fd);
+            }
+            errno = EMFILE;
+            return -1;
+        }
+        return fd;
+    }
+
     int fd = open(dev_path, O_RDWR);
     if (fd < 0) {                           // Error opening file
         perror("Failed to open I2C bus");
         return -1;
-    }   
-    
+    }
+
+    if (bus_ctx_add(fd, NULL) == NULL) {    // Query adapter capabilities once
+        fprintf(stderr, "Too many open I2C buses\n");
+        close(fd);
+        errno = EMFILE;
+        return -1;
+    }
+
     return fd;
 }
 
 void i2c_close_bus(int fd) {
-    if (fd >= 0) {              // Only close if valid fd
+    if (fd < 0) {               // Only close if valid fd
+        return;
+    }
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    const i2c_backend_t *backend = (ctx != NULL) ? ctx->backend : NULL;
+
+    bus_ctx_release(fd);
+    if (backend != NULL) {
+        if (backend->close != NULL) {
+            backend->close(fd);
+        }
+    } else {
         close(fd);
     }
 }
 
-static int i2c_set_slave(int fd, uint8_t dev_addr) {
+unsigned long i2c_bus_funcs(int fd) {
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    return ctx != NULL ? ctx->funcs : 0;
+}
+
+int i2c_bus_combined(int fd) {
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    return ctx != NULL && (ctx->backend != NULL || has_func(ctx, I2C_FUNC_I2C));
+}
+
+int i2c_bus_set_limits(int fd, int timeout_ms, int adapter_retries) {
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    if (ctx->backend != NULL) {
+        return 0;
+    }
+
+    /* I2C_TIMEOUT is in units of 10 ms; negative arguments leave a limit alone */
+    if (timeout_ms >= 0 && ioctl(fd, I2C_TIMEOUT, (unsigned long)((timeout_ms + 9) / 10)) < 0) {
+        return -1;
+    }
+    if (adapter_retries >= 0 && ioctl(fd, I2C_RETRIES, (unsigned long)adapter_retries) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+int i2c_bus_set_retry(int fd, int retries, uint32_t backoff_us) {
+    if (retries < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    ctx->retries = retries;
+    ctx->backoff_us = backoff_us;
+    return 0;
+}
+
+/* After failed attempt 'attempt' (0-based): wait and return 1 if it is worth another try */
+static int retry_wait(const i2c_bus_ctx_t *ctx, int attempt) {
+    if (ctx == NULL || attempt >= ctx->retries) {
+        return 0;
+    }
+
+    /* Only bus-level failures may clear up; bad arguments will not */
+    int err = errno;
+    if (err != EREMOTEIO && err != ENXIO && err != EIO && err != ETIMEDOUT && err != EAGAIN) {
+        return 0;
+    }
+
+    uint64_t wait_us = (uint64_t)ctx->backoff_us << (attempt < 16 ? attempt : 16);
+    LOG_D("Retrying I2C transaction, backoff us", err, -1, 0, -1, (int64_t)wait_us);
+    if (wait_us > 0) {
+        struct timespec ts = {
+            .tv_sec = (time_t)(wait_us / 1000000ull),
+            .tv_nsec = (long)(wait_us % 1000000ull) * 1000L
+        };
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+            // Finish the remaining backoff
+        }
+    }
+
+    errno = err;
+    return 1;
+}
+
+static int i2c_set_slave(int fd, i2c_bus_ctx_t *ctx, uint8_t dev_addr) {
+    if (ctx != NULL && ctx->slave_valid && ctx->slave_addr == dev_addr) {
+        return 0;               // Already bound, skip the ioctl
+    }
+
     if (ioctl(fd, I2C_SLAVE, dev_addr) < 0) {
-        perror("Failed to set I2C slave address");
+        if (ctx != NULL) {
+            ctx->slave_valid = 0;
+        }
+        LOG_W("Failed to set I2C slave address", errno, fd, dev_addr, -1, 0);
         return -1;
     }
-    
+
+    if (ctx != NULL) {
+        ctx->slave_addr = dev_addr;
+        ctx->slave_valid = 1;
+    }
+
     return 0;
 }
 
+/* Alternative backend: every call becomes a combined transfer */
+static int backend_transfer(const i2c_bus_ctx_t *ctx, int fd, i2c_xfer_msg_t *msgs, int num_msgs) {
+    for (int attempt = 0; ; attempt++) {
+        if (ctx->backend->transfer(fd, msgs, num_msgs) == 0) {
+            return 0;
+        }
+        if (!retry_wait(ctx, attempt)) {
+            return -1;
+        }
+    }
+}
+
+/* Plain I2C transaction: every message is addressed, so no slave binding is needed */
+static int i2c_rdwr(const i2c_bus_ctx_t *ctx, int fd, struct i2c_msg *msgs, int num_msgs) {
+    struct i2c_rdwr_ioctl_data data = {
+        .msgs = msgs,
+        .nmsgs = (uint32_t)num_msgs
+    };
+
+    for (int attempt = 0; ; attempt++) {
+        if (ioctl(fd, I2C_RDWR, &data) >= 0) {
+            return 0;
+        }
+        if (!retry_wait(ctx, attempt)) {
+            return -1;
+        }
+    }
+}
+
 int i2c_write_bytes(int fd, uint8_t dev_addr, const uint8_t *buf, int length) {
     if (fd < 0 || buf == NULL || length <= 0) {
         errno = EINVAL;
         return -1;
     }
-    
-    if (i2c_set_slave(fd, dev_addr) < 0) {
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;          // Not opened by i2c_open_bus
+        return -1;
+    }
+
+    if (ctx->backend != NULL) {
+        i2c_xfer_msg_t msg = { dev_addr, 0, (uint16_t)length, (uint8_t *)buf };
+        return backend_transfer(ctx, fd, &msg, 1);
+    }
+
+    /* Address changes on an I2C-capable adapter: one addressed message
+       instead of I2C_SLAVE + write() */
+    if (has_func(ctx, I2C_FUNC_I2C) && !(ctx->slave_valid && ctx->slave_addr == dev_addr)) {
+        struct i2c_msg msg = {
+            .addr = dev_addr,
+            .flags = 0,
+            .len = (uint16_t)length,
+            .buf = (uint8_t *)buf
+        };
+
+        if (i2c_rdwr(ctx, fd, &msg, 1) < 0) {
+            LOG_W("Failed to write to I2C device", errno, fd, dev_addr, -1, length);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (i2c_set_slave(fd, ctx, dev_addr) < 0) {
         return -1;
     }
-    
+
     ssize_t bytes_written = write(fd, buf, (size_t)length);
     if (bytes_written != length) {
         if (bytes_written <0) {
-            perror("Failed to write to I2C device");
+            LOG_W("Failed to write to I2C device", errno, fd, dev_addr, -1, length);
         } else {
-            fprintf(stderr, "Partial write to I2C device: %zd of %d bytes\n", bytes_written, length);
+            LOG_W("Partial write to I2C device, bytes written", 0, fd, dev_addr, -1, bytes_written);
         }
-        
+
         return -1;
     }
-    
+
     return 0;
 }
 
@@ -63,22 +381,48 @@ int i2c_read_bytes(int fd, uint8_t dev_addr, uint8_t *buf, int length) {
         errno = EINVAL;
         return -1;
     }
-    
-    if (i2c_set_slave(fd, dev_addr) < 0) {
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;
         return -1;
     }
-    
+
+    if (ctx->backend != NULL) {
+        i2c_xfer_msg_t msg = { dev_addr, I2C_XFER_RD, (uint16_t)length, buf };
+        return backend_transfer(ctx, fd, &msg, 1);
+    }
+
+    if (has_func(ctx, I2C_FUNC_I2C) && !(ctx->slave_valid && ctx->slave_addr == dev_addr)) {
+        struct i2c_msg msg = {
+            .addr = dev_addr,
+            .flags = I2C_M_RD,
+            .len = (uint16_t)length,
+            .buf = buf
+        };
+
+        if (i2c_rdwr(ctx, fd, &msg, 1) < 0) {
+            LOG_W("Failed to read from I2C device", errno, fd, dev_addr, -1, length);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (i2c_set_slave(fd, ctx, dev_addr) < 0) {
+        return -1;
+    }
+
     ssize_t bytes_read = read(fd, buf, (size_t)length);
     if (bytes_read != length) {
         if (bytes_read < 0) {
-            perror("Failed to read from I2C device");
+            LOG_W("Failed to read from I2C device", errno, fd, dev_addr, -1, length);
         } else {
-            fprintf(stderr, "Partial read from I2C device: %zd of %d bytes\n", bytes_read, length);
+            LOG_W("Partial read from I2C device, bytes read", 0, fd, dev_addr, -1, bytes_read);
         }
-        
+
         return -1;
     }
-    
+
     return 0;
 }
 
@@ -92,39 +436,193 @@ int i2c_read_byte(int fd, uint8_t dev_addr, uint8_t *out) {
         errno = EINVAL;
         return -1;
     }
-    
+
     return i2c_read_bytes(fd, dev_addr, out, 1);
 }
 
-int i2c_write_read(int fd, uint8_t dev_addr, const uint8_t *write_buf, int write_length, uint8_t *read_buf, int read_length) {
+/* SMBus "read word data": register pointer write + 2-byte read in one ioctl */
+static int i2c_smbus_read_word(int fd, i2c_bus_ctx_t *ctx, uint8_t dev_addr, uint8_t reg, uint8_t *read_buf) {
+    if (i2c_set_slave(fd, ctx, dev_addr) < 0) {
+        return -1;
+    }
+
+    union i2c_smbus_data smbus_data;
+    struct i2c_smbus_ioctl_data args = {
+        .read_write = I2C_SMBUS_READ,
+        .command = reg,
+        .size = I2C_SMBUS_WORD_DATA,
+        .data = &smbus_data
+    };
+
+    if (ioctl(fd, I2C_SMBUS, &args) < 0) {
+        return -1;
+    }
+
+    read_buf[0] = (uint8_t)(smbus_data.word & 0xFF);        // SMBus words are LSB first
+    read_buf[1] = (uint8_t)(smbus_data.word >> 8);
+    return 0;
+}
+
+static int write_read(int fd, uint8_t dev_addr, const uint8_t *write_buf, int write_length, uint8_t *read_buf, int read_length) {
     if (fd < 0 || write_buf == NULL || write_length <= 0 || read_buf == NULL || read_length <= 0) {
         errno = EINVAL;
         return -1;
     }
-    
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (ctx->backend != NULL) {
+        i2c_xfer_msg_t msgs[2] = {
+            { dev_addr, 0, (uint16_t)write_length, (uint8_t *)write_buf },
+            { dev_addr, I2C_XFER_RD, (uint16_t)read_length, read_buf }
+        };
+        return backend_transfer(ctx, fd, msgs, 2);
+    }
+
+    /* Adapters without plain I2C support: fall back to SMBus word reads,
+       or to two separate transactions as a last resort */
+    if (!has_func(ctx, I2C_FUNC_I2C)) {
+        if (write_length == 1 && read_length == 2 && has_func(ctx, I2C_FUNC_SMBUS_READ_WORD_DATA)) {
+            if (i2c_smbus_read_word(fd, ctx, dev_addr, write_buf[0], read_buf) < 0) {
+                LOG_W("Failed to perform SMBus word read", errno, fd, dev_addr, -1, write_buf[0]);
+                return -1;
+            }
+            return 0;
+        }
+
+        if (i2c_write_bytes(fd, dev_addr, write_buf, write_length) < 0) {
+            return -1;
+        }
+        return i2c_read_bytes(fd, dev_addr, read_buf, read_length);
+    }
+
     struct i2c_msg msgs[2];
     // Write message
     msgs[0].addr = dev_addr;
     msgs[0].flags = 0;                      // Write
     msgs[0].len = (uint16_t)write_length;
     msgs[0].buf = (uint8_t *)write_buf;
-    
+
     // Read message
     msgs[1].addr = dev_addr;
     msgs[1].flags = I2C_M_RD;               // Read
     msgs[1].len = (uint16_t)read_length;
     msgs[1].buf = read_buf;
-    
-    struct i2c_rdwr_ioctl_data data = {
-        .msgs = msgs,
-        .nmsgs = 2
-    };
 
-    if (ioctl(fd, I2C_RDWR, &data) < 0) {
-        perror("Failed to perform I2C write-read transaction");
+    if (i2c_rdwr(ctx, fd, msgs, 2) < 0) {
+        LOG_W("Failed to perform I2C write-read transaction", errno, fd, dev_addr, -1, read_length);
         return -1;
     }
-    
+
     return 0;
-    
-}
\ No newline at end of file
+
+}
+
+int i2c_write_read(int fd, uint8_t dev_addr, const uint8_t *write_buf, int write_length, uint8_t *read_buf, int read_length) {
+    uint64_t start_ns = metrics_now_ns();
+    int ret = write_read(fd, dev_addr, write_buf, write_length, read_buf, read_length);
+    metrics_record_since(METRIC_I2C_WRITE_READ, start_ns);
+    return ret;
+}
+
+int i2c_read_regs(int fd, uint8_t dev_addr, const uint8_t *regs, int num_regs, uint8_t *read_buf, int reg_length) {
+    if (fd < 0 || regs == NULL || num_regs <= 0 || num_regs > I2C_MAX_BATCH_REGS || read_buf == NULL || reg_length <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (ctx->backend != NULL) {
+        i2c_xfer_msg_t xfer[2 * I2C_MAX_BATCH_REGS];
+        for (int i = 0; i < num_regs; i++) {
+            xfer[2 * i] = (i2c_xfer_msg_t){ dev_addr, 0, 1, (uint8_t *)&regs[i] };
+            xfer[2 * i + 1] = (i2c_xfer_msg_t){ dev_addr, I2C_XFER_RD, (uint16_t)reg_length, &read_buf[i * reg_length] };
+        }
+        return backend_transfer(ctx, fd, xfer, 2 * num_regs);
+    }
+
+    /* No multi-message support: one write-read per register */
+    if (!has_func(ctx, I2C_FUNC_I2C)) {
+        for (int i = 0; i < num_regs; i++) {
+            if (i2c_write_read(fd, dev_addr, &regs[i], 1, &read_buf[i * reg_length], reg_length) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    struct i2c_msg msgs[2 * I2C_MAX_BATCH_REGS];
+    for (int i = 0; i < num_regs; i++) {
+        // Register address write
+        msgs[2 * i].addr = dev_addr;
+        msgs[2 * i].flags = 0;
+        msgs[2 * i].len = 1;
+        msgs[2 * i].buf = (uint8_t *)&regs[i];
+
+        // Register content read (repeated start)
+        msgs[2 * i + 1].addr = dev_addr;
+        msgs[2 * i + 1].flags = I2C_M_RD;
+        msgs[2 * i + 1].len = (uint16_t)reg_length;
+        msgs[2 * i + 1].buf = &read_buf[i * reg_length];
+    }
+
+    if (i2c_rdwr(ctx, fd, msgs, 2 * num_regs) < 0) {
+        LOG_W("Failed to perform I2C batched register read", errno, fd, dev_addr, -1, num_regs);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int transfer(int fd, i2c_xfer_msg_t *msgs, int num_msgs) {
+    if (fd < 0 || msgs == NULL || num_msgs <= 0 || num_msgs > I2C_MAX_MSGS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    i2c_bus_ctx_t *ctx = bus_ctx_get(fd);
+    if (ctx == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (ctx->backend != NULL) {
+        return backend_transfer(ctx, fd, msgs, num_msgs);
+    }
+
+    if (!has_func(ctx, I2C_FUNC_I2C)) {
+        errno = EOPNOTSUPP;     // Combined transactions need plain I2C support
+        return -1;
+    }
+
+    struct i2c_msg kmsgs[I2C_MAX_MSGS];
+    for (int i = 0; i < num_msgs; i++) {
+        kmsgs[i].addr = msgs[i].addr;
+        kmsgs[i].flags = (msgs[i].flags & I2C_XFER_RD) ? I2C_M_RD : 0;
+        kmsgs[i].len = msgs[i].len;
+        kmsgs[i].buf = msgs[i].buf;
+    }
+
+    if (i2c_rdwr(ctx, fd, kmsgs, num_msgs) < 0) {
+        LOG_W("Failed to perform I2C combined transaction", errno, fd, msgs[0].addr, -1, num_msgs);
+        return -1;
+    }
+
+    return 0;
+}
+
+int i2c_transfer(int fd, i2c_xfer_msg_t *msgs, int num_msgs) {
+    uint64_t start_ns = metrics_now_ns();
+    int ret = transfer(fd, msgs, num_msgs);
+    metrics_record_since(METRIC_I2C_TRANSFER, start_ns);
+    return ret;
+}
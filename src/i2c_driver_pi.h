@@ -3,12 +3,77 @@
 
 #include <stdint.h>
 
-/* Open an I2C bus. Returns fd or -1 on error. */
+/* Maximum number of buses with a cached context (slave address, capabilities) */
+#define I2C_MAX_BUSES 8
+
+/* Linux caps a single I2C_RDWR call at 42 messages */
+#define I2C_MAX_MSGS 42
+
+/* Message flag: read into buf (otherwise buf is written) */
+#define I2C_XFER_RD 0x0001
+
+/* One message of a combined transaction (repeated start between messages) */
+typedef struct {
+    uint8_t addr;           // 7-bit device address
+    uint16_t flags;         // I2C_XFER_RD or 0
+    uint16_t len;
+    uint8_t *buf;
+} i2c_xfer_msg_t;
+
+/*
+ * Bus backend. The default backend is the Linux i2c-dev interface; other
+ * backends (e.g. the simulated bus in i2c_sim.c) are selected by a device
+ * path prefix such as "sim:". A backend only has to implement combined
+ * transfers; every driver call is expressed in terms of them.
+ */
+typedef struct {
+    const char *name;
+    int (*open)(const char *dev_path);                              // fd or -1
+    void (*close)(int fd);
+    int (*transfer)(int fd, i2c_xfer_msg_t *msgs, int num_msgs);    // 0 or -1 (errno set)
+} i2c_backend_t;
+
+#define I2C_MAX_BACKENDS 4
+
+/* Route device paths starting with 'prefix' to 'backend'. Returns 0, or -1 if the table is full. */
+int i2c_register_backend(const char *prefix, const i2c_backend_t *backend);
+
+/* Open an I2C bus ("/dev/i2c-N", or a path with a registered backend prefix). Returns fd or -1 on error.
+   The other driver calls only take fds opened here and fail with EBADF otherwise. */
 int i2c_open_bus(const char *dev_path);
 
 /* Close a previously opened bus. Safe to call with fd < 0. */
 void i2c_close_bus(int fd); 
 
+/*
+ * Adapter capabilities (I2C_FUNCS bitmap), queried once per bus.
+ * Adapters with I2C_FUNC_I2C get addressed I2C_RDWR messages, so no
+ * I2C_SLAVE rebind is needed; otherwise the bound slave address is cached
+ * and only rebound when it changes.
+ */
+unsigned long i2c_bus_funcs(int fd);
+
+/* Non-zero if the bus takes combined multi-message transfers (i2c_transfer) */
+int i2c_bus_combined(int fd);
+
+/*
+ * Adapter limits of an i2c-dev bus: I2C_TIMEOUT (kernel granularity 10 ms)
+ * and I2C_RETRIES (retries on arbitration loss, done by the adapter).
+ * Negative arguments leave a limit alone. Both are adapter settings, shared
+ * with every other user of the bus, so nothing sets them unless asked.
+ * No-op on other backends. Returns 0 on success, -1 on error.
+ */
+int i2c_bus_set_limits(int fd, int timeout_ms, int adapter_retries);
+
+/*
+ * Retry a failed transaction (NACK, timeout, bus error) up to 'retries'
+ * more times, waiting backoff_us, then twice that, and so on, in between.
+ * Applies to every addressed transaction on the bus; default 0 (off).
+ * Returns 0, or -1 with errno EINVAL for negative 'retries' or EBADF if
+ * 'fd' was not opened with i2c_open_bus.
+ */
+int i2c_bus_set_retry(int fd, int retries, uint32_t backoff_us);
+
 /*
  * write "length" bytes from buf to device at 7-bit address 'dev_addr' on bus 'fd'.
  * Returns 0 on success, -1 on error.
@@ -27,4 +92,22 @@ int i2c_read_byte(int i2c_fd, uint8_t dev_addr_7bit, uint8_t *out);
 
 int i2c_write_read(int fd, uint8_t dev_addr, const uint8_t *write_buf, int write_length, uint8_t *read_buf, int read_length);
 
+/* One write/read message pair per register */
+#define I2C_MAX_BATCH_REGS (I2C_MAX_MSGS / 2)
+
+/*
+ * Read 'num_regs' registers of 'reg_length' bytes each from device 'dev_addr'
+ * in a single I2C_RDWR transaction (one write/read message pair per register).
+ * Register i lands at read_buf[i * reg_length].
+ * Returns 0 on success, -1 on error.
+ */
+int i2c_read_regs(int fd, uint8_t dev_addr, const uint8_t *regs, int num_regs, uint8_t *read_buf, int reg_length);
+
+/*
+ * Execute up to I2C_MAX_MSGS messages, possibly to different devices, as one
+ * combined transaction (a single I2C_RDWR on Linux).
+ * Returns 0 on success, -1 on error.
+ */
+int i2c_transfer(int fd, i2c_xfer_msg_t *msgs, int num_msgs);
+
 #endif // I2C_DRIVER_H
\ No newline at end of file
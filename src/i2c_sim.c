@@ -0,0 +1,499 @@
+#include "i2c_sim.h"
+#include "i2c_driver_pi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+/* VEML3328 registers and CONF fields modelled by the simulator */
+#define SIM_REG_CONF    0x00
+#define SIM_REG_CLEAR   0x04
+#define SIM_REG_BLUE    0x07
+#define SIM_REG_IR      0x08
+#define SIM_REG_ID      0x0C
+#define SIM_CONF_SD0    0x0001
+
+typedef struct {
+    uint16_t conf;
+    uint8_t reg_ptr;
+    uint64_t start_ns;              // integration start (last CONF write)
+    uint64_t latched_cycle;         // completed cycles reflected in data[]
+    uint16_t data[4];               // C, R, G, B
+    i2c_sim_light_t light;
+} sim_sensor_t;
+
+typedef struct {
+    int fd;                         // -1 when the slot is free
+    pthread_mutex_t lock;
+    i2c_sim_config_t cfg;
+    uint8_t control[I2C_SIM_MAX_MUXES];
+    uint8_t pending[I2C_SIM_MAX_MUXES];     // control written in the current transfer
+    uint8_t pending_mask;                   // bit m: pending[m] takes effect at STOP
+    sim_sensor_t sensors[I2C_SIM_MAX_MUXES][I2C_SIM_CHANNELS];
+    i2c_sim_stats_t stats;
+    unsigned int rng;
+    i2c_sim_hook_t hook;
+    void *hook_user;
+} sim_bus_t;
+
+static sim_bus_t sim_buses[I2C_MAX_BUSES] = {
+    [0 ... I2C_MAX_BUSES - 1] = { .fd = -1, .lock = PTHREAD_MUTEX_INITIALIZER }
+};
+static pthread_mutex_t sim_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t sim_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sim_delay_us(uint64_t us) {
+    if (us == 0) {
+        return;
+    }
+
+    struct timespec ts = {
+        .tv_sec = (time_t)(us / 1000000ull),
+        .tv_nsec = (long)(us % 1000000ull) * 1000L
+    };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) {
+        // Finish the remaining delay
+    }
+}
+
+/* A distinct default colour per channel so sweeps are easy to tell apart */
+static i2c_sim_light_t sim_default_light(int mux, int channel) {
+    static const i2c_sim_light_t palette[I2C_SIM_CHANNELS] = {
+        { 2.0f, 1.20f, 0.30f, 0.10f },      // red
+        { 2.0f, 0.90f, 0.80f, 0.10f },      // amber
+        { 2.0f, 0.20f, 1.20f, 0.20f },      // green
+        { 2.0f, 0.10f, 0.50f, 1.00f },      // cyan
+        { 2.0f, 0.10f, 0.20f, 1.30f },      // blue
+        { 2.0f, 0.60f, 0.60f, 0.60f },      // white
+        { 0.5f, 0.15f, 0.15f, 0.15f },      // dim white
+        { 8.0f, 2.40f, 2.40f, 2.40f },      // bright white
+    };
+
+    i2c_sim_light_t light = palette[channel % I2C_SIM_CHANNELS];
+    float scale = 1.0f + 0.1f * (float)mux;
+    light.clear *= scale;
+    light.red *= scale;
+    light.green *= scale;
+    light.blue *= scale;
+    return light;
+}
+
+void i2c_sim_default_config(i2c_sim_config_t *cfg) {
+    if (cfg == NULL) {
+        return;
+    }
+
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->num_muxes = 1;
+    for (int m = 0; m < I2C_SIM_MAX_MUXES; m++) {
+        cfg->present[m] = 0xFF;
+    }
+    cfg->latency_us = 0;
+    cfg->byte_us = 0;
+    cfg->nack_probability = 0.0f;
+    cfg->seed = 1;
+}
+
+/* "sim:key=value,key=value" */
+static int sim_parse_path(const char *dev_path, i2c_sim_config_t *cfg) {
+    i2c_sim_default_config(cfg);
+
+    const char *opts = dev_path + strlen(I2C_SIM_PREFIX);
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", opts);
+
+    char *save = NULL;
+    for (char *tok = strtok_r(buf, ",", &save); tok != NULL; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        if (eq == NULL) {
+            return -1;
+        }
+        *eq = '\0';
+        const char *key = tok;
+        const char *val = eq + 1;
+
+        if (strcmp(key, "muxes") == 0) {
+            cfg->num_muxes = atoi(val);
+        } else if (strcmp(key, "present") == 0) {
+            uint8_t present = (uint8_t)strtoul(val, NULL, 0);
+            for (int m = 0; m < I2C_SIM_MAX_MUXES; m++) {
+                cfg->present[m] = present;
+            }
+        } else if (strcmp(key, "latency_us") == 0) {
+            cfg->latency_us = (uint32_t)strtoul(val, NULL, 0);
+        } else if (strcmp(key, "byte_us") == 0) {
+            cfg->byte_us = (uint32_t)strtoul(val, NULL, 0);
+        } else if (strcmp(key, "nack") == 0) {
+            cfg->nack_probability = (float)atof(val);
+        } else if (strcmp(key, "seed") == 0) {
+            cfg->seed = (unsigned int)strtoul(val, NULL, 0);
+        } else {
+            return -1;
+        }
+    }
+
+    if (cfg->num_muxes < 1 || cfg->num_muxes > I2C_SIM_MAX_MUXES) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static sim_bus_t *sim_lookup(int fd) {
+    sim_bus_t *bus = NULL;
+
+    pthread_mutex_lock(&sim_table_lock);
+    for (int i = 0; i < I2C_MAX_BUSES; i++) {
+        if (sim_buses[i].fd == fd) {
+            bus = &sim_buses[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_table_lock);
+
+    return bus;
+}
+
+static void sim_reset_devices(sim_bus_t *bus) {
+    memset(bus->control, 0, sizeof(bus->control));
+    bus->pending_mask = 0;
+    for (int m = 0; m < I2C_SIM_MAX_MUXES; m++) {
+        for (int ch = 0; ch < I2C_SIM_CHANNELS; ch++) {
+            sim_sensor_t *s = &bus->sensors[m][ch];
+            memset(s, 0, sizeof(*s));
+            s->conf = SIM_CONF_SD0;                 // Power-on: shut down
+            s->light = sim_default_light(m, ch);
+        }
+    }
+}
+
+static int sim_open(const char *dev_path) {
+    i2c_sim_config_t cfg;
+    if (sim_parse_path(dev_path, &cfg) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* A real descriptor keeps fd numbers unique next to real buses */
+    int fd = eventfd(0, EFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sim_bus_t *bus = NULL;
+    pthread_mutex_lock(&sim_table_lock);
+    for (int i = 0; i < I2C_MAX_BUSES; i++) {
+        if (sim_buses[i].fd < 0) {
+            bus = &sim_buses[i];
+            bus->fd = fd;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_table_lock);
+
+    if (bus == NULL) {
+        close(fd);
+        errno = EMFILE;
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    bus->cfg = cfg;
+    bus->rng = cfg.seed;
+    memset(&bus->stats, 0, sizeof(bus->stats));
+    bus->hook = NULL;
+    bus->hook_user = NULL;
+    sim_reset_devices(bus);
+    pthread_mutex_unlock(&bus->lock);
+
+    return fd;
+}
+
+static void sim_close(int fd) {
+    pthread_mutex_lock(&sim_table_lock);
+    for (int i = 0; i < I2C_MAX_BUSES; i++) {
+        if (sim_buses[i].fd == fd) {
+            sim_buses[i].fd = -1;
+        }
+    }
+    pthread_mutex_unlock(&sim_table_lock);
+
+    close(fd);
+}
+
+static float sim_it_ms(uint16_t conf) {
+    return 50.0f * (float)(1u << ((conf >> 4) & 0x3));
+}
+
+static float sim_gain(uint16_t conf) {
+    static const float gain[4] = { 1.0f, 2.0f, 4.0f, 0.5f };
+    static const float dg[4] = { 1.0f, 2.0f, 4.0f, 1.0f };
+    float sens = ((conf >> 6) & 0x1) ? (1.0f / 3.0f) : 1.0f;
+    return gain[(conf >> 10) & 0x3] * dg[(conf >> 12) & 0x3] * sens;
+}
+
+static uint16_t sim_counts(float rate, uint16_t conf) {
+    float counts = rate * sim_it_ms(conf) * sim_gain(conf);
+    if (counts >= 65535.0f) {
+        return 65535;               // Saturated
+    }
+    return (uint16_t)counts;
+}
+
+/* Latch the result of every integration cycle completed since the last look */
+static void sim_sensor_update(sim_sensor_t *s, uint64_t now_ns) {
+    if (s->conf & SIM_CONF_SD0) {
+        return;                     // Shut down: data registers frozen
+    }
+
+    uint64_t it_ns = (uint64_t)(sim_it_ms(s->conf) * 1000000.0f);
+    uint64_t cycles = (now_ns - s->start_ns) / it_ns;
+    if (cycles > s->latched_cycle) {
+        s->data[0] = sim_counts(s->light.clear, s->conf);
+        s->data[1] = sim_counts(s->light.red, s->conf);
+        s->data[2] = sim_counts(s->light.green, s->conf);
+        s->data[3] = sim_counts(s->light.blue, s->conf);
+        s->latched_cycle = cycles;
+    }
+}
+
+static uint16_t sim_sensor_reg(const sim_sensor_t *s, uint8_t reg) {
+    if (reg == SIM_REG_CONF) {
+        return s->conf;
+    }
+    if (reg >= SIM_REG_CLEAR && reg <= SIM_REG_BLUE) {
+        return s->data[reg - SIM_REG_CLEAR];
+    }
+    if (reg == SIM_REG_ID) {
+        return I2C_SIM_DEVICE_ID;
+    }
+    return 0;                       // IR and reserved registers
+}
+
+/* Sensors currently connected to the upstream bus through any mux */
+static int sim_targets(sim_bus_t *bus, sim_sensor_t **targets) {
+    int n = 0;
+    for (int m = 0; m < bus->cfg.num_muxes; m++) {
+        uint8_t routed = bus->control[m] & bus->cfg.present[m];
+        for (int ch = 0; ch < I2C_SIM_CHANNELS; ch++) {
+            if (routed & (1u << ch)) {
+                targets[n++] = &bus->sensors[m][ch];
+            }
+        }
+    }
+    return n;
+}
+
+static int sim_message(sim_bus_t *bus, i2c_xfer_msg_t *msg, uint64_t now_ns) {
+    int is_read = (msg->flags & I2C_XFER_RD) != 0;
+
+    /* Multiplexers */
+    if (msg->addr >= I2C_SIM_MUX_BASE && msg->addr < I2C_SIM_MUX_BASE + bus->cfg.num_muxes) {
+        /* The control register is written at once, but like a real TCA9548A
+           the channels only switch on the STOP that ends the transfer */
+        int m = msg->addr - I2C_SIM_MUX_BASE;
+        for (int i = 0; i < msg->len; i++) {
+            if (is_read) {
+                msg->buf[i] = (bus->pending_mask & (1u << m)) ? bus->pending[m] : bus->control[m];
+            } else {
+                bus->pending[m] = msg->buf[i];
+                bus->pending_mask |= (uint8_t)(1u << m);
+            }
+        }
+        return 0;
+    }
+
+    if (msg->addr != I2C_SIM_SENSOR_ADDR) {
+        return -1;                  // Nobody answers
+    }
+
+    sim_sensor_t *targets[I2C_SIM_MAX_MUXES * I2C_SIM_CHANNELS];
+    int n = sim_targets(bus, targets);
+    if (n == 0) {
+        return -1;
+    }
+
+    if (!is_read) {
+        for (int t = 0; t < n; t++) {
+            sim_sensor_t *s = targets[t];
+            if (msg->len >= 1) {
+                s->reg_ptr = msg->buf[0];
+            }
+            if (msg->len >= 3 && s->reg_ptr == SIM_REG_CONF) {
+                sim_sensor_update(s, now_ns);
+                s->conf = (uint16_t)(msg->buf[1] | (msg->buf[2] << 8));
+                s->start_ns = now_ns;       // Integration restarts
+                s->latched_cycle = 0;
+            }
+        }
+        return 0;
+    }
+
+    /* Several sensors answering at once: open-drain bus, so bits AND together */
+    for (int i = 0; i < msg->len; i++) {
+        msg->buf[i] = 0xFF;
+    }
+    for (int t = 0; t < n; t++) {
+        sim_sensor_t *s = targets[t];
+        sim_sensor_update(s, now_ns);
+        uint16_t value = sim_sensor_reg(s, s->reg_ptr);
+        for (int i = 0; i < msg->len; i++) {
+            uint8_t byte = (i & 1) ? (uint8_t)(value >> 8) : (uint8_t)(value & 0xFF);
+            msg->buf[i] &= byte;
+        }
+    }
+
+    return 0;
+}
+
+/* STOP condition: muxes written during the transfer switch their channels */
+static void sim_stop(sim_bus_t *bus) {
+    for (int m = 0; m < I2C_SIM_MAX_MUXES; m++) {
+        if (bus->pending_mask & (1u << m)) {
+            bus->control[m] = bus->pending[m];
+        }
+    }
+    bus->pending_mask = 0;
+}
+
+static int sim_transfer(int fd, i2c_xfer_msg_t *msgs, int num_msgs) {
+    sim_bus_t *bus = sim_lookup(fd);
+    if (bus == NULL || msgs == NULL || num_msgs <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    if (bus->hook != NULL) {
+        i2c_sim_hook_t hook = bus->hook;
+        void *user = bus->hook_user;
+        pthread_mutex_unlock(&bus->lock);
+        hook(fd, user);
+        pthread_mutex_lock(&bus->lock);
+    }
+
+    uint64_t bytes = 0;
+    for (int i = 0; i < num_msgs; i++) {
+        bytes += (uint64_t)msgs[i].len + 1;        // address byte + payload
+    }
+
+    bus->stats.transfers++;
+    bus->stats.messages += (uint64_t)num_msgs;
+    bus->stats.bytes += bytes;
+
+    /* The bus is busy for the whole transfer */
+    sim_delay_us(bus->cfg.latency_us + bytes * bus->cfg.byte_us);
+
+    if (bus->cfg.nack_probability > 0.0f &&
+        (float)rand_r(&bus->rng) / (float)RAND_MAX < bus->cfg.nack_probability) {
+        bus->stats.nacks++;
+        pthread_mutex_unlock(&bus->lock);
+        errno = EREMOTEIO;
+        return -1;
+    }
+
+    uint64_t now_ns = sim_now_ns();
+    for (int i = 0; i < num_msgs; i++) {
+        if (sim_message(bus, &msgs[i], now_ns) < 0) {
+            bus->stats.nacks++;
+            sim_stop(bus);          // The adapter still ends the transfer with a STOP
+            pthread_mutex_unlock(&bus->lock);
+            errno = EREMOTEIO;      // What i2c-bcm2835 reports for a NACK
+            return -1;
+        }
+    }
+
+    sim_stop(bus);
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+int i2c_sim_configure(int fd, const i2c_sim_config_t *cfg) {
+    sim_bus_t *bus = sim_lookup(fd);
+    if (bus == NULL || cfg == NULL || cfg->num_muxes < 1 || cfg->num_muxes > I2C_SIM_MAX_MUXES) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    bus->cfg = *cfg;
+    bus->rng = cfg->seed;
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+int i2c_sim_set_light(int fd, int mux, int channel, const i2c_sim_light_t *light) {
+    sim_bus_t *bus = sim_lookup(fd);
+    if (bus == NULL || light == NULL || mux < 0 || mux >= I2C_SIM_MAX_MUXES ||
+        channel < 0 || channel >= I2C_SIM_CHANNELS) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    bus->sensors[mux][channel].light = *light;
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+int i2c_sim_get_stats(int fd, i2c_sim_stats_t *out) {
+    sim_bus_t *bus = sim_lookup(fd);
+    if (bus == NULL || out == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    *out = bus->stats;
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+int i2c_sim_reset_stats(int fd) {
+    sim_bus_t *bus = sim_lookup(fd);
+    if (bus == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    memset(&bus->stats, 0, sizeof(bus->stats));
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+int i2c_sim_set_hook(int fd, i2c_sim_hook_t hook, void *user) {
+    sim_bus_t *bus = sim_lookup(fd);
+    if (bus == NULL) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&bus->lock);
+    bus->hook = hook;
+    bus->hook_user = user;
+    pthread_mutex_unlock(&bus->lock);
+    return 0;
+}
+
+static const i2c_backend_t sim_backend = {
+    .name = "simulated",
+    .open = sim_open,
+    .close = sim_close,
+    .transfer = sim_transfer
+};
+
+void i2c_sim_register(void) {
+    (void)i2c_register_backend(I2C_SIM_PREFIX, &sim_backend);
+}
+
+/* Linking the simulator is enough to make "sim:" paths available */
+__attribute__((constructor))
+static void i2c_sim_auto_register(void) {
+    i2c_sim_register();
+}
@@ -0,0 +1,82 @@
+#ifndef I2C_SIM_H
+#define I2C_SIM_H
+
+#include <stdint.h>
+
+/*
+ * Simulated I2C bus: up to eight TCA9548A multiplexers (0x70..0x77), each
+ * with a VEML3328 (0x10) behind every downstream channel. Linking i2c_sim.c
+ * registers the backend for device paths starting with "sim:", so a program
+ * that takes a bus path can run without hardware. Only the tests, the
+ * benchmark and the "make sim" builds link it:
+ *
+ *   sim:                         one mux, eight sensors, no bus latency
+ *   sim:muxes=2,latency_us=80    options are comma separated key=value pairs
+ *
+ * Options: muxes, present (mask of populated channels per mux), latency_us
+ * (fixed cost per transfer), byte_us (cost per transferred byte, ~90 at
+ * 100 kHz), nack (probability of a NACK per transfer), seed.
+ *
+ * As on the real TCA9548A, a mux write only switches channels at the STOP
+ * ending its transfer: later messages of the same transfer still reach the
+ * previously routed channels.
+ */
+
+#define I2C_SIM_PREFIX          "sim:"
+#define I2C_SIM_MAX_MUXES       8
+#define I2C_SIM_CHANNELS        8
+#define I2C_SIM_MUX_BASE        0x70
+#define I2C_SIM_SENSOR_ADDR     0x10
+#define I2C_SIM_DEVICE_ID       0x28        // VEML3328 ID register (0x0C) content
+
+/* Light seen by one sensor, in counts per ms of integration at 1x gain,
+   1x digital gain and high sensitivity */
+typedef struct {
+    float clear;
+    float red;
+    float green;
+    float blue;
+} i2c_sim_light_t;
+
+typedef struct {
+    int num_muxes;                                  // 1..I2C_SIM_MAX_MUXES
+    uint8_t present[I2C_SIM_MAX_MUXES];             // populated channels per mux
+    uint32_t latency_us;                            // fixed cost per transfer
+    uint32_t byte_us;                               // cost per transferred byte
+    float nack_probability;                         // 0..1, per transfer
+    unsigned int seed;                              // NACK injection PRNG seed
+} i2c_sim_config_t;
+
+/* Transfer statistics of one simulated bus */
+typedef struct {
+    uint64_t transfers;         // combined transactions (ioctl equivalents)
+    uint64_t messages;
+    uint64_t bytes;
+    uint64_t nacks;             // failed transfers (absent device or injected)
+} i2c_sim_stats_t;
+
+/* Called at the start of every transfer of a bus, before the transfer takes
+   the bus (tests use it to hold or synchronise bus threads) */
+typedef void (*i2c_sim_hook_t)(int fd, void *user);
+
+/* Register the "sim:" backend (done automatically at program start) */
+void i2c_sim_register(void);
+
+/* Defaults used for a bare "sim:" path */
+void i2c_sim_default_config(i2c_sim_config_t *cfg);
+
+/* Replace the configuration of an open simulated bus. Returns 0, or -1 if 'fd' is not simulated. */
+int i2c_sim_configure(int fd, const i2c_sim_config_t *cfg);
+
+/* Set the light source seen by the sensor at (mux index, channel) */
+int i2c_sim_set_light(int fd, int mux, int channel, const i2c_sim_light_t *light);
+
+/* Statistics since open (or the last reset) */
+int i2c_sim_get_stats(int fd, i2c_sim_stats_t *out);
+
+int i2c_sim_reset_stats(int fd);
+
+/* Install (or with NULL remove) the transfer hook of a simulated bus; cleared on open */
+int i2c_sim_set_hook(int fd, i2c_sim_hook_t hook, void *user);
+
+#endif // I2C_SIM_H
@@ -0,0 +1,252 @@
+#include "log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+/* Bounded multi-producer ring: a slot is free for ticket t when seq == t and
+   holds the record of ticket t once seq == t + 1 */
+typedef struct {
+    atomic_uint_fast64_t seq;
+    log_record_t rec;
+} log_slot_t;
+
+static log_slot_t ring[LOG_RING_SIZE];
+static atomic_uint_fast64_t head;               // next ticket to write
+static uint64_t tail;                           // next ticket to read (single consumer)
+static atomic_uint_fast64_t dropped;
+
+atomic_int log_runtime_level = LOG_WARN;
+
+static const char *const level_names[] = { "ERROR", "WARN", "INFO", "DEBUG" };
+
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drain_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t drain_thread;
+static int drain_running = 0;
+static int drain_stop = 0;
+static FILE *drain_out = NULL;
+static atomic_int opened;                       // log_open() was called once
+static uint64_t drain_reported;                 // drops already written out
+static pthread_once_t auto_once = PTHREAD_ONCE_INIT;
+
+__attribute__((constructor))
+static void log_setup(void) {
+    for (uint64_t i = 0; i < LOG_RING_SIZE; i++) {
+        atomic_init(&ring[i].seq, i);
+    }
+
+    const char *env = getenv("LOG_LEVEL");
+    if (env == NULL) {
+        return;
+    }
+    for (int level = LOG_ERROR; level <= LOG_DEBUG; level++) {
+        if (strcasecmp(env, level_names[level]) == 0) {
+            atomic_store(&log_runtime_level, level);
+            return;
+        }
+    }
+    if (env[0] >= '0' && env[0] <= '3' && env[1] == '\0') {
+        atomic_store(&log_runtime_level, env[0] - '0');
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void auto_open(void) {
+    if (!atomic_load(&opened)) {
+        (void)log_open(getenv("LOG_FILE"));
+    }
+}
+
+void log_emit(int level, const char *msg, int err, int bus, int addr, int channel, int64_t value) {
+    if (!atomic_load_explicit(&opened, memory_order_relaxed)) {
+        pthread_once(&auto_once, auto_open);
+    }
+
+    uint64_t pos = atomic_load_explicit(&head, memory_order_relaxed);
+    log_slot_t *slot;
+    for (;;) {
+        slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);     // full
+            return;
+        } else {
+            pos = atomic_load_explicit(&head, memory_order_relaxed);
+        }
+    }
+
+    slot->rec = (log_record_t){
+        .timestamp_ns = now_ns(),
+        .msg = msg,
+        .value = value,
+        .err = err,
+        .bus = (int16_t)bus,
+        .channel = (int16_t)channel,
+        .level = (uint8_t)level,
+        .addr = (uint8_t)addr
+    };
+    atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+}
+
+int log_pop(log_record_t *out) {
+    log_slot_t *slot = &ring[tail & (LOG_RING_SIZE - 1)];
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != tail + 1) {
+        return 0;
+    }
+
+    *out = slot->rec;
+    atomic_store_explicit(&slot->seq, tail + LOG_RING_SIZE, memory_order_release);
+    tail++;
+    return 1;
+}
+
+uint64_t log_dropped(void) {
+    return atomic_load(&dropped);
+}
+
+int log_set_level(int level) {
+    if (level < LOG_ERROR) {
+        level = LOG_ERROR;
+    } else if (level > LOG_DEBUG) {
+        level = LOG_DEBUG;
+    }
+    return atomic_exchange(&log_runtime_level, level);
+}
+
+int log_format(const log_record_t *rec, char *buf, size_t len) {
+    int n = snprintf(buf, len, "[%llu.%06llu] %s %s",
+                     (unsigned long long)(rec->timestamp_ns / 1000000000ull),
+                     (unsigned long long)(rec->timestamp_ns % 1000000000ull / 1000ull),
+                     level_names[rec->level <= LOG_DEBUG ? rec->level : LOG_DEBUG],
+                     rec->msg != NULL ? rec->msg : "");
+
+    /* Only the fields the event has */
+    if (rec->bus >= 0 && n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - (size_t)n, " bus=%d", rec->bus);
+    }
+    if (rec->addr != 0 && n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - (size_t)n, " addr=0x%02x", rec->addr);
+    }
+    if (rec->channel >= 0 && n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - (size_t)n, " sensor=%d", rec->channel);
+    }
+    if (rec->value != 0 && n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - (size_t)n, " value=%lld", (long long)rec->value);
+    }
+    if (rec->err != 0 && n >= 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - (size_t)n, ": %s", strerror(rec->err));
+    }
+    return n;
+}
+
+/* Write every queued record to 'out'; called with drain_lock held */
+static void drain_locked(FILE *out) {
+    log_record_t rec;
+    char line[256];
+    while (log_pop(&rec)) {
+        log_format(&rec, line, sizeof(line));
+        fprintf(out, "%s\n", line);
+    }
+
+    uint64_t lost = log_dropped();
+    if (lost != drain_reported) {
+        fprintf(out, "%llu log record(s) dropped\n", (unsigned long long)(lost - drain_reported));
+        drain_reported = lost;
+    }
+    fflush(out);
+}
+
+static void *drain_main(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&drain_lock);
+    while (!drain_stop) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += LOG_DRAIN_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        (void)pthread_cond_timedwait(&drain_wake, &drain_lock, &ts);
+        drain_locked(drain_out);
+    }
+    drain_locked(drain_out);
+    pthread_mutex_unlock(&drain_lock);
+
+    return NULL;
+}
+
+int log_open(const char *path) {
+    static int exit_hook = 0;
+
+    log_close();
+
+    pthread_mutex_lock(&drain_lock);
+    atomic_store(&opened, 1);
+
+    FILE *out = stderr;
+    if (path != NULL && path[0] != '\0') {
+        out = fopen(path, "a");
+        if (out == NULL) {
+            pthread_mutex_unlock(&drain_lock);
+            return -1;
+        }
+    }
+
+    drain_out = out;
+    drain_stop = 0;
+    if (pthread_create(&drain_thread, NULL, drain_main, NULL) != 0) {
+        if (out != stderr) {
+            fclose(out);
+        }
+        drain_out = NULL;
+        pthread_mutex_unlock(&drain_lock);
+        return -1;
+    }
+    drain_running = 1;
+
+    /* Whatever is queued at exit still gets written */
+    if (!exit_hook) {
+        exit_hook = 1;
+        atexit(log_close);
+    }
+    pthread_mutex_unlock(&drain_lock);
+    return 0;
+}
+
+void log_close(void) {
+    pthread_mutex_lock(&drain_lock);
+    if (!drain_running) {
+        pthread_mutex_unlock(&drain_lock);
+        return;
+    }
+    drain_stop = 1;
+    pthread_cond_signal(&drain_wake);
+    pthread_mutex_unlock(&drain_lock);
+
+    pthread_join(drain_thread, NULL);
+
+    pthread_mutex_lock(&drain_lock);
+    drain_running = 0;
+    if (drain_out != NULL && drain_out != stderr) {
+        fclose(drain_out);
+    }
+    drain_out = NULL;
+    pthread_mutex_unlock(&drain_lock);
+}
@@ -0,0 +1,84 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+/*
+ * Logging for code that runs inside the sampling loop. A log call only
+ * fills a fixed-size binary record (no formatting, no I/O) and pushes it
+ * into a lock-free ring; a background thread formats the records and writes
+ * them to stderr or a file. When the ring is full new records are dropped
+ * and counted rather than blocking the caller.
+ *
+ * Levels are filtered twice: calls above LOG_COMPILE_LEVEL compile to
+ * nothing, the rest are checked against the runtime level (LOG_LEVEL
+ * environment variable: error, warn, info, debug or 0..3; default warn).
+ */
+
+#define LOG_ERROR   0
+#define LOG_WARN    1
+#define LOG_INFO    2
+#define LOG_DEBUG   3
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL   LOG_DEBUG
+#endif
+
+#define LOG_RING_SIZE       1024                // records, power of two
+#define LOG_DRAIN_MS        50                  // drain thread period
+
+/* One log event. 'msg' must be a string literal (only the pointer is kept). */
+typedef struct {
+    uint64_t timestamp_ns;                      // CLOCK_MONOTONIC
+    const char *msg;
+    int64_t value;                              // event specific (length, count...)
+    int32_t err;                                // errno, 0 if none
+    int16_t bus;                                // bus fd, -1 if none
+    int16_t channel;                            // sensor index, -1 if none
+    uint8_t level;
+    uint8_t addr;                               // 7-bit device address, 0 if none
+} log_record_t;
+
+extern atomic_int log_runtime_level;
+
+/* Push one record (use the LOG_* macros, which filter by level first) */
+void log_emit(int level, const char *msg, int err, int bus, int addr, int channel, int64_t value);
+
+#define LOG_AT(level, msg, err, bus, addr, channel, value)                                  \
+    do {                                                                                    \
+        if ((level) <= LOG_COMPILE_LEVEL &&                                                 \
+            (level) <= atomic_load_explicit(&log_runtime_level, memory_order_relaxed)) {    \
+            log_emit((level), (msg), (err), (bus), (addr), (channel), (value));             \
+        }                                                                                   \
+    } while (0)
+
+#define LOG_E(msg, err, bus, addr, channel, value)  LOG_AT(LOG_ERROR, msg, err, bus, addr, channel, value)
+#define LOG_W(msg, err, bus, addr, channel, value)  LOG_AT(LOG_WARN, msg, err, bus, addr, channel, value)
+#define LOG_I(msg, err, bus, addr, channel, value)  LOG_AT(LOG_INFO, msg, err, bus, addr, channel, value)
+#define LOG_D(msg, err, bus, addr, channel, value)  LOG_AT(LOG_DEBUG, msg, err, bus, addr, channel, value)
+
+/* Runtime level; returns the previous one */
+int log_set_level(int level);
+
+/*
+ * Send the records to 'path' (appended; NULL: stderr) from a drain thread.
+ * Started on the first record otherwise, with LOG_FILE as the path.
+ * Returns 0, or -1 if the file or the thread cannot be created.
+ */
+int log_open(const char *path);
+
+/* Stop the drain thread, write what is left and close the file */
+void log_close(void);
+
+/* Pop one record; 0 if the ring is empty. For the drain thread and tests. */
+int log_pop(log_record_t *out);
+
+/* Format one record as a single line (no newline). Returns the length. */
+int log_format(const log_record_t *rec, char *buf, size_t len);
+
+/* Records dropped because the ring was full */
+uint64_t log_dropped(void);
+
+#endif // LOG_H
@@ -4,11 +4,11 @@
 #include "i2c_driver_pi.h"
 #include "veml3328.h"
 #include "tca9548a.h"
+#include "topology.h"
+#include "sweep.h"
 
 #define I2C_DEV_PATH    "/dev/i2c-1"  // verificar na Raspberry com o comando "ls /dev/i2c* "
-#define TCA9548A_ADDR   0x70
 #define VEML3328_ADDR   VEML3328_I2C_ADDR
-#define NUM_CHANNELS    8
 
 /* Config used for normalization */
 static const veml3328_cfg_t default_cfg = {
@@ -20,42 +20,62 @@ static const veml3328_cfg_t default_cfg = {
     .dark_offset = 0
 };
 
-int main(void) {
+int main(int argc, char *argv[]) {
+    /* Bus path may be overridden, e.g. "sim:" to run without hardware */
+    const char *bus_path = argc >= 2 ? argv[1] : I2C_DEV_PATH;
+    /* Mux addresses, e.g. "0x70,0x71" or "auto" (default: one mux at 0x70) */
+    const char *mux_spec = argc >= 3 ? argv[2] : NULL;
+
     /* Open I2C bus on the Pi */
-    int fd = i2c_open_bus(I2C_DEV_PATH);
+    int fd = i2c_open_bus(bus_path);
     if (fd < 0) {
-        fprintf(stderr, "Failed to open %s bus\n", I2C_DEV_PATH);
+        fprintf(stderr, "Failed to open %s bus\n", bus_path);
         return 1;
     }
 
-    printf("I2C bus opened on %s (fd = %d)\n", I2C_DEV_PATH, fd);
+    printf("I2C bus opened on %s (fd = %d)\n", bus_path, fd);
 
-    /* Loop over all mux channels */
-    for (int channel = 0; channel < NUM_CHANNELS; channel++) {
-        
-        /* Select channel TCA9548A */
-        if (tca_select_channel(fd, TCA9548A_ADDR, channel) != TCA_OK) {
-            fprintf(stderr, "Failed to select TCA9548A channel %d\n", channel);
-            continue;
-        }
+    topo_t topo;
+    if (topo_from_spec(&topo, fd, mux_spec) != TOPO_OK) {
+        fprintf(stderr, "No TCA9548A found for '%s'\n", mux_spec != NULL ? mux_spec : "0x70");
+        i2c_close_bus(fd);
+        return 1;
+    }
 
-        /* Configure VEML3328 on this channel */
-        if (veml3328_config(fd, VEML3328_ADDR) != VEML3328_OK) {
-            fprintf(stderr, "Failed to configure VEML3328 on channel %d\n", channel);
-            continue;
-        }
+    /* Every sensor answers at the same address: the sweep routes one at a time */
+    sweep_ctx_t ctx;
+    sweep_init_topology(&ctx, fd, &topo, VEML3328_ADDR);
 
-        /* Read raw data from VEML3328 */
-        veml3328_raw_data_t raw_data;
-        if (veml3328_read_all(fd, VEML3328_ADDR, &raw_data) != VEML3328_OK) {
-            fprintf(stderr, "Failed to read data from VEML3328 on channel %d\n", channel);
+    /* Configure every sensor, wait until the first integration is complete, then read them all */
+    int num_sensors = topo_num_sensors(&topo);
+    uint64_t mask = topo_all_sensors(&topo);
+    veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    for (int sensor = 0; sensor < num_sensors; sensor++) {
+        cfg[sensor] = default_cfg;
+    }
+
+    if (sweep_run_sensors(&ctx, mask, cfg, raw, NULL, &done) != SWEEP_OK) {
+        fprintf(stderr, "Failed to sweep the sensors\n");
+    }
+
+    /* Loop over all channels of every mux */
+    for (int sensor = 0; sensor < num_sensors; sensor++) {
+        uint8_t mux_addr;
+        int channel;
+        topo_sensor_location(&topo, sensor, &mux_addr, &channel);
+
+        if (!(done & (1ull << sensor))) {
+            fprintf(stderr, "Failed to read data from VEML3328 on mux 0x%02x channel %d\n", mux_addr, channel);
             continue;
         }
 
         /* Compute relative RGB */
-        veml3328_norm_rgb_t norm = veml3328_norm_colour(&raw_data, &default_cfg);
+        veml3328_norm_rgb_t norm = veml3328_norm_colour(&raw[sensor], &default_cfg);
 
-        printf("Channel %d - R: %.3f, G: %.3f, B: %.3f, Intensity: %u counts, Irradiance: %.3f µW/cm², Wavelength: %.1f nm\n",
+        printf("Mux 0x%02x channel %d - R: %.3f, G: %.3f, B: %.3f, Intensity: %u counts, Irradiance: %.3f µW/cm², Wavelength: %.1f nm\n",
+               mux_addr,
                channel,
                norm.red,
                norm.green,
@@ -65,6 +85,8 @@ int main(void) {
                norm.wavelength);
     }
 
+    (void)sweep_disable_all(&ctx);
+
     /* Close bus */
     i2c_close_bus(fd);
     return EXIT_SUCCESS;
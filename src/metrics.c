@@ -0,0 +1,181 @@
+#include "metrics.h"
+
+#include <stddef.h>
+#include <time.h>
+
+typedef struct {
+    atomic_uint_fast64_t counts[METRICS_BUCKETS];
+    atomic_uint_fast64_t sum_ns;
+    atomic_uint_fast64_t max_ns;
+} metrics_hist_t;
+
+typedef struct {
+    atomic_uint_fast64_t samples;
+    atomic_uint_fast64_t errors;
+    atomic_uint_fast64_t saturated;
+} metrics_counters_t;
+
+static metrics_hist_t latencies[METRICS_NUM_LATENCIES];
+static metrics_counters_t channels[METRICS_MAX_CHANNELS];
+
+static const char *const latency_names[METRICS_NUM_LATENCIES] = {
+    "i2c_write_read", "i2c_transfer", "veml3328_read_all", "mux_select", "sweep"
+};
+
+uint64_t metrics_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int metrics_bucket_index(uint64_t ns) {
+    if (ns < 2 * METRICS_SUB_BUCKETS) {
+        return (int)ns;                 // one bucket per value
+    }
+
+    int msb = 63 - __builtin_clzll(ns);
+    if (msb >= METRICS_MAX_BITS) {
+        return METRICS_BUCKETS - 1;
+    }
+
+    /* Top METRICS_SUB_BITS + 1 bits pick the bucket inside the power of two */
+    int shift = msb - METRICS_SUB_BITS;
+    return (shift + 1) * METRICS_SUB_BUCKETS + (int)(ns >> shift) - METRICS_SUB_BUCKETS;
+}
+
+uint64_t metrics_bucket_upper_ns(int index) {
+    if (index < 2 * METRICS_SUB_BUCKETS) {
+        return index < 0 ? 0 : (uint64_t)index;
+    }
+    if (index >= METRICS_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+
+    int shift = index / METRICS_SUB_BUCKETS - 1;
+    uint64_t top = (uint64_t)(METRICS_SUB_BUCKETS + index % METRICS_SUB_BUCKETS);
+    return ((top + 1) << shift) - 1;
+}
+
+const char *metrics_latency_name(int metric) {
+    if (metric < 0 || metric >= METRICS_NUM_LATENCIES) {
+        return NULL;
+    }
+    return latency_names[metric];
+}
+
+void metrics_record(int metric, uint64_t ns) {
+    if (metric < 0 || metric >= METRICS_NUM_LATENCIES) {
+        return;
+    }
+
+    metrics_hist_t *hist = &latencies[metric];
+    atomic_fetch_add_explicit(&hist->counts[metrics_bucket_index(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sum_ns, ns, memory_order_relaxed);
+
+    uint64_t max = atomic_load_explicit(&hist->max_ns, memory_order_relaxed);
+    while (ns > max &&
+           !atomic_compare_exchange_weak_explicit(&hist->max_ns, &max, ns,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+        // max reloaded by the failed exchange
+    }
+}
+
+int metrics_snapshot(int metric, metrics_snapshot_t *out) {
+    if (out == NULL || metric < 0 || metric >= METRICS_NUM_LATENCIES) {
+        return -1;
+    }
+
+    /* Not atomic as a whole; count is derived from the copied buckets so the
+       snapshot is at least self-consistent */
+    metrics_hist_t *hist = &latencies[metric];
+    out->count = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        out->counts[i] = atomic_load_explicit(&hist->counts[i], memory_order_relaxed);
+        out->count += out->counts[i];
+    }
+    out->sum_ns = atomic_load_explicit(&hist->sum_ns, memory_order_relaxed);
+    out->max_ns = atomic_load_explicit(&hist->max_ns, memory_order_relaxed);
+    return 0;
+}
+
+uint64_t metrics_quantile_ns(const metrics_snapshot_t *snap, double q) {
+    if (snap == NULL || snap->count == 0) {
+        return 0;
+    }
+
+    if (q < 0.0) {
+        q = 0.0;
+    } else if (q > 1.0) {
+        q = 1.0;
+    }
+
+    /* Rank of the value wanted, 1-based */
+    uint64_t rank = (uint64_t)(q * (double)snap->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        seen += snap->counts[i];
+        if (seen >= rank) {
+            uint64_t upper = metrics_bucket_upper_ns(i);
+            return upper < snap->max_ns ? upper : snap->max_ns;
+        }
+    }
+    return snap->max_ns;
+}
+
+uint64_t metrics_count_le(const metrics_snapshot_t *snap, uint64_t ns) {
+    if (snap == NULL) {
+        return 0;
+    }
+
+    uint64_t count = 0;
+    for (int i = 0; i < METRICS_BUCKETS && metrics_bucket_upper_ns(i) <= ns; i++) {
+        count += snap->counts[i];
+    }
+    return count;
+}
+
+void metrics_count_sweep(uint64_t read, uint64_t failed, uint64_t saturated) {
+    for (int i = 0; i < METRICS_MAX_CHANNELS; i++) {
+        uint64_t bit = 1ull << i;
+        if (read & bit) {
+            atomic_fetch_add_explicit(&channels[i].samples, 1, memory_order_relaxed);
+            if (saturated & bit) {
+                atomic_fetch_add_explicit(&channels[i].saturated, 1, memory_order_relaxed);
+            }
+        } else if (failed & bit) {
+            atomic_fetch_add_explicit(&channels[i].errors, 1, memory_order_relaxed);
+        }
+    }
+}
+
+metrics_channel_t metrics_channel(int channel) {
+    metrics_channel_t out = {0};
+    if (channel < 0 || channel >= METRICS_MAX_CHANNELS) {
+        return out;
+    }
+
+    out.samples = atomic_load_explicit(&channels[channel].samples, memory_order_relaxed);
+    out.errors = atomic_load_explicit(&channels[channel].errors, memory_order_relaxed);
+    out.saturated = atomic_load_explicit(&channels[channel].saturated, memory_order_relaxed);
+    return out;
+}
+
+void metrics_reset(void) {
+    for (int m = 0; m < METRICS_NUM_LATENCIES; m++) {
+        for (int i = 0; i < METRICS_BUCKETS; i++) {
+            atomic_store(&latencies[m].counts[i], 0);
+        }
+        atomic_store(&latencies[m].sum_ns, 0);
+        atomic_store(&latencies[m].max_ns, 0);
+    }
+
+    for (int i = 0; i < METRICS_MAX_CHANNELS; i++) {
+        atomic_store(&channels[i].samples, 0);
+        atomic_store(&channels[i].errors, 0);
+        atomic_store(&channels[i].saturated, 0);
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+/*
+ * Process-wide latency histograms and per-sensor counters. Recording is a
+ * few relaxed atomic adds, so it can stay on in the sampling loop and be
+ * called from every bus thread at once.
+ *
+ * Histograms are HDR-style (log-linear): each power of two of nanoseconds
+ * is split into METRICS_SUB_BUCKETS linear buckets, so any value is kept
+ * within 1/16 (6.25%) from 1 ns up to ~68 s with a fixed 528 buckets.
+ */
+
+/* Latency histograms */
+#define METRIC_I2C_WRITE_READ   0       // i2c_write_read()
+#define METRIC_I2C_TRANSFER     1       // i2c_transfer(): combined transactions of compiled sweeps
+#define METRIC_VEML_READ_ALL    2       // veml3328_read_all() in a sweep
+#define METRIC_MUX_SELECT       3       // mux control writes (skipped cached writes are not counted)
+#define METRIC_SWEEP            4       // one sweep of one bus, integration wait included
+#define METRICS_NUM_LATENCIES   5
+
+#define METRICS_SUB_BITS        4
+#define METRICS_SUB_BUCKETS     (1 << METRICS_SUB_BITS)
+#define METRICS_MAX_BITS        36      // values from 2^36 ns (~68 s) on share the last bucket
+#define METRICS_BUCKETS         ((METRICS_MAX_BITS - METRICS_SUB_BITS + 1) * METRICS_SUB_BUCKETS)
+
+#define METRICS_MAX_CHANNELS    64      // sensor indices, as in the 64-bit sensor masks
+
+/* Copy of one histogram at some instant */
+typedef struct {
+    uint64_t counts[METRICS_BUCKETS];
+    uint64_t count;                     // sum of counts[]
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} metrics_snapshot_t;
+
+/* Counters of one sensor */
+typedef struct {
+    uint64_t samples;                   // successful reads
+    uint64_t errors;                    // failed reads (isolated sensors are not read)
+    uint64_t saturated;                 // reads with a channel clipped at full scale
+} metrics_channel_t;
+
+/* CLOCK_MONOTONIC in nanoseconds */
+uint64_t metrics_now_ns(void);
+
+/* Add one latency to histogram 'metric' */
+void metrics_record(int metric, uint64_t ns);
+
+/* Time since 'start_ns' into histogram 'metric' */
+static inline void metrics_record_since(int metric, uint64_t start_ns) {
+    metrics_record(metric, metrics_now_ns() - start_ns);
+}
+
+/* Name of a histogram ("i2c_write_read"...), NULL past the last one */
+const char *metrics_latency_name(int metric);
+
+/* Bucket of a value, and the largest value that bucket holds */
+int metrics_bucket_index(uint64_t ns);
+uint64_t metrics_bucket_upper_ns(int index);
+
+/* Copy histogram 'metric'. Returns 0, or -1 if there is no such histogram. */
+int metrics_snapshot(int metric, metrics_snapshot_t *out);
+
+/* Value below which a fraction 'q' (0..1) of the snapshot falls, within one
+   bucket (never above max_ns); 0 if empty */
+uint64_t metrics_quantile_ns(const metrics_snapshot_t *snap, double q);
+
+/* Values of the snapshot in buckets that end at or below 'ns' */
+uint64_t metrics_count_le(const metrics_snapshot_t *snap, uint64_t ns);
+
+/* Count one sweep: 'read' is the mask of sensors read (with 'saturated' among
+   them), 'failed' the mask of sensors whose read failed */
+void metrics_count_sweep(uint64_t read, uint64_t failed, uint64_t saturated);
+
+/* Counters of sensor 'channel' (all zero if out of range) */
+metrics_channel_t metrics_channel(int channel);
+
+/* Clear every histogram and counter */
+void metrics_reset(void);
+
+#endif // METRICS_H
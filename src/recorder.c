@@ -0,0 +1,317 @@
+#include "recorder.h"
+#include "wire_frame.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+_Static_assert(sizeof(recorder_segment_t) == RECORDER_HEADER_SIZE, "segment header must fill RECORDER_HEADER_SIZE");
+
+static int is_segment(const struct dirent *entry) {
+    size_t len = strlen(entry->d_name);
+    size_t suffix = strlen(RECORDER_SUFFIX);
+    return len > suffix && strcmp(entry->d_name + len - suffix, RECORDER_SUFFIX) == 0;
+}
+
+/* Segment names sorted by time (zero-padded, so alphabetical order). Returns the count or -1. */
+static int list_segments(const char *dir, struct dirent ***names) {
+    return scandir(dir, names, is_segment, alphasort);
+}
+
+static void free_list(struct dirent **names, int n) {
+    for (int i = 0; i < n; i++) {
+        free(names[i]);
+    }
+    free(names);
+}
+
+static void drop_old_segments(recorder_t *rec) {
+    struct dirent **names;
+    int n = list_segments(rec->dir, &names);
+    if (n < 0) {
+        return;
+    }
+
+    for (int i = 0; i < n - rec->keep_segments; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", rec->dir, names[i]->d_name);
+        unlink(path);
+    }
+    free_list(names, n);
+}
+
+/* Trim the filled segment to its used size and unmap it */
+static void close_segment(recorder_t *rec) {
+    if (rec->segment == NULL) {
+        return;
+    }
+
+    uint64_t used = atomic_load(&rec->segment->used);
+    msync(rec->segment, rec->segment_size, MS_SYNC);
+    munmap(rec->segment, rec->segment_size);
+    if (ftruncate(rec->fd, (off_t)(RECORDER_HEADER_SIZE + used)) < 0) {
+        perror("Failed to trim recorder segment");
+    }
+    close(rec->fd);
+
+    rec->segment = NULL;
+    rec->fd = -1;
+}
+
+static int open_segment(recorder_t *rec, uint64_t first_ns) {
+    char path[512];
+    int fd = -1;
+
+    /* Name after the first frame; a clash (same ns) takes the next one */
+    for (uint64_t name_ns = first_ns; fd < 0; name_ns++) {
+        snprintf(path, sizeof(path), "%s/%020llu%s", rec->dir, (unsigned long long)name_ns, RECORDER_SUFFIX);
+        fd = open(path, O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0 && errno != EEXIST) {
+            perror("Failed to create recorder segment");
+            return RECORDER_ERR_IO;
+        }
+    }
+
+    /* Reserve the blocks up front so appends never extend the file */
+    if (posix_fallocate(fd, 0, (off_t)rec->segment_size) != 0 &&
+        ftruncate(fd, (off_t)rec->segment_size) < 0) {
+        perror("Failed to size recorder segment");
+        close(fd);
+        unlink(path);
+        return RECORDER_ERR_IO;
+    }
+
+    recorder_segment_t *seg = mmap(NULL, rec->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (seg == MAP_FAILED) {
+        perror("Failed to map recorder segment");
+        close(fd);
+        unlink(path);
+        return RECORDER_ERR_IO;
+    }
+
+    size_t data_size = rec->segment_size - RECORDER_HEADER_SIZE;
+    seg->version = RECORDER_VERSION;
+    seg->segment_size = rec->segment_size;
+    atomic_store(&seg->used, 0);
+    atomic_store(&seg->frames, 0);
+    seg->first_ns = first_ns;
+    atomic_store(&seg->last_ns, first_ns);
+    seg->index_stride = (uint32_t)((data_size + RECORDER_INDEX_MAX - 1) / RECORDER_INDEX_MAX);
+    atomic_store(&seg->index_count, 0);
+    atomic_thread_fence(memory_order_release);
+    seg->magic = RECORDER_MAGIC;
+
+    rec->segment = seg;
+    rec->fd = fd;
+    rec->segments++;
+
+    if (rec->keep_segments > 0) {
+        drop_old_segments(rec);
+    }
+    return RECORDER_OK;
+}
+
+int recorder_open(recorder_t *rec, const char *dir, size_t segment_size, int keep_segments) {
+    if (rec == NULL || dir == NULL || strlen(dir) >= sizeof(rec->dir) || keep_segments < 0) {
+        return RECORDER_ERR;
+    }
+    if (segment_size == 0) {
+        segment_size = RECORDER_SEGMENT_SIZE;
+    }
+    if (segment_size < RECORDER_HEADER_SIZE + WIRE_FRAME_MAX_SIZE) {
+        return RECORDER_ERR;
+    }
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        perror("Failed to create recording directory");
+        return RECORDER_ERR_IO;
+    }
+
+    memset(rec, 0, sizeof(*rec));
+    strcpy(rec->dir, dir);
+    rec->segment_size = segment_size;
+    rec->keep_segments = keep_segments;
+    rec->segment = NULL;
+    rec->fd = -1;
+    return RECORDER_OK;
+}
+
+int recorder_append(recorder_t *rec, const acq_frame_t *frame) {
+    if (rec == NULL || frame == NULL) {
+        return RECORDER_ERR;
+    }
+
+    size_t size = wire_frame_size(frame->channel_mask);
+    size_t data_size = rec->segment_size - RECORDER_HEADER_SIZE;
+    if (rec->segment != NULL && atomic_load(&rec->segment->used) + size > data_size) {
+        close_segment(rec);
+    }
+    if (rec->segment == NULL) {
+        int ret = open_segment(rec, frame->wall_ns);
+        if (ret != RECORDER_OK) {
+            return ret;
+        }
+    }
+
+    recorder_segment_t *seg = rec->segment;
+    uint64_t offset = atomic_load_explicit(&seg->used, memory_order_relaxed);
+    uint8_t *data = (uint8_t *)seg + RECORDER_HEADER_SIZE;
+    if (wire_frame_encode(frame, frame->channel_mask, data + offset, data_size - offset) < 0) {
+        return RECORDER_ERR;
+    }
+
+    /* One index entry per stride of records: the first record starting in it */
+    uint32_t count = atomic_load_explicit(&seg->index_count, memory_order_relaxed);
+    if (count < RECORDER_INDEX_MAX && offset >= (uint64_t)count * seg->index_stride) {
+        seg->index[count].wall_ns = frame->wall_ns;
+        seg->index[count].offset = offset;
+        atomic_store_explicit(&seg->index_count, count + 1, memory_order_release);
+    }
+
+    /* Publish the record last: readers only look below 'used' */
+    atomic_store_explicit(&seg->last_ns, frame->wall_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&seg->frames, 1, memory_order_relaxed);
+    atomic_store_explicit(&seg->used, offset + size, memory_order_release);
+
+    rec->frames++;
+    return RECORDER_OK;
+}
+
+int recorder_sync(recorder_t *rec) {
+    if (rec == NULL) {
+        return RECORDER_ERR;
+    }
+    if (rec->segment != NULL && msync(rec->segment, rec->segment_size, MS_SYNC) < 0) {
+        return RECORDER_ERR_IO;
+    }
+    return RECORDER_OK;
+}
+
+void recorder_close(recorder_t *rec) {
+    if (rec == NULL) {
+        return;
+    }
+    close_segment(rec);
+}
+
+/* Offset of the first record that may be at or after 'from_ns' */
+static uint64_t index_lookup(const recorder_segment_t *seg, uint64_t from_ns) {
+    uint32_t count = atomic_load_explicit(&seg->index_count, memory_order_acquire);
+    uint32_t lo = 0;
+    uint32_t hi = count;
+
+    /* Last entry with wall_ns < from_ns: records before it are all earlier */
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (seg->index[mid].wall_ns < from_ns) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return (lo > 0) ? seg->index[lo - 1].offset : 0;
+}
+
+/* Scan one mapped segment. Returns frames passed to 'fn', or -1 - frames if 'fn' stopped the scan. */
+static long scan_segment(const recorder_segment_t *seg, size_t map_size, uint64_t from_ns, uint64_t to_ns,
+                         uint64_t mask, recorder_scan_fn fn, void *user) {
+    uint64_t used = atomic_load_explicit(&seg->used, memory_order_acquire);
+    if (RECORDER_HEADER_SIZE + used > map_size) {
+        return 0;                                       // truncated file
+    }
+
+    const uint8_t *data = (const uint8_t *)seg + RECORDER_HEADER_SIZE;
+    uint64_t offset = index_lookup(seg, from_ns);
+    long frames = 0;
+
+    while (offset < used) {
+        acq_frame_t frame;
+        int n = wire_frame_decode(data + offset, used - offset, &frame);
+        if (n <= 0) {
+            break;                                      // corrupt tail
+        }
+        offset += (uint64_t)n;
+
+        if (frame.wall_ns < from_ns || !(frame.channel_mask & mask)) {
+            continue;
+        }
+        if (frame.wall_ns > to_ns) {
+            break;
+        }
+
+        frame.channel_mask &= mask;
+        frame.valid_mask &= mask;
+        frames++;
+        if (fn(&frame, user) != 0) {
+            return -1 - frames;
+        }
+    }
+
+    return frames;
+}
+
+long recorder_scan(const char *dir, uint64_t from_ns, uint64_t to_ns, uint64_t mask,
+                   recorder_scan_fn fn, void *user) {
+    if (dir == NULL || fn == NULL) {
+        return RECORDER_ERR;
+    }
+
+    struct dirent **names;
+    int n = list_segments(dir, &names);
+    if (n < 0) {
+        return RECORDER_ERR_IO;
+    }
+
+    long total = 0;
+    for (int i = 0; i < n; i++) {
+        /* Segments are named after their first frame: the next one bounds this one */
+        if (i + 1 < n && strtoull(names[i + 1]->d_name, NULL, 10) < from_ns) {
+            continue;
+        }
+        if (strtoull(names[i]->d_name, NULL, 10) > to_ns) {
+            break;
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]->d_name);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            continue;                                   // dropped by the writer meanwhile
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < RECORDER_HEADER_SIZE) {
+            close(fd);
+            continue;
+        }
+
+        /* Pages are only read in as the scan touches them */
+        size_t map_size = (size_t)st.st_size;
+        const recorder_segment_t *seg = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (seg == MAP_FAILED) {
+            continue;
+        }
+
+        long frames = 0;
+        if (seg->magic == RECORDER_MAGIC && seg->version == RECORDER_VERSION) {
+            frames = scan_segment(seg, map_size, from_ns, to_ns, mask, fn, user);
+        }
+        munmap((void *)seg, map_size);
+
+        if (frames < 0) {
+            total += -1 - frames;
+            break;
+        }
+        total += frames;
+    }
+
+    free_list(names, n);
+    return total;
+}
@@ -0,0 +1,97 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "acq_frame.h"
+
+/*
+ * Append-only on-disk log of frames. A recording is a directory of segment
+ * files named after the wall time of their first frame (<wall_ns>.vlog).
+ * Each segment is preallocated, memory-mapped and filled front to back with
+ * wire_frame.h records; the kernel writes dirty pages back in page-sized
+ * batches, so the SD card sees sequential full-page writes and no metadata
+ * update per frame. Once full a segment is trimmed to its used size and a
+ * new one is started.
+ *
+ * The segment header keeps the time span of its frames and a sparse index
+ * (wall time at regular byte offsets), so a reader maps only the segments
+ * overlapping the requested range and starts scanning close to its start.
+ * Both are published after the record they describe, so a segment can be
+ * read while it is being written. Header fields are in host byte order
+ * (little-endian on the Pi).
+ */
+
+#define RECORDER_MAGIC          0x474F4C56u     // "VLOG"
+#define RECORDER_VERSION        1
+#define RECORDER_HEADER_SIZE    8192
+#define RECORDER_INDEX_MAX      508             // entries that fit in the header
+#define RECORDER_SEGMENT_SIZE   (16u * 1024u * 1024u)
+#define RECORDER_SUFFIX         ".vlog"
+
+/* Error codes */
+#define RECORDER_OK              0
+#define RECORDER_ERR            -1              // bad argument
+#define RECORDER_ERR_IO         -2              // file or mapping failed
+#define RECORDER_ERR_FORMAT     -3              // not a segment, or a corrupt one
+
+typedef struct {
+    uint64_t wall_ns;                           // wall time of the first record at or after 'offset'
+    uint64_t offset;                            // byte offset of that record after the header
+} recorder_index_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t segment_size;                      // file size while being written
+    _Atomic uint64_t used;                      // bytes of records after the header
+    _Atomic uint64_t frames;
+    uint64_t first_ns;                          // wall time of the first frame
+    _Atomic uint64_t last_ns;                   // wall time of the last frame
+    uint32_t index_stride;                      // bytes of records between index entries
+    _Atomic uint32_t index_count;
+    uint8_t reserved[8];
+    recorder_index_t index[RECORDER_INDEX_MAX];
+} recorder_segment_t;
+
+/* Writer */
+typedef struct {
+    char dir[256];
+    size_t segment_size;
+    int keep_segments;                          // oldest segments beyond this are deleted, 0 = keep all
+    recorder_segment_t *segment;                // mapped segment being filled, NULL between segments
+    int fd;
+    uint64_t frames;                            // frames appended since open
+    uint64_t segments;                          // segments started since open
+} recorder_t;
+
+/*
+ * Record into 'dir' (created if needed) in segments of 'segment_size' bytes
+ * (0 selects RECORDER_SEGMENT_SIZE). Frames are appended to a fresh segment,
+ * existing ones are kept. Returns RECORDER_OK, RECORDER_ERR or RECORDER_ERR_IO.
+ */
+int recorder_open(recorder_t *rec, const char *dir, size_t segment_size, int keep_segments);
+
+/* Append the sensors sampled in 'frame' (indexed by frame->wall_ns) */
+int recorder_append(recorder_t *rec, const acq_frame_t *frame);
+
+/* Write the current segment back to disk, waiting for completion */
+int recorder_sync(recorder_t *rec);
+
+/* Sync and trim the current segment */
+void recorder_close(recorder_t *rec);
+
+/*
+ * Reader: call 'fn' for every frame of 'dir' with from_ns <= wall_ns <= to_ns
+ * and at least one sensor of 'mask', in time order. channel_mask and
+ * valid_mask of the frame passed are restricted to 'mask'. A non-zero return
+ * from 'fn' stops the scan. Returns the number of frames passed to 'fn', or
+ * RECORDER_ERR / RECORDER_ERR_IO. Unreadable segments are skipped.
+ */
+typedef int (*recorder_scan_fn)(const acq_frame_t *frame, void *user);
+
+long recorder_scan(const char *dir, uint64_t from_ns, uint64_t to_ns, uint64_t mask,
+                   recorder_scan_fn fn, void *user);
+
+#endif // RECORDER_H
@@ -0,0 +1,80 @@
+#include "sample_cache.h"
+
+#include <stddef.h>
+
+void sample_cache_init(sample_cache_t *cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < SAMPLE_CACHE_SENSORS; i++) {
+        sample_cache_entry_t empty = {0};
+        sample_cache_store(cache, i, &empty);
+    }
+}
+
+void sample_cache_store(sample_cache_t *cache, int sensor, const sample_cache_entry_t *entry) {
+    if (cache == NULL || entry == NULL || sensor < 0 || sensor >= SAMPLE_CACHE_SENSORS) {
+        return;
+    }
+
+    sample_cache_slot_t *slot = &cache->slot[sensor];
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);      // odd: being written
+    atomic_thread_fence(memory_order_release);
+    slot->entry = *entry;
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);      // even: complete
+}
+
+int sample_cache_load(const sample_cache_t *cache, int sensor, sample_cache_entry_t *out) {
+    if (cache == NULL || out == NULL || sensor < 0 || sensor >= SAMPLE_CACHE_SENSORS) {
+        return SAMPLE_CACHE_ERR;
+    }
+
+    sample_cache_slot_t *slot = (sample_cache_slot_t *)&cache->slot[sensor];
+
+    for (;;) {
+        uint32_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before & 1u) {
+            continue;           // Writer is storing this very entry
+        }
+
+        *out = slot->entry;
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == before) {
+            return (out->timestamp_ns != 0) ? SAMPLE_CACHE_OK : SAMPLE_CACHE_EMPTY;
+        }
+        /* Entry was rewritten during the copy: take the new one */
+    }
+}
+
+uint64_t sample_cache_fresh(const sample_cache_t *cache, uint64_t mask, uint8_t sensitivity,
+                            uint64_t max_age_ns, uint64_t now_ns,
+                            sample_cache_entry_t out[SAMPLE_CACHE_SENSORS]) {
+    if (cache == NULL || out == NULL) {
+        return 0;
+    }
+
+    uint64_t served = 0;
+    for (int i = 0; i < SAMPLE_CACHE_SENSORS; i++) {
+        if (!(mask & (1ull << i))) {
+            continue;
+        }
+
+        sample_cache_entry_t entry;
+        if (sample_cache_load(cache, i, &entry) != SAMPLE_CACHE_OK || entry.sensitivity != sensitivity) {
+            continue;
+        }
+        /* Stored after 'now_ns' was taken counts as age 0 */
+        if (entry.timestamp_ns < now_ns && now_ns - entry.timestamp_ns > max_age_ns) {
+            continue;
+        }
+
+        out[i] = entry;
+        served |= 1ull << i;
+    }
+
+    return served;
+}
@@ -0,0 +1,56 @@
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "veml3328.h"
+
+#define SAMPLE_CACHE_SENSORS    64
+
+/* Error codes */
+#define SAMPLE_CACHE_OK          0
+#define SAMPLE_CACHE_EMPTY       1      // nothing stored for this sensor yet
+#define SAMPLE_CACHE_ERR        -1
+
+/* Latest sample of one sensor */
+typedef struct {
+    uint64_t timestamp_ns;                  // CLOCK_MONOTONIC when the sensor was read
+    uint16_t conf;                          // CONF the sample was taken with
+    uint8_t sensitivity;                    // 1 = low sensitivity (1/3)
+    veml3328_raw_data_t raw;
+    veml3328_norm_rgb_t norm;
+} sample_cache_entry_t;
+
+/* One seqlock per sensor: seq is odd while the entry is being written */
+typedef struct {
+    _Atomic uint32_t seq;
+    sample_cache_entry_t entry;
+} sample_cache_slot_t;
+
+/*
+ * Latest-value cache, one slot per sensor index. Readers never block: they
+ * copy the entry and retry if a store raced with the copy. Stores to one
+ * sensor must be serialised by the caller (one writer per slot).
+ */
+typedef struct {
+    sample_cache_slot_t slot[SAMPLE_CACHE_SENSORS];
+} sample_cache_t;
+
+/* Drop every entry */
+void sample_cache_init(sample_cache_t *cache);
+
+void sample_cache_store(sample_cache_t *cache, int sensor, const sample_cache_entry_t *entry);
+
+/* Copy the entry of 'sensor'. Returns SAMPLE_CACHE_OK, SAMPLE_CACHE_EMPTY or SAMPLE_CACHE_ERR. */
+int sample_cache_load(const sample_cache_t *cache, int sensor, sample_cache_entry_t *out);
+
+/*
+ * Entries of the sensors in 'mask' taken with 'sensitivity' at most
+ * 'max_age_ns' before 'now_ns', copied into out[sensor]. Returns the mask of
+ * sensors served.
+ */
+uint64_t sample_cache_fresh(const sample_cache_t *cache, uint64_t mask, uint8_t sensitivity,
+                            uint64_t max_age_ns, uint64_t now_ns,
+                            sample_cache_entry_t out[SAMPLE_CACHE_SENSORS]);
+
+#endif // SAMPLE_CACHE_H
@@ -0,0 +1,149 @@
+#include "sample_timer.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+uint64_t sample_timer_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec to_timespec(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    return ts;
+}
+
+/* Program the timerfd with the current next_ns/period_ns */
+static int arm(sample_timer_t *t) {
+    if (t->fd < 0) {
+        return SAMPLE_TIMER_OK;
+    }
+
+    struct itimerspec spec;
+    spec.it_value = to_timespec(t->next_ns);
+    spec.it_interval = to_timespec(t->period_ns);
+    if (timerfd_settime(t->fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        return SAMPLE_TIMER_ERR_IO;
+    }
+    return SAMPLE_TIMER_OK;
+}
+
+static void record(sample_timer_stats_t *stats, uint64_t late_ns, uint64_t missed) {
+    stats->ticks++;
+    stats->missed += missed;
+    if (stats->ticks == 1 || late_ns < stats->min_late_ns) {
+        stats->min_late_ns = late_ns;
+    }
+    if (late_ns > stats->max_late_ns) {
+        stats->max_late_ns = late_ns;
+    }
+
+    double delta = (double)late_ns - stats->mean_late_ns;
+    stats->mean_late_ns += delta / (double)stats->ticks;
+    stats->m2_late_ns += delta * ((double)late_ns - stats->mean_late_ns);
+}
+
+int sample_timer_init(sample_timer_t *t, uint64_t period_ns, uint64_t first_ns) {
+    if (t == NULL || period_ns == 0) {
+        return SAMPLE_TIMER_ERR_ARG;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->period_ns = period_ns;
+    t->next_ns = (first_ns != 0) ? first_ns : sample_timer_now_ns() + period_ns;
+
+    /* Without timerfd the same deadlines are slept on directly */
+    t->fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (arm(t) != SAMPLE_TIMER_OK) {
+        close(t->fd);
+        t->fd = -1;
+    }
+    return SAMPLE_TIMER_OK;
+}
+
+int sample_timer_align(sample_timer_t *t, uint64_t period_ns, uint64_t phase_ns) {
+    if (t == NULL || period_ns == 0) {
+        return SAMPLE_TIMER_ERR_ARG;
+    }
+
+    uint64_t now_ns = sample_timer_now_ns();
+    uint64_t next_ns = phase_ns;
+    if (next_ns < now_ns) {
+        next_ns += ((now_ns - next_ns) / period_ns + 1) * period_ns;
+    }
+
+    t->period_ns = period_ns;
+    t->next_ns = next_ns;
+    return arm(t);
+}
+
+int sample_timer_wait(sample_timer_t *t, uint64_t *tick_ns) {
+    if (t == NULL) {
+        return SAMPLE_TIMER_ERR_ARG;
+    }
+
+    uint64_t expirations = 1;
+    if (t->fd >= 0) {
+        ssize_t n;
+        do {
+            n = read(t->fd, &expirations, sizeof(expirations));
+        } while (n < 0 && errno == EINTR);
+        if (n != (ssize_t)sizeof(expirations) || expirations == 0) {
+            return SAMPLE_TIMER_ERR_IO;
+        }
+    } else {
+        /* Ticks already in the past count as missed, like timerfd overruns */
+        uint64_t now_ns = sample_timer_now_ns();
+        if (now_ns > t->next_ns) {
+            expirations += (now_ns - t->next_ns) / t->period_ns;
+        }
+        struct timespec ts = to_timespec(t->next_ns + (expirations - 1) * t->period_ns);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+            // Interrupted by a signal, keep waiting for the same deadline
+        }
+    }
+
+    uint64_t now_ns = sample_timer_now_ns();
+    uint64_t tick = t->next_ns + (expirations - 1) * t->period_ns;
+    t->next_ns = tick + t->period_ns;
+    t->last_late_ns = (now_ns > tick) ? now_ns - tick : 0;
+    record(&t->stats, t->last_late_ns, expirations - 1);
+
+    if (tick_ns != NULL) {
+        *tick_ns = tick;
+    }
+    return (int)(expirations - 1);
+}
+
+void sample_timer_close(sample_timer_t *t) {
+    if (t == NULL) {
+        return;
+    }
+
+    if (t->fd >= 0) {
+        close(t->fd);
+        t->fd = -1;
+    }
+}
+
+void sample_timer_reset_stats(sample_timer_t *t) {
+    if (t != NULL) {
+        memset(&t->stats, 0, sizeof(t->stats));
+    }
+}
+
+double sample_timer_jitter_ns(const sample_timer_stats_t *stats) {
+    if (stats == NULL || stats->ticks < 2) {
+        return 0.0;
+    }
+
+    return sqrt(stats->m2_late_ns / (double)(stats->ticks - 1));
+}
@@ -0,0 +1,58 @@
+#ifndef SAMPLE_TIMER_H
+#define SAMPLE_TIMER_H
+
+#include <stdint.h>
+
+/*
+ * Periodic sampling clock on CLOCK_MONOTONIC. Ticks fall on exact period
+ * boundaries (phase + k * period) and are armed as absolute deadlines, so
+ * the time spent on the bus never accumulates into drift. A timerfd is used
+ * where available, clock_nanosleep(TIMER_ABSTIME) otherwise.
+ *
+ * Every wait records how late the caller woke up with respect to the tick
+ * (jitter) and how many ticks passed unobserved (missed).
+ */
+
+/* Error codes */
+#define SAMPLE_TIMER_OK          0
+#define SAMPLE_TIMER_ERR_ARG    -1
+#define SAMPLE_TIMER_ERR_IO     -2
+
+typedef struct {
+    uint64_t ticks;             // waits completed
+    uint64_t missed;            // ticks that expired before the caller waited
+    uint64_t min_late_ns;
+    uint64_t max_late_ns;
+    double mean_late_ns;
+    double m2_late_ns;          // sum of squared deviations (Welford)
+} sample_timer_stats_t;
+
+typedef struct {
+    int fd;                     // timerfd, or -1 for clock_nanosleep
+    uint64_t period_ns;
+    uint64_t next_ns;           // next tick
+    uint64_t last_late_ns;      // lateness of the last wait
+    sample_timer_stats_t stats;
+} sample_timer_t;
+
+/* CLOCK_MONOTONIC in nanoseconds, the time base of the ticks */
+uint64_t sample_timer_now_ns(void);
+
+/* Start a clock ticking every 'period_ns', first at 'first_ns' (0: one period from now) */
+int sample_timer_init(sample_timer_t *t, uint64_t period_ns, uint64_t first_ns);
+
+/* Re-anchor the ticks on 'phase_ns' + k * period_ns; the next tick is the first one not in the past */
+int sample_timer_align(sample_timer_t *t, uint64_t period_ns, uint64_t phase_ns);
+
+/* Block until the next tick. *tick_ns (optional) receives the tick served.
+   Returns the number of ticks missed since the previous wait, or an error code. */
+int sample_timer_wait(sample_timer_t *t, uint64_t *tick_ns);
+
+void sample_timer_close(sample_timer_t *t);
+
+void sample_timer_reset_stats(sample_timer_t *t);
+
+/* Standard deviation of the wake-up lateness, in ns */
+double sample_timer_jitter_ns(const sample_timer_stats_t *stats);
+
+#endif // SAMPLE_TIMER_H
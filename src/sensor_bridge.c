@@ -15,16 +15,64 @@ typedef struct {
     float Wavelength;
 } SensorData;
 
+/* Per-channel status of a batch result */
+#define BRIDGE_OK               0
+#define BRIDGE_NOT_SELECTED     1
+#define BRIDGE_ERR_BUS         -1       // bus open, mux or sensor transaction failed
+#define BRIDGE_ERR_NO_DATA     -2       // no fresh daemon frame within the timeout
+#define BRIDGE_ERR_ISOLATED    -3       // failed repeatedly, left out of sweeps until it answers a re-probe
+
+/* One sensor of a batch readout (see sensor_read_batch) */
+typedef struct {
+    int32_t channel;            // sensor index: mux position * 8 + mux channel
+    int32_t status;
+    uint64_t timestamp_ns;      // CLOCK_MONOTONIC when the channel was read
+    uint16_t raw_clear;
+    uint16_t raw_red;
+    uint16_t raw_green;
+    uint16_t raw_blue;
+    uint16_t conf;              // VEML3328 CONF the sample was taken with (IT, gain, DG, SENS)
+    uint16_t saturated;         // 1 if a channel was clipped at full scale
+    float R;
+    float G;
+    float B;
+    float Intensity;
+    float Wavelength;
+} SensorSample;
+
+/* Completion callback of an asynchronous sweep (called from the worker thread) */
+typedef void (*sensor_sweep_cb)(int handle, void *user_data);
+
+#define BRIDGE_MAX_ASYNC 8     // asynchronous sweeps in flight at once
+#define BRIDGE_MAX_SENSORS 64  // 8 muxes x 8 channels per bus
+
 #ifndef _WIN32
 
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
 #include "i2c_driver_pi.h"
 #include "veml3328.h"
 #include "tca9548a.h"
+#include "sweep.h"
+#include "acq_group.h"
+#include "shm_ring.h"
+#include "autoexp.h"
+#include "sample_cache.h"
+#include "coalesce.h"
+#include "wire_frame.h"
+#include "log.h"
+#include "metrics.h"
 
 #define I2C_DEV_PATH "/dev/i2c-1"
-#define TCA9548A_ADDR 0x70
-#define VEML3328_ADDR VEML3328_I2C_ADDR
+#define BUS_LIST_SEP ";"                        // separates buses in SENSOR_BUS / SENSOR_MUXES
+
+#define RING_POLL_NS        5000000ull          // 5 ms between checks for a new frame
+#define RING_MAX_AGE_NS     2000000000ull       // older frames mean the daemon is gone
 
 static const veml3328_cfg_t bridge_cfg_default = {
     .gain_factor = 4.0f,
@@ -51,62 +99,1120 @@ static float rgb_255(float x) {
     return (float)((int)(x * 255.0f + 0.5f));
 }
 
-EXPORT SensorData get_sensor_readings(int channel, int sensivity) {
+static void fill_sample_norm(SensorSample *out, const veml3328_raw_data_t *raw, const veml3328_norm_rgb_t *norm,
+                             uint16_t conf, uint64_t timestamp_ns) {
+    out->status = BRIDGE_OK;
+    out->timestamp_ns = timestamp_ns;
+    out->raw_clear = raw->clear;
+    out->raw_red = raw->red;
+    out->raw_green = raw->green;
+    out->raw_blue = raw->blue;
+    out->conf = conf;
+    out->saturated = (raw->clear >= AUTOEXP_SATURATION || raw->red >= AUTOEXP_SATURATION ||
+                      raw->green >= AUTOEXP_SATURATION || raw->blue >= AUTOEXP_SATURATION);
+    out->R = rgb_255(norm->red);
+    out->G = rgb_255(norm->green);
+    out->B = rgb_255(norm->blue);
+    out->Intensity = norm->irradiance_uW_per_cm2;
+    out->Wavelength = norm->wavelength;
+}
+
+static void fill_sample(SensorSample *out, const veml3328_raw_data_t *raw, const veml3328_cfg_t *cfg, uint64_t timestamp_ns) {
+    veml3328_norm_rgb_t norm = veml3328_norm_colour(raw, cfg);
+    fill_sample_norm(out, raw, &norm, veml3328_encode_cfg(cfg), timestamp_ns);
+
+    LOG_D("bridge read, clear counts", 0, -1, 0, -1, raw->clear);
+}
+
+/* Marks every sensor as not selected / failed before a sweep fills them in */
+static void reset_samples(SensorSample samples[SWEEP_MAX_SENSORS], uint64_t mask, int32_t status) {
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        SensorSample empty = {0};
+        empty.channel = i;
+        empty.status = (mask & (1ull << i)) ? status : BRIDGE_NOT_SELECTED;
+        samples[i] = empty;
+    }
+}
+
+static SensorData to_sensor_data(const SensorSample *sample) {
     SensorData out = {0};
 
-    if (channel < 0 || channel > 7) {
-        return out;
+    if (sample->status == BRIDGE_OK) {
+        out.R = sample->R;
+        out.G = sample->G;
+        out.B = sample->B;
+        out.Intensity = sample->Intensity;
+        out.Wavelength = sample->Wavelength;
     }
 
-    int i2c_fd = i2c_open_bus(I2C_DEV_PATH);
-    if(i2c_fd < 0) {
-        return out;
+    return out;
+}
+
+/*
+ * Long-lived bus session. The buses are opened once and their sweep contexts
+ * remember the last state written to the hardware, so a read only touches
+ * the mux or the sensor configuration when something actually changed.
+ * With auto-exposure on, each sensor's integration time and gain follow its
+ * light level instead of bridge_cfg_default.
+ *
+ * Every sample read is also stored in 'cache', which requests with a max-age
+ * tolerance read without taking the session lock.
+ */
+typedef struct {
+    int open;
+    acq_group_t group;
+    int auto_exposure;
+    int retries;                // per-transaction retries (sensor_set_retry)
+    uint32_t backoff_us;
+    int timeout_ms;             // adapter timeout, -1: left as the adapter has it
+    autoexp_t ae;
+    sample_cache_t cache;
+    pthread_mutex_t lock;
+} bridge_session_t;
+
+static bridge_session_t session = {
+    .open = 0,
+    .auto_exposure = 0,
+    .retries = 0,
+    .backoff_us = 0,
+    .timeout_ms = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* Set while a daemon ring exists that this process cannot attach: the daemon
+   owns the bus, so the session must not open it too and fight over the muxes */
+static atomic_int ring_blocked = 0;
+
+/* Split 'list' in place at BUS_LIST_SEP; returns the number of items, or -1
+   if there are more than ACQ_MAX_BUSES */
+static int split_list(char *list, const char *items[ACQ_MAX_BUSES]) {
+    int n = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(list, BUS_LIST_SEP, &save); tok != NULL;
+         tok = strtok_r(NULL, BUS_LIST_SEP, &save)) {
+        if (n == ACQ_MAX_BUSES) {
+            return -1;
+        }
+        items[n++] = tok;
+    }
+    return n;
+}
+
+static int session_open_locked(const char *dev_path) {
+    if (session.open) {
+        return 0;
+    }
+    if (atomic_load(&ring_blocked)) {
+        LOG_E("Bus left to the acquisition daemon, its ring could not be attached", EBUSY, -1, 0, -1, 0);
+        return -1;
     }
 
-    (void)tca_disable_all(i2c_fd, TCA9548A_ADDR);
-    if(tca_select_channel(i2c_fd, TCA9548A_ADDR, channel) != TCA_OK) {
-        i2c_close_bus(i2c_fd);
-        return out;
+    /* SENSOR_BUS selects other buses (e.g. "/dev/i2c-1;/dev/i2c-3" or "sim:")
+       when the caller does not */
+    if (dev_path == NULL) {
+        dev_path = getenv("SENSOR_BUS");
     }
 
-    if (veml3328_config(i2c_fd, VEML3328_ADDR) != VEML3328_OK) {
-        i2c_close_bus(i2c_fd);
-        return out;
+    /* SENSOR_MUXES gives the mux addresses ("0x70,0x71" or "auto"), for all
+       buses or one entry per bus; default 0x70 */
+    const char *mux_env = getenv("SENSOR_MUXES");
+
+    char bus_list[256];
+    char mux_list[256];
+    snprintf(bus_list, sizeof(bus_list), "%s", dev_path != NULL ? dev_path : I2C_DEV_PATH);
+    snprintf(mux_list, sizeof(mux_list), "%s", mux_env != NULL ? mux_env : "");
+
+    const char *buses[ACQ_MAX_BUSES];
+    const char *muxes[ACQ_MAX_BUSES];
+    int num_buses = split_list(bus_list, buses);
+    int num_muxes = split_list(mux_list, muxes);
+    if (num_buses < 0 || num_muxes < 0) {
+        LOG_E("Too many buses in SENSOR_BUS or SENSOR_MUXES, at most", EINVAL, -1, 0, -1, ACQ_MAX_BUSES);
+        return -1;
     }
 
-    veml3328_cfg_t cfg = bridge_cfg_default;
-    cfg.sens_factor = (sensivity != 0);
+    if (acq_group_open(&session.group, buses, num_buses, num_muxes > 0 ? muxes : NULL, num_muxes) != ACQ_GROUP_OK) {
+        return -1;
+    }
 
-    (void)veml3328_apply_cfg(i2c_fd, VEML3328_ADDR, &cfg);
-    
-    usleep( (useconds_t)(cfg.it_ms * 1000.0f) ); // Wait for integration time
+    (void)acq_group_set_retry(&session.group, session.retries, session.backoff_us, session.timeout_ms);
+    autoexp_init(&session.ae, 0, 0);
+    sample_cache_init(&session.cache);
+    session.open = 1;
+    return 0;
+}
+
+static void session_close_locked(void) {
+    if (!session.open) {
+        return;
+    }
+
+    acq_group_close(&session.group);
+    session.open = 0;
+}
+
+/* Runs one sweep over 'mask' into sensor-indexed samples; returns the mask of sensors read */
+static uint64_t session_sweep_locked(uint64_t mask, int sensivity, SensorSample samples[SWEEP_MAX_SENSORS]) {
+    reset_samples(samples, mask, BRIDGE_ERR_BUS);
+
+    if (!session.open && session_open_locked(NULL) < 0) {
+        return 0;
+    }
+
+    veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        veml3328_cfg_t base = bridge_cfg_default;
+        base.sens_factor = (sensivity != 0);
+        if (session.auto_exposure) {
+            autoexp_cfg(&session.ae, i, &base, &cfg[i]);
+        } else {
+            cfg[i] = base;
+        }
+    }
+
+    /* Sensors isolated before this sweep are skipped, not failed */
+    uint64_t skipped = acq_group_isolated(&session.group);
+
+    acq_frame_t frame;
+    uint64_t read_ns[SWEEP_MAX_SENSORS];
+    if (acq_group_sweep(&session.group, mask, cfg, &frame, read_ns) != ACQ_GROUP_OK) {
+        return 0;
+    }
+
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if (frame.valid_mask & (1ull << i)) {
+            /* Normalised once, for the caller and the cache */
+            sample_cache_entry_t entry = {
+                .timestamp_ns = read_ns[i],
+                .conf = veml3328_encode_cfg(&cfg[i]),
+                .sensitivity = (uint8_t)(sensivity != 0),
+                .raw = frame.raw[i],
+                .norm = veml3328_norm_colour(&frame.raw[i], &cfg[i])
+            };
+            sample_cache_store(&session.cache, i, &entry);
+
+            fill_sample_norm(&samples[i], &entry.raw, &entry.norm, entry.conf, entry.timestamp_ns);
+            LOG_D("bridge read, clear counts", 0, -1, 0, -1, entry.raw.clear);
+            if (session.auto_exposure) {
+                (void)autoexp_update(&session.ae, i, &cfg[i], &frame.raw[i]);
+            }
+        } else if (session.auto_exposure && (frame.channel_mask & (1ull << i))) {
+            autoexp_lost(&session.ae, i);
+        }
+    }
+
+    uint64_t isolated = mask & acq_group_isolated(&session.group) & ~frame.valid_mask;
+    uint64_t saturated = 0;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if (isolated & (1ull << i)) {
+            samples[i].status = BRIDGE_ERR_ISOLATED;
+        }
+        if ((frame.valid_mask & (1ull << i)) && samples[i].saturated) {
+            saturated |= 1ull << i;
+        }
+    }
+
+    uint64_t failed = mask & acq_group_all_sensors(&session.group) & ~frame.valid_mask & ~skipped;
+    metrics_count_sweep(frame.valid_mask, failed, saturated);
+
+    return frame.valid_mask;
+}
+
+static uint64_t session_sweep(uint64_t mask, int sensivity, SensorSample samples[SWEEP_MAX_SENSORS]) {
+    pthread_mutex_lock(&session.lock);
+    uint64_t done = session_sweep_locked(mask, sensivity, samples);
+    pthread_mutex_unlock(&session.lock);
+    return done;
+}
+
+/*
+ * Concurrent readers share sweeps: a caller whose sensors are already being
+ * swept waits for that sweep, the others are merged into the next one.
+ */
+static coalescer_t coalescer;
+static pthread_once_t coalescer_once = PTHREAD_ONCE_INIT;
+static int coalescer_ready = 0;
+
+static uint64_t coalesced_sweep_fn(void *user, uint64_t mask, int sensivity, void *results) {
+    (void)user;
+    return session_sweep(mask, sensivity, results);
+}
+
+static void coalescer_setup(void) {
+    coalescer_ready = (coalescer_init(&coalescer, sizeof(SensorSample), coalesced_sweep_fn, NULL) == 0);
+}
+
+/* session_sweep() shared with concurrent callers */
+static uint64_t shared_sweep(uint64_t mask, int sensivity, SensorSample samples[SWEEP_MAX_SENSORS]) {
+    pthread_once(&coalescer_once, coalescer_setup);
+    if (!coalescer_ready) {
+        return session_sweep(mask, sensivity, samples);
+    }
+
+    reset_samples(samples, mask, BRIDGE_ERR_BUS);
+    return coalescer_sweep(&coalescer, mask, sensivity, samples);
+}
+
+/* Fill the sensors of 'mask' with cached samples no older than 'max_age_ns'; returns the mask served */
+static uint64_t cache_collect(uint64_t mask, int sensivity, uint64_t max_age_ns, SensorSample samples[SWEEP_MAX_SENSORS]) {
+    sample_cache_entry_t entries[SAMPLE_CACHE_SENSORS];
+    uint64_t hit = sample_cache_fresh(&session.cache, mask, (uint8_t)(sensivity != 0), max_age_ns,
+                                      sweep_now_ns(), entries);
+
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if (hit & (1ull << i)) {
+            fill_sample_norm(&samples[i], &entries[i].raw, &entries[i].norm, entries[i].conf, entries[i].timestamp_ns);
+        }
+    }
+    return hit;
+}
+
+/*
+ * Like shared_sweep(), but sensors with a cached sample younger than
+ * 'max_age_ns' are served from memory and only the others are swept.
+ */
+static uint64_t session_sweep_cached(uint64_t mask, int sensivity, uint64_t max_age_ns,
+                                     SensorSample samples[SWEEP_MAX_SENSORS]) {
+    reset_samples(samples, mask, BRIDGE_ERR_BUS);
+
+    uint64_t done = (max_age_ns > 0) ? cache_collect(mask, sensivity, max_age_ns, samples) : 0;
+    uint64_t stale = mask & ~done;
+    if (stale != 0) {
+        /* The sweep fills a whole array: keep the cache hits out of its way */
+        SensorSample swept[SWEEP_MAX_SENSORS];
+        done |= shared_sweep(stale, sensivity, swept);
+        for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+            if (stale & (1ull << i)) {
+                samples[i] = swept[i];
+            }
+        }
+    }
+
+    return done;
+}
 
-    veml3328_raw_data_t raw_data;
-    if(veml3328_read_all(i2c_fd, VEML3328_ADDR, &raw_data) != VEML3328_OK) {
-        i2c_close_bus(i2c_fd);
+/* Open the bus (NULL selects the default device; several buses are separated
+   by ';' and read in parallel). Returns 0 on success, -1 on error. */
+EXPORT int sensor_session_init(const char *dev_path) {
+    pthread_mutex_lock(&session.lock);
+    int ret = session_open_locked(dev_path);
+    pthread_mutex_unlock(&session.lock);
+    return ret;
+}
+
+/* Read one sensor through the open session (opened on demand if needed). */
+EXPORT SensorData sensor_session_read(int channel, int sensivity) {
+    SensorData out = {0};
+
+    if (channel < 0 || channel >= SWEEP_MAX_SENSORS) {
         return out;
     }
 
-    veml3328_norm_rgb_t norm = veml3328_norm_colour(&raw_data, &cfg);
-    out.R = rgb_255(norm.red);
-    out.G = rgb_255(norm.green);
-    out.B = rgb_255(norm.blue)  ;
-    out.Intensity = norm.irradiance_uW_per_cm2;
-    out.Wavelength = norm.wavelength;
+    SensorSample samples[SWEEP_MAX_SENSORS];
+    (void)shared_sweep(1ull << channel, sensivity, samples);
+    return to_sensor_data(&samples[channel]);
+}
 
-    fprintf(stderr,
-        "DBG bridge: raw C=%u R=%u G=%u B=%u | irr=%.3f wl=%.1f\n",
-        raw_data.clear, raw_data.red, raw_data.green, raw_data.blue,
-        norm.irradiance_uW_per_cm2, norm.wavelength);
+/*
+ * Read every channel in 'channel_mask' with a single pipelined sweep: all
+ * sensors integrate in parallel, so the sweep costs one integration period.
+ * 'out' must hold 8 entries (indexed by channel of the first mux); unselected
+ * or failed entries are left untouched. Returns the mask of channels read
+ * successfully. Use sensor_read_batch() for the other muxes.
+ */
+EXPORT int sensor_session_sweep(unsigned int channel_mask, int sensivity, SensorData *out) {
+    if (out == NULL) {
+        return 0;
+    }
 
-    
-    (void)tca_disable_all(i2c_fd, TCA9548A_ADDR);
-    i2c_close_bus(i2c_fd);
-    return out;
+    SensorSample samples[SWEEP_MAX_SENSORS];
+    int done = (int)shared_sweep(channel_mask & 0xFF, sensivity, samples);
+    for (int ch = 0; ch < SWEEP_NUM_CHANNELS; ch++) {
+        if (done & (1 << ch)) {
+            out[ch] = to_sensor_data(&samples[ch]);
+        }
+    }
+
+    return done;
+}
+
+/*
+ * Per-sensor auto-exposure of session reads (off by default: every sensor
+ * uses 400 ms, 4x, DG 2x). Each sample carries the CONF it was taken with,
+ * so normalised values stay comparable; a sample may still come back
+ * saturated while a sensor converges. Returns the previous setting.
+ */
+EXPORT int sensor_set_auto_exposure(int enable) {
+    pthread_mutex_lock(&session.lock);
+    int previous = session.auto_exposure;
+    session.auto_exposure = (enable != 0);
+    pthread_mutex_unlock(&session.lock);
+    return previous;
+}
+
+/*
+ * Retry a failed bus transaction up to 'retries' times, backoff_us, then
+ * twice that and so on apart, and bound every transaction by timeout_ms
+ * (negative: leave the adapter timeout alone; it is shared by every user of
+ * the adapter). Sensors that still fail three sweeps in a
+ * row are isolated (BRIDGE_ERR_ISOLATED) and re-probed in the background of
+ * later sweeps. Applies to the open session and later ones. Returns 0, or
+ * -1 on bad arguments or if a bus rejected the timeout.
+ */
+EXPORT int sensor_set_retry(int retries, int backoff_us, int timeout_ms) {
+    if (retries < 0 || backoff_us < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&session.lock);
+    session.retries = retries;
+    session.backoff_us = (uint32_t)backoff_us;
+    session.timeout_ms = timeout_ms;
+    int ret = 0;
+    if (session.open &&
+        acq_group_set_retry(&session.group, retries, (uint32_t)backoff_us, timeout_ms) != ACQ_GROUP_OK) {
+        ret = -1;
+    }
+    pthread_mutex_unlock(&session.lock);
+    return ret;
+}
+
+/* Disable the muxes and close the buses. */
+EXPORT void sensor_session_shutdown(void) {
+    pthread_mutex_lock(&session.lock);
+    session_close_locked();
+    pthread_mutex_unlock(&session.lock);
+}
+
+/*
+ * Consumer side of the acquisition daemon ring. While attached, readings are
+ * served from the frames the daemon publishes and this process never touches
+ * the bus itself.
+ */
+static shm_ring_t *ring = NULL;
+static pthread_rwlock_t ring_lock = PTHREAD_RWLOCK_INITIALIZER;  // readers share, detach is exclusive
+
+/*
+ * Attach to the daemon ring (NULL selects the default name). Returns 0 on
+ * success, -1 if there is no ring, or -2 if a ring exists but cannot be
+ * attached (permissions, other version); the bus session then stays closed
+ * until a later attach succeeds or finds no ring.
+ */
+EXPORT int sensor_ring_attach(const char *name) {
+    pthread_rwlock_wrlock(&ring_lock);
+    int ret = 0;
+    if (ring == NULL) {
+        const char *ring_name = name != NULL ? name : SHM_RING_NAME;
+        ring = shm_ring_open(ring_name);
+        if (ring == NULL) {
+            ret = (errno == ENOENT) ? -1 : -2;
+        }
+        if (ret == -2) {
+            LOG_E("Daemon ring exists but cannot be attached, not opening the bus", errno, -1, 0, -1, 0);
+            fprintf(stderr, "Cannot attach the acquisition daemon ring %s: %s\n", ring_name, strerror(errno));
+        }
+    }
+    atomic_store(&ring_blocked, ret == -2);
+    pthread_rwlock_unlock(&ring_lock);
+    return ret;
+}
+
+EXPORT void sensor_ring_detach(void) {
+    pthread_rwlock_wrlock(&ring_lock);
+    shm_ring_close(ring);
+    ring = NULL;
+    pthread_rwlock_unlock(&ring_lock);
+}
+
+static int ring_attached(void) {
+    pthread_rwlock_rdlock(&ring_lock);
+    int attached = (ring != NULL);
+    pthread_rwlock_unlock(&ring_lock);
+    return attached;
+}
+
+/* Sensors of 'mask' in a daemon frame into sensor-indexed samples (already reset) */
+static void frame_samples(const acq_frame_t *frame, uint64_t mask, SensorSample samples[SWEEP_MAX_SENSORS]) {
+    for (int i = 0; i < ACQ_MAX_CHANNELS; i++) {
+        uint64_t bit = 1ull << i;
+        if (!(mask & bit)) {
+            continue;
+        }
+        if (!(frame->channel_mask & bit)) {
+            continue;                                   // daemon does not sample it
+        }
+        if (!(frame->valid_mask & bit)) {
+            samples[i].status = BRIDGE_ERR_BUS;         // daemon failed to read it
+            continue;
+        }
+
+        veml3328_cfg_t cfg;
+        veml3328_decode_cfg(frame->conf[i], bridge_cfg_default.ds_it_ms, bridge_cfg_default.dark_offset, &cfg);
+        fill_sample(&samples[i], &frame->raw[i], &cfg, frame->timestamp_ns);
+    }
+}
+
+/* Latest frame taken with 'sensivity' into sensor-indexed samples.
+   Returns 0 (filled samples flagged BRIDGE_OK), or -1 if not attached. */
+static int ring_collect(uint64_t mask, int sensivity, SensorSample samples[SWEEP_MAX_SENSORS], int timeout_ms) {
+    reset_samples(samples, mask, BRIDGE_ERR_NO_DATA);
+
+    pthread_rwlock_rdlock(&ring_lock);
+    if (ring == NULL) {
+        pthread_rwlock_unlock(&ring_lock);
+        return -1;
+    }
+
+    uint8_t sens = (sensivity != 0);
+    atomic_store(&ring->sens_request, sens);
+
+    uint64_t deadline_ns = sweep_now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ull;
+    acq_frame_t frame;
+    int found = 0;
+
+    while (!found) {
+        uint64_t now_ns = sweep_now_ns();
+        if (shm_ring_latest(ring, &frame) == SHM_RING_OK &&
+            frame.sensitivity == sens &&
+            now_ns - frame.timestamp_ns < RING_MAX_AGE_NS) {
+            found = 1;
+        } else if (now_ns >= deadline_ns) {
+            break;
+        } else {
+            sweep_sleep_until_ns(now_ns + RING_POLL_NS);
+        }
+    }
+    pthread_rwlock_unlock(&ring_lock);
+
+    if (found) {
+        frame_samples(&frame, mask, samples);
+    }
+
+    return 0;
+}
+
+/*
+ * Latest daemon frame for 'channel_mask', taken with the requested sensitivity.
+ * If the daemon is sampling with another sensitivity it is asked to switch and
+ * the call waits up to 'timeout_ms' for a matching frame. 'out' holds 8 entries
+ * indexed by channel. Returns the mask of channels filled, or -1 if not attached.
+ */
+EXPORT int sensor_ring_read(unsigned int channel_mask, int sensivity, SensorData *out, int timeout_ms) {
+    if (out == NULL) {
+        return -1;
+    }
+
+    SensorSample samples[SWEEP_MAX_SENSORS];
+    if (ring_collect(channel_mask & 0xFF, sensivity, samples, timeout_ms) < 0) {
+        return -1;
+    }
+
+    int done = 0;
+    for (int ch = 0; ch < SWEEP_NUM_CHANNELS; ch++) {
+        if (samples[ch].status == BRIDGE_OK) {
+            out[ch] = to_sensor_data(&samples[ch]);
+            done |= 1 << ch;
+        }
+    }
+
+    return done;
+}
+
+/*
+ * Streaming: waits up to 'timeout_ms' for a daemon frame newer than
+ * 'after_seq' (0 = any) and writes the sensors of 'sensor_mask' to
+ * out[0..n-1] in index order, as sensor_read_batch() does. Frames published
+ * while the caller was away are skipped: the newest one is returned, so a
+ * slow consumer never falls behind. 'sensivity' < 0 accepts frames of either
+ * sensitivity; otherwise the daemon is asked to switch and other frames are
+ * skipped. The frame sequence number is stored in *seq. Returns n, 0 if no
+ * new frame arrived in time, or -1 if not attached or 'out' is too small.
+ */
+EXPORT int sensor_ring_next(uint64_t after_seq, uint64_t sensor_mask, int sensivity,
+                            SensorSample *out, int max_results, int timeout_ms, uint64_t *seq) {
+    if (out == NULL || seq == NULL || max_results < __builtin_popcountll(sensor_mask)) {
+        return -1;
+    }
+
+    pthread_rwlock_rdlock(&ring_lock);
+    if (ring == NULL) {
+        pthread_rwlock_unlock(&ring_lock);
+        return -1;
+    }
+
+    if (sensivity >= 0) {
+        atomic_store(&ring->sens_request, (uint8_t)(sensivity != 0));
+    }
+
+    uint64_t deadline_ns = sweep_now_ns() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ull;
+    acq_frame_t frame;
+    int found = 0;
+
+    while (!found) {
+        uint64_t now_ns = sweep_now_ns();
+        if (shm_ring_head(ring) > after_seq && shm_ring_latest(ring, &frame) == SHM_RING_OK &&
+            (sensivity < 0 || frame.sensitivity == (sensivity != 0))) {
+            found = 1;
+        } else if (now_ns >= deadline_ns) {
+            break;
+        } else {
+            sweep_sleep_until_ns(now_ns + RING_POLL_NS);
+        }
+    }
+    pthread_rwlock_unlock(&ring_lock);
+
+    if (!found) {
+        return 0;
+    }
+
+    SensorSample samples[SWEEP_MAX_SENSORS];
+    reset_samples(samples, sensor_mask, BRIDGE_ERR_NO_DATA);
+    frame_samples(&frame, sensor_mask, samples);
+    *seq = frame.seq;
+
+    int n = 0;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if (sensor_mask & (1ull << i)) {
+            out[n++] = samples[i];
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Batch readout: every sensor in 'sensor_mask' (bit n = sensor index n, up to
+ * 64 across eight muxes) is read in one sweep (or taken from the daemon ring
+ * when attached, waiting at most 'timeout_ms') and written to out[0..n-1] in
+ * index order, one SensorSample per selected sensor with its own status and
+ * timestamp. Sensors read by any caller within the last 'max_age_ms' are
+ * served from the sample cache and only the others cost bus traffic; 0
+ * always reads the hardware. Returns n, or -1 if 'out' is NULL or too small.
+ */
+EXPORT int sensor_read_batch_cached(uint64_t sensor_mask, int sensivity, int max_age_ms,
+                                    SensorSample *out, int max_results, int timeout_ms) {
+    int selected = __builtin_popcountll(sensor_mask);
+
+    if (out == NULL || max_results < selected) {
+        return -1;
+    }
+
+    SensorSample samples[SWEEP_MAX_SENSORS];
+    if (ring_attached()) {
+        (void)ring_collect(sensor_mask, sensivity, samples, timeout_ms);
+    } else {
+        uint64_t max_age_ns = (uint64_t)(max_age_ms > 0 ? max_age_ms : 0) * 1000000ull;
+        (void)session_sweep_cached(sensor_mask, sensivity, max_age_ns, samples);
+    }
+
+    int n = 0;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if (sensor_mask & (1ull << i)) {
+            out[n++] = samples[i];
+        }
+    }
+
+    return n;
+}
+
+/* sensor_read_batch_cached() that always reads the hardware */
+EXPORT int sensor_read_batch(uint64_t sensor_mask, int sensivity, SensorSample *out, int max_results, int timeout_ms) {
+    return sensor_read_batch_cached(sensor_mask, sensivity, 0, out, max_results, timeout_ms);
+}
+
+/*
+ * Asynchronous sweeps. sensor_sweep_start() hands the batch readout to a
+ * worker thread and returns a handle at once; completion is signalled by the
+ * optional callback, an eventfd (for select/poll loops) and a condition
+ * variable (sensor_sweep_wait). Handles carry a generation count so a stale
+ * handle never aliases a reused slot. A handle is released by
+ * sensor_sweep_complete() or sensor_sweep_cancel().
+ */
+typedef enum {
+    ASYNC_FREE = 0,
+    ASYNC_RUNNING,
+    ASYNC_DONE,
+    ASYNC_CANCELLED             // released while running: the worker frees the slot
+} async_state_t;
+
+typedef struct {
+    async_state_t state;
+    int generation;
+    int event_fd;
+    uint64_t mask;
+    int sensivity;
+    int timeout_ms;
+    sensor_sweep_cb callback;
+    void *user_data;
+    int num_results;
+    SensorSample results[SWEEP_MAX_SENSORS];
+} async_sweep_t;
+
+static async_sweep_t async_slots[BRIDGE_MAX_ASYNC];
+static pthread_mutex_t async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_done = PTHREAD_COND_INITIALIZER;
+
+static int async_handle(int slot) {
+    return async_slots[slot].generation * BRIDGE_MAX_ASYNC + slot;
+}
+
+/* Slot of a live handle, or -1 (call with async_lock held) */
+static int async_slot_locked(int handle) {
+    if (handle < 0) {
+        return -1;
+    }
+
+    int slot = handle % BRIDGE_MAX_ASYNC;
+    async_state_t state = async_slots[slot].state;
+    if (state == ASYNC_FREE || state == ASYNC_CANCELLED || async_handle(slot) != handle) {
+        return -1;
+    }
+
+    return slot;
+}
+
+static void *async_worker(void *arg) {
+    int slot = (int)(intptr_t)arg;
+    async_sweep_t *job = &async_slots[slot];
+
+    SensorSample results[SWEEP_MAX_SENSORS];
+    int n = sensor_read_batch(job->mask, job->sensivity, results, SWEEP_MAX_SENSORS, job->timeout_ms);
+
+    pthread_mutex_lock(&async_lock);
+    if (job->state == ASYNC_CANCELLED) {
+        close(job->event_fd);
+        job->event_fd = -1;
+        job->state = ASYNC_FREE;
+        pthread_mutex_unlock(&async_lock);
+        return NULL;
+    }
+
+    job->num_results = n;
+    for (int i = 0; i < n; i++) {
+        job->results[i] = results[i];
+    }
+    job->state = ASYNC_DONE;
+    int handle = async_handle(slot);
+    sensor_sweep_cb callback = job->callback;
+    void *user_data = job->user_data;
+    (void)eventfd_write(job->event_fd, 1);
+    pthread_cond_broadcast(&async_done);
+    pthread_mutex_unlock(&async_lock);
+
+    if (callback != NULL) {
+        callback(handle, user_data);
+    }
+
+    return NULL;
+}
+
+/*
+ * Start a sweep of 'sensor_mask' in the background. 'callback' may be NULL.
+ * Returns a handle, or -1 if all slots are busy or the worker cannot start.
+ */
+EXPORT int sensor_sweep_start(uint64_t sensor_mask, int sensivity, int timeout_ms,
+                              sensor_sweep_cb callback, void *user_data) {
+    pthread_mutex_lock(&async_lock);
+
+    int slot = -1;
+    for (int i = 0; i < BRIDGE_MAX_ASYNC; i++) {
+        if (async_slots[i].state == ASYNC_FREE) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        pthread_mutex_unlock(&async_lock);
+        return -1;
+    }
+
+    async_sweep_t *job = &async_slots[slot];
+    job->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (job->event_fd < 0) {
+        pthread_mutex_unlock(&async_lock);
+        return -1;
+    }
+
+    job->generation++;
+    job->mask = sensor_mask;
+    job->sensivity = sensivity;
+    job->timeout_ms = timeout_ms;
+    job->callback = callback;
+    job->user_data = user_data;
+    job->num_results = 0;
+    job->state = ASYNC_RUNNING;
+
+    pthread_t tid;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int ret = pthread_create(&tid, &attr, async_worker, (void *)(intptr_t)slot);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        close(job->event_fd);
+        job->event_fd = -1;
+        job->state = ASYNC_FREE;
+        pthread_mutex_unlock(&async_lock);
+        return -1;
+    }
+
+    int handle = async_handle(slot);
+    pthread_mutex_unlock(&async_lock);
+    return handle;
+}
+
+/* 1 if the sweep finished, 0 if still running, -1 for an unknown handle */
+EXPORT int sensor_sweep_poll(int handle) {
+    pthread_mutex_lock(&async_lock);
+    int slot = async_slot_locked(handle);
+    int ret = (slot < 0) ? -1 : (async_slots[slot].state == ASYNC_DONE);
+    pthread_mutex_unlock(&async_lock);
+    return ret;
+}
+
+/* eventfd that becomes readable when the sweep finishes (owned by the bridge) */
+EXPORT int sensor_sweep_eventfd(int handle) {
+    pthread_mutex_lock(&async_lock);
+    int slot = async_slot_locked(handle);
+    int fd = (slot < 0) ? -1 : async_slots[slot].event_fd;
+    pthread_mutex_unlock(&async_lock);
+    return fd;
+}
+
+/* Block until the sweep finishes or 'timeout_ms' elapses (< 0 waits forever).
+   Returns 1 when done, 0 on timeout, -1 for an unknown handle. */
+EXPORT int sensor_sweep_wait(int handle, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    if (timeout_ms > 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&async_lock);
+    int ret;
+    for (;;) {
+        int slot = async_slot_locked(handle);
+        if (slot < 0) {
+            ret = -1;
+            break;
+        }
+        if (async_slots[slot].state == ASYNC_DONE) {
+            ret = 1;
+            break;
+        }
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&async_done, &async_lock);
+        } else if (pthread_cond_timedwait(&async_done, &async_lock, &deadline) == ETIMEDOUT) {
+            ret = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&async_lock);
+    return ret;
+}
+
+/*
+ * Collect the results of a finished sweep (same layout as sensor_read_batch)
+ * and release the handle. Returns the number of results, -2 if the sweep is
+ * still running (the handle stays valid) or -1 for an unknown handle or a
+ * too small 'out'.
+ */
+EXPORT int sensor_sweep_complete(int handle, SensorSample *out, int max_results) {
+    pthread_mutex_lock(&async_lock);
+
+    int slot = async_slot_locked(handle);
+    if (slot < 0) {
+        pthread_mutex_unlock(&async_lock);
+        return -1;
+    }
+
+    async_sweep_t *job = &async_slots[slot];
+    if (job->state != ASYNC_DONE) {
+        pthread_mutex_unlock(&async_lock);
+        return -2;
+    }
+
+    int n = job->num_results;
+    if (out == NULL || max_results < n) {
+        pthread_mutex_unlock(&async_lock);
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++) {
+        out[i] = job->results[i];
+    }
+
+    close(job->event_fd);
+    job->event_fd = -1;
+    job->state = ASYNC_FREE;
+    pthread_mutex_unlock(&async_lock);
+    return n;
+}
+
+/*
+ * Release a handle without collecting its results. A running sweep finishes
+ * in the background (its callback is not called) and frees its slot then.
+ * Returns 0, or -1 for an unknown handle.
+ */
+EXPORT int sensor_sweep_cancel(int handle) {
+    pthread_mutex_lock(&async_lock);
+
+    int slot = async_slot_locked(handle);
+    if (slot < 0) {
+        pthread_mutex_unlock(&async_lock);
+        return -1;
+    }
+
+    async_sweep_t *job = &async_slots[slot];
+    if (job->state == ASYNC_RUNNING) {
+        job->state = ASYNC_CANCELLED;
+    } else {
+        close(job->event_fd);
+        job->event_fd = -1;
+        job->state = ASYNC_FREE;
+    }
+
+    /* Waiters on this handle return -1 */
+    pthread_cond_broadcast(&async_done);
+    pthread_mutex_unlock(&async_lock);
+    return 0;
+}
+
+/*
+ * Binary wire format (wire_frame.h) of n samples returned by
+ * sensor_read_batch(), sensor_ring_next() or sensor_sweep_complete():
+ * CONF and raw counts of each sensor, the frame time being that of the
+ * earliest sample. 'sensivity' < 0 takes it from the CONF of the samples.
+ * Returns the number of bytes written to 'buf', or -1.
+ */
+EXPORT int sensor_encode_frame(const SensorSample *samples, int n, uint64_t seq, int sensivity,
+                               uint8_t *buf, int len) {
+    if (samples == NULL || buf == NULL || n < 0 || n > BRIDGE_MAX_SENSORS || len < 0) {
+        return -1;
+    }
+
+    acq_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.seq = seq;
+    frame.sensitivity = (uint8_t)(sensivity > 0);
+
+    uint64_t first_ns = UINT64_MAX;
+    uint64_t last_ns = 0;
+    for (int k = 0; k < n; k++) {
+        const SensorSample *sample = &samples[k];
+        if (sample->channel < 0 || sample->channel >= ACQ_MAX_CHANNELS) {
+            return -1;
+        }
+
+        uint64_t bit = 1ull << sample->channel;
+        frame.channel_mask |= bit;
+        if (sample->status != BRIDGE_OK) {
+            continue;
+        }
+
+        if (sensivity < 0) {
+            veml3328_cfg_t cfg;
+            veml3328_decode_cfg(sample->conf, bridge_cfg_default.ds_it_ms, bridge_cfg_default.dark_offset, &cfg);
+            frame.sensitivity = (cfg.sens_factor != 0.0f);
+            sensivity = frame.sensitivity;
+        }
+
+        frame.valid_mask |= bit;
+        frame.conf[sample->channel] = sample->conf;
+        frame.raw[sample->channel] = (veml3328_raw_data_t){
+            sample->raw_clear, sample->raw_red, sample->raw_green, sample->raw_blue
+        };
+        first_ns = (sample->timestamp_ns < first_ns) ? sample->timestamp_ns : first_ns;
+        last_ns = (sample->timestamp_ns > last_ns) ? sample->timestamp_ns : last_ns;
+    }
+
+    if (frame.valid_mask != 0) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t wall_now_ns = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+        uint64_t age_ns = sweep_now_ns() - first_ns;
+
+        frame.timestamp_ns = first_ns;
+        frame.wall_ns = wall_now_ns - age_ns;
+        frame.spread_ns = (uint32_t)(last_ns - first_ns);
+    }
+
+    return wire_frame_encode(&frame, frame.channel_mask, buf, (size_t)len);
+}
+
+/*
+ * Latency histograms of this process (bus transactions, mux writes, sweeps),
+ * numbered from 0; the name of 'metric', or NULL past the last one.
+ */
+EXPORT const char *sensor_metrics_name(int metric) {
+    return metrics_latency_name(metric);
+}
+
+/*
+ * Histogram 'metric' folded into 'num_bounds' cumulative buckets:
+ * cumulative[k] counts the latencies up to bounds_s[k] (seconds, ascending),
+ * within the 1/16 resolution of the histogram. *count and *sum_s (optional)
+ * receive the total count and the sum of the latencies in seconds.
+ * Returns 0, or -1 for an unknown metric or bad arguments.
+ */
+EXPORT int sensor_metrics_latency(int metric, const double *bounds_s, int num_bounds,
+                                  uint64_t *cumulative, uint64_t *count, double *sum_s) {
+    if (num_bounds < 0 || (num_bounds > 0 && (bounds_s == NULL || cumulative == NULL))) {
+        return -1;
+    }
+
+    metrics_snapshot_t snap;
+    if (metrics_snapshot(metric, &snap) != 0) {
+        return -1;
+    }
+
+    for (int k = 0; k < num_bounds; k++) {
+        cumulative[k] = metrics_count_le(&snap, (uint64_t)(bounds_s[k] * 1e9));
+    }
+    if (count != NULL) {
+        *count = snap.count;
+    }
+    if (sum_s != NULL) {
+        *sum_s = (double)snap.sum_ns / 1e9;
+    }
+    return 0;
+}
+
+/* Quantile 'q' (0..1) of histogram 'metric' in seconds; 0 if it is empty, -1 if unknown */
+EXPORT double sensor_metrics_quantile(int metric, double q) {
+    metrics_snapshot_t snap;
+    if (metrics_snapshot(metric, &snap) != 0) {
+        return -1.0;
+    }
+    return (double)metrics_quantile_ns(&snap, q) / 1e9;
+}
+
+/*
+ * Per-sensor counters of the session sweeps (sensor index as in the masks):
+ * successful reads, failed reads and saturated reads. Fills up to 'max'
+ * sensors of each array and returns how many.
+ */
+EXPORT int sensor_metrics_channels(uint64_t *samples, uint64_t *errors, uint64_t *saturated, int max) {
+    if (samples == NULL || errors == NULL || saturated == NULL || max < 0) {
+        return -1;
+    }
+
+    int n = max < METRICS_MAX_CHANNELS ? max : METRICS_MAX_CHANNELS;
+    for (int i = 0; i < n; i++) {
+        metrics_channel_t channel = metrics_channel(i);
+        samples[i] = channel.samples;
+        errors[i] = channel.errors;
+        saturated[i] = channel.saturated;
+    }
+    return n;
+}
+
+/* Kept for existing callers; now served by the shared session. */
+EXPORT SensorData get_sensor_readings(int channel, int sensivity) {
+    return sensor_session_read(channel, sensivity);
 }
 
 #else /* ---------------- Windows implementation Mock ---------------- */
 
+EXPORT int sensor_ring_attach(const char *name) {
+    (void)name;
+    return -1;
+}
+
+EXPORT void sensor_ring_detach(void) {
+}
+
+EXPORT int sensor_ring_read(unsigned int channel_mask, int sensivity, SensorData *out, int timeout_ms) {
+    (void)channel_mask;
+    (void)sensivity;
+    (void)out;
+    (void)timeout_ms;
+    return -1;
+}
+
+EXPORT int sensor_ring_next(uint64_t after_seq, uint64_t sensor_mask, int sensivity,
+                            SensorSample *out, int max_results, int timeout_ms, uint64_t *seq) {
+    (void)after_seq;
+    (void)sensor_mask;
+    (void)sensivity;
+    (void)out;
+    (void)max_results;
+    (void)timeout_ms;
+    (void)seq;
+    return -1;
+}
+
+EXPORT int sensor_session_init(const char *dev_path) {
+    (void)dev_path;
+    return 0;
+}
+
+EXPORT int sensor_encode_frame(const SensorSample *samples, int n, uint64_t seq, int sensivity,
+                               uint8_t *buf, int len) {
+    (void)samples;
+    (void)n;
+    (void)seq;
+    (void)sensivity;
+    (void)buf;
+    (void)len;
+    return -1;
+}
+
+EXPORT void sensor_session_shutdown(void) {
+}
+
+EXPORT int sensor_set_auto_exposure(int enable) {
+    (void)enable;
+    return 0;
+}
+
+EXPORT int sensor_set_retry(int retries, int backoff_us, int timeout_ms) {
+    (void)timeout_ms;
+    return (retries < 0 || backoff_us < 0) ? -1 : 0;
+}
+
+EXPORT const char *sensor_metrics_name(int metric) {
+    (void)metric;
+    return NULL;
+}
+
+EXPORT int sensor_metrics_latency(int metric, const double *bounds_s, int num_bounds,
+                                  uint64_t *cumulative, uint64_t *count, double *sum_s) {
+    (void)metric;
+    (void)bounds_s;
+    (void)num_bounds;
+    (void)cumulative;
+    (void)count;
+    (void)sum_s;
+    return -1;
+}
+
+EXPORT double sensor_metrics_quantile(int metric, double q) {
+    (void)metric;
+    (void)q;
+    return -1.0;
+}
+
+EXPORT int sensor_metrics_channels(uint64_t *samples, uint64_t *errors, uint64_t *saturated, int max) {
+    if (samples == NULL || errors == NULL || saturated == NULL || max < 0) {
+        return -1;
+    }
+
+    int n = max < BRIDGE_MAX_SENSORS ? max : BRIDGE_MAX_SENSORS;
+    for (int i = 0; i < n; i++) {
+        samples[i] = 0;
+        errors[i] = 0;
+        saturated[i] = 0;
+    }
+    return n;
+}
+
 EXPORT SensorData get_sensor_readings(int channel, int sensivity) {
     (void)sensivity;
     SensorData out = {0};
@@ -121,4 +1227,117 @@ EXPORT SensorData get_sensor_readings(int channel, int sensivity) {
     return out;
 }
 
+EXPORT SensorData sensor_session_read(int channel, int sensivity) {
+    return get_sensor_readings(channel, sensivity);
+}
+
+EXPORT int sensor_session_sweep(unsigned int channel_mask, int sensivity, SensorData *out) {
+    int done = 0;
+
+    if (out == NULL) {
+        return 0;
+    }
+
+    for (int ch = 0; ch < 8; ch++) {
+        if (channel_mask & (1u << ch)) {
+            out[ch] = get_sensor_readings(ch, sensivity);
+            done |= (1 << ch);
+        }
+    }
+
+    return done;
+}
+
+EXPORT int sensor_read_batch(uint64_t sensor_mask, int sensivity, SensorSample *out, int max_results, int timeout_ms) {
+    (void)timeout_ms;
+    int n = 0;
+
+    if (out == NULL) {
+        return -1;
+    }
+
+    for (int ch = 0; ch < BRIDGE_MAX_SENSORS; ch++) {
+        if (!(sensor_mask & (1ull << ch))) {
+            continue;
+        }
+        if (n >= max_results) {
+            return -1;
+        }
+
+        SensorData data = get_sensor_readings(ch, sensivity);
+        SensorSample sample = {0};
+        sample.channel = ch;
+        sample.status = BRIDGE_OK;
+        sample.R = data.R;
+        sample.G = data.G;
+        sample.B = data.B;
+        sample.Intensity = data.Intensity;
+        sample.Wavelength = data.Wavelength;
+        out[n++] = sample;
+    }
+
+    return n;
+}
+
+EXPORT int sensor_read_batch_cached(uint64_t sensor_mask, int sensivity, int max_age_ms,
+                                    SensorSample *out, int max_results, int timeout_ms) {
+    (void)max_age_ms;
+    return sensor_read_batch(sensor_mask, sensivity, out, max_results, timeout_ms);
+}
+
+/* Mock sweeps complete synchronously inside sensor_sweep_start */
+static SensorSample mock_results[BRIDGE_MAX_ASYNC][BRIDGE_MAX_SENSORS];
+static int mock_counts[BRIDGE_MAX_ASYNC];
+static int mock_used[BRIDGE_MAX_ASYNC];
+
+EXPORT int sensor_sweep_start(uint64_t sensor_mask, int sensivity, int timeout_ms,
+                              sensor_sweep_cb callback, void *user_data) {
+    for (int slot = 0; slot < BRIDGE_MAX_ASYNC; slot++) {
+        if (!mock_used[slot]) {
+            mock_used[slot] = 1;
+            mock_counts[slot] = sensor_read_batch(sensor_mask, sensivity, mock_results[slot], BRIDGE_MAX_SENSORS, timeout_ms);
+            if (callback != NULL) {
+                callback(slot, user_data);
+            }
+            return slot;
+        }
+    }
+    return -1;
+}
+
+EXPORT int sensor_sweep_poll(int handle) {
+    return (handle >= 0 && handle < BRIDGE_MAX_ASYNC && mock_used[handle]) ? 1 : -1;
+}
+
+EXPORT int sensor_sweep_eventfd(int handle) {
+    (void)handle;
+    return -1;
+}
+
+EXPORT int sensor_sweep_wait(int handle, int timeout_ms) {
+    (void)timeout_ms;
+    return sensor_sweep_poll(handle);
+}
+
+EXPORT int sensor_sweep_complete(int handle, SensorSample *out, int max_results) {
+    if (sensor_sweep_poll(handle) != 1 || out == NULL || max_results < mock_counts[handle]) {
+        return -1;
+    }
+
+    for (int i = 0; i < mock_counts[handle]; i++) {
+        out[i] = mock_results[handle][i];
+    }
+    mock_used[handle] = 0;
+    return mock_counts[handle];
+}
+
+EXPORT int sensor_sweep_cancel(int handle) {
+    if (sensor_sweep_poll(handle) != 1) {
+        return -1;
+    }
+
+    mock_used[handle] = 0;
+    return 0;
+}
+
 #endif
\ No newline at end of file
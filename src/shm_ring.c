@@ -0,0 +1,180 @@
+#include "shm_ring.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+shm_ring_t *shm_ring_create(const char *name, const char *group) {
+    if (name == NULL) {
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, SHM_RING_MODE);
+    if (fd < 0) {
+        perror("Failed to create shared memory ring");
+        return NULL;
+    }
+
+    /* The umask would drop the group write bit; an existing object keeps its old mode */
+    if (fchmod(fd, SHM_RING_MODE) < 0) {
+        perror("Warning: cannot make the shared memory ring group-writable");
+    }
+    if (group != NULL) {
+        struct group *gr = getgrnam(group);
+        if (gr == NULL) {
+            fprintf(stderr, "Warning: no group %s, the shared memory ring keeps the daemon's group\n", group);
+        } else if (fchown(fd, (uid_t)-1, gr->gr_gid) < 0) {
+            perror("Warning: cannot give the shared memory ring to its group");
+        }
+    }
+
+    if (ftruncate(fd, (off_t)sizeof(shm_ring_t)) < 0) {
+        perror("Failed to size shared memory ring");
+        close(fd);
+        return NULL;
+    }
+
+    shm_ring_t *ring = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) {
+        perror("Failed to map shared memory ring");
+        return NULL;
+    }
+
+    /* Header is written last so readers never see a half-initialised ring */
+    ring->magic = 0;
+    memset(ring->slots, 0, sizeof(ring->slots));
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->sens_request, SHM_RING_NO_REQUEST);
+    ring->version = SHM_RING_VERSION;
+    ring->slot_count = SHM_RING_SLOTS;
+    ring->frame_size = (uint32_t)sizeof(acq_frame_t);
+    atomic_thread_fence(memory_order_release);
+    ring->magic = SHM_RING_MAGIC;
+
+    return ring;
+}
+
+shm_ring_t *shm_ring_open(const char *name) {
+    if (name == NULL) {
+        return NULL;
+    }
+
+    /* Read-write: consumers may post a sensitivity request */
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(shm_ring_t)) {
+        close(fd);
+        errno = EPROTO;
+        return NULL;
+    }
+
+    shm_ring_t *ring = mmap(NULL, sizeof(shm_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    int err = errno;
+    close(fd);
+    if (ring == MAP_FAILED) {
+        errno = err;
+        return NULL;
+    }
+
+    if (ring->magic != SHM_RING_MAGIC || ring->version != SHM_RING_VERSION ||
+        ring->slot_count != SHM_RING_SLOTS || ring->frame_size != sizeof(acq_frame_t)) {
+        munmap(ring, sizeof(shm_ring_t));
+        errno = EPROTO;
+        return NULL;
+    }
+
+    return ring;
+}
+
+void shm_ring_close(shm_ring_t *ring) {
+    if (ring != NULL) {
+        munmap(ring, sizeof(shm_ring_t));
+    }
+}
+
+void shm_ring_unlink(const char *name) {
+    if (name != NULL) {
+        shm_unlink(name);
+    }
+}
+
+void shm_ring_publish(shm_ring_t *ring, acq_frame_t *frame) {
+    if (ring == NULL || frame == NULL) {
+        return;
+    }
+
+    uint64_t seq = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    shm_ring_slot_t *slot = &ring->slots[seq & (SHM_RING_SLOTS - 1)];
+
+    frame->seq = seq;
+
+    atomic_store_explicit(&slot->seq, 2 * seq - 1, memory_order_relaxed);      // odd: being written
+    atomic_thread_fence(memory_order_release);
+    slot->frame = *frame;
+    atomic_store_explicit(&slot->seq, 2 * seq, memory_order_release);          // even: complete
+
+    atomic_store_explicit(&ring->head, seq, memory_order_release);
+}
+
+uint64_t shm_ring_head(const shm_ring_t *ring) {
+    if (ring == NULL) {
+        return 0;
+    }
+    return atomic_load_explicit(&((shm_ring_t *)ring)->head, memory_order_acquire);
+}
+
+int shm_ring_read(const shm_ring_t *ring, uint64_t seq, acq_frame_t *out) {
+    if (ring == NULL || out == NULL || seq == 0) {
+        return SHM_RING_ERR;
+    }
+
+    shm_ring_slot_t *slot = (shm_ring_slot_t *)&ring->slots[seq & (SHM_RING_SLOTS - 1)];
+
+    for (;;) {
+        uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before < 2 * seq - 1) {
+            return SHM_RING_EMPTY;
+        }
+        if (before > 2 * seq) {
+            return SHM_RING_OVERRUN;
+        }
+        if (before & 1) {
+            continue;           // Producer is writing this very frame
+        }
+
+        *out = slot->frame;
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) == before) {
+            return SHM_RING_OK;
+        }
+        /* Slot was rewritten during the copy: the frame is gone */
+        return SHM_RING_OVERRUN;
+    }
+}
+
+int shm_ring_latest(const shm_ring_t *ring, acq_frame_t *out) {
+    for (;;) {
+        uint64_t head = shm_ring_head(ring);
+        if (head == 0) {
+            return SHM_RING_EMPTY;
+        }
+
+        int ret = shm_ring_read(ring, head, out);
+        if (ret != SHM_RING_OVERRUN) {
+            return ret;
+        }
+        /* Lapped by the producer while copying: retry with the new head */
+    }
+}
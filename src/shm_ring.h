@@ -0,0 +1,78 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "acq_frame.h"
+
+/* Default POSIX shared memory object published by the acquisition daemon */
+#define SHM_RING_NAME       "/pi_sensor_ring"
+
+/* Consumers map the ring read-write (they post sens_request), so the object
+   is group-writable; the daemon gives it to SHM_RING_GROUP, the group that
+   owns /dev/i2c-* on Raspberry Pi OS and that the API user belongs to */
+#define SHM_RING_MODE       0660
+#define SHM_RING_GROUP      "i2c"
+
+#define SHM_RING_MAGIC      0x56454D4Cu     // "VEML"
+#define SHM_RING_VERSION    4               // 4: sampling tick and jitter per frame
+#define SHM_RING_SLOTS      256             // power of two
+
+/* Error codes */
+#define SHM_RING_OK          0
+#define SHM_RING_ERR        -1
+#define SHM_RING_EMPTY      -2              // frame not published yet
+#define SHM_RING_OVERRUN    -3              // frame already overwritten
+
+#define SHM_RING_NO_REQUEST 0xFFFFFFFFu
+
+/*
+ * Single-producer / multi-consumer ring of frames. Each slot is guarded by a
+ * sequence lock: the producer marks it odd while writing and stores
+ * 2 * frame.seq once the frame is complete. Readers never block the producer;
+ * they copy the slot and retry if the sequence moved under them.
+ */
+typedef struct {
+    _Atomic uint64_t seq;
+    acq_frame_t frame;
+} shm_ring_slot_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t frame_size;
+    _Atomic uint64_t head;                  // sequence number of the last published frame
+    _Atomic uint32_t sens_request;          // sensitivity asked by a consumer, or SHM_RING_NO_REQUEST
+    uint32_t reserved;
+    shm_ring_slot_t slots[SHM_RING_SLOTS];
+} shm_ring_t;
+
+/* Producer: create (or truncate) the shared object with SHM_RING_MODE and
+   map it. 'group' (NULL: the creator's) owns the object; failing to hand it
+   over is only a warning. NULL on error. */
+shm_ring_t *shm_ring_create(const char *name, const char *group);
+
+/* Consumer: map an existing ring. NULL with errno ENOENT if there is none,
+   EACCES if it cannot be opened read-write, or EPROTO if it is incompatible. */
+shm_ring_t *shm_ring_open(const char *name);
+
+/* Unmap a ring (does not remove the shared object) */
+void shm_ring_close(shm_ring_t *ring);
+
+/* Remove the shared object name (producer, on exit) */
+void shm_ring_unlink(const char *name);
+
+/* Producer: publish a frame; its seq field is assigned by the ring */
+void shm_ring_publish(shm_ring_t *ring, acq_frame_t *frame);
+
+/* Sequence number of the newest frame (0 if none yet) */
+uint64_t shm_ring_head(const shm_ring_t *ring);
+
+/* Copy frame 'seq'. Returns SHM_RING_OK, SHM_RING_EMPTY or SHM_RING_OVERRUN. */
+int shm_ring_read(const shm_ring_t *ring, uint64_t seq, acq_frame_t *out);
+
+/* Copy the newest frame. Returns SHM_RING_OK or SHM_RING_EMPTY. */
+int shm_ring_latest(const shm_ring_t *ring, acq_frame_t *out);
+
+#endif // SHM_RING_H
@@ -0,0 +1,509 @@
+#include "sweep.h"
+#include "sweep_prog.h"
+#include "metrics.h"
+
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+
+uint64_t sweep_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void sweep_sleep_until_ns(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        // Interrupted by a signal, keep waiting for the same deadline
+    }
+}
+
+void sweep_init(sweep_ctx_t *ctx, int fd, uint8_t mux_addr, uint8_t sensor_addr) {
+    topo_t topo;
+    if (topo_init(&topo, &mux_addr, 1) != TOPO_OK) {
+        /* Outside 0x70..0x77: keep the address as given */
+        topo.num_muxes = 1;
+        topo.mux_addr[0] = mux_addr;
+    }
+
+    sweep_init_topology(ctx, fd, &topo, sensor_addr);
+}
+
+void sweep_init_topology(sweep_ctx_t *ctx, int fd, const topo_t *topo, uint8_t sensor_addr) {
+    if (ctx == NULL || topo == NULL) {
+        return;
+    }
+
+    ctx->fd = fd;
+    ctx->sensor_addr = sensor_addr;
+    ctx->topo = *topo;
+    for (int m = 0; m < topo->num_muxes; m++) {
+        tca_handle_init(&ctx->mux[m], fd, topo->mux_addr[m]);
+    }
+    ctx->sample_valid = 0;
+    sweep_set_breaker(ctx, SWEEP_TRIP_AFTER, SWEEP_PROBE_NS, SWEEP_PROBE_MAX_NS);
+    sweep_invalidate(ctx);
+}
+
+void sweep_invalidate(sweep_ctx_t *ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    for (int m = 0; m < ctx->topo.num_muxes; m++) {
+        tca_handle_invalidate(&ctx->mux[m]);
+    }
+    ctx->conf_valid = 0;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        ctx->conf[i] = 0;
+        ctx->applied_ns[i] = 0;
+        ctx->period_ns[i] = 0;
+        ctx->ready_ns[i] = 0;
+    }
+}
+
+void sweep_set_breaker(sweep_ctx_t *ctx, int trip_after, uint64_t probe_ns, uint64_t probe_max_ns) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    ctx->trip_after = trip_after > 0 ? trip_after : 0;
+    ctx->probe_ns = probe_ns;
+    ctx->probe_max_ns = probe_max_ns > probe_ns ? probe_max_ns : probe_ns;
+    ctx->tripped = 0;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        ctx->failures[i] = 0;
+        ctx->probe_at_ns[i] = 0;
+        ctx->probe_wait_ns[i] = 0;
+    }
+}
+
+/* Count the outcome of the sensors a sweep tried to configure or read; trip the ones failing too often */
+static void breaker_update(sweep_ctx_t *ctx, uint64_t attempted, uint64_t done) {
+    if (ctx->trip_after == 0) {
+        return;
+    }
+
+    uint64_t now_ns = sweep_now_ns();
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        uint64_t bit = 1ull << i;
+        if (!(attempted & bit)) {
+            continue;
+        }
+        if (done & bit) {
+            ctx->failures[i] = 0;
+            continue;
+        }
+        if (ctx->failures[i] < UINT8_MAX) {
+            ctx->failures[i]++;
+        }
+        if (ctx->failures[i] >= ctx->trip_after) {
+            ctx->tripped |= bit;
+            ctx->probe_wait_ns[i] = ctx->probe_ns;
+            ctx->probe_at_ns[i] = now_ns + ctx->probe_ns;
+        }
+    }
+}
+
+/* Re-probe the isolated sensor that has waited longest past its probe time.
+   One per sweep, after the harvest, so probing never delays a healthy read. */
+static void breaker_probe(sweep_ctx_t *ctx) {
+    uint64_t now_ns = sweep_now_ns();
+    int sensor = -1;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if ((ctx->tripped & (1ull << i)) && ctx->probe_at_ns[i] <= now_ns &&
+            (sensor < 0 || ctx->probe_at_ns[i] < ctx->probe_at_ns[sensor])) {
+            sensor = i;
+        }
+    }
+    if (sensor < 0) {
+        return;
+    }
+
+    uint16_t value;
+    uint64_t bit = 1ull << sensor;
+    if (sweep_select_channel(ctx, sensor) == TCA_OK &&
+        veml3328_read_reg(ctx->fd, ctx->sensor_addr, VEML3328_REG_ID, &value) == VEML3328_OK) {
+        /* Back: it may have been power-cycled, so configure it again */
+        ctx->tripped &= ~bit;
+        ctx->failures[sensor] = 0;
+        ctx->conf_valid &= ~bit;
+        return;
+    }
+
+    uint64_t wait_ns = ctx->probe_wait_ns[sensor] * 2;
+    ctx->probe_wait_ns[sensor] = wait_ns < ctx->probe_max_ns ? wait_ns : ctx->probe_max_ns;
+    ctx->probe_at_ns[sensor] = sweep_now_ns() + ctx->probe_wait_ns[sensor];
+}
+
+/* A CONF write restarts integration: the first sample is valid one IT later */
+static void start_integration(sweep_ctx_t *ctx, int sensor, uint64_t now_ns, const veml3328_cfg_t *cfg) {
+    ctx->applied_ns[sensor] = now_ns;
+    ctx->period_ns[sensor] = (uint64_t)(cfg->it_ms * 1000000.0f);
+    ctx->ready_ns[sensor] = now_ns + ctx->period_ns[sensor];
+}
+
+uint64_t sweep_ready_ns(const sweep_ctx_t *ctx, uint64_t mask) {
+    if (ctx == NULL) {
+        return 0;
+    }
+
+    uint64_t ready_ns = 0;
+    mask &= ctx->conf_valid;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if ((mask & (1ull << i)) && ctx->ready_ns[i] > ready_ns) {
+            ready_ns = ctx->ready_ns[i];
+        }
+    }
+    return ready_ns;
+}
+
+uint64_t sweep_fresh_ns(const sweep_ctx_t *ctx, int sensor) {
+    if (ctx == NULL || sensor < 0 || sensor >= SWEEP_MAX_SENSORS || !(ctx->conf_valid & (1ull << sensor))) {
+        return 0;
+    }
+
+    uint64_t ready_ns = ctx->ready_ns[sensor];
+    uint64_t period_ns = ctx->period_ns[sensor];
+    uint64_t sample_ns = ctx->sample_ns[sensor];
+    if (!(ctx->sample_valid & (1ull << sensor)) || sample_ns < ready_ns || period_ns == 0) {
+        return ready_ns;
+    }
+
+    /* The sample holds the cycle that ended last before it was read */
+    return ready_ns + ((sample_ns - ready_ns) / period_ns + 1) * period_ns;
+}
+
+int sweep_routed_sensor(const sweep_ctx_t *ctx) {
+    if (ctx == NULL) {
+        return -1;
+    }
+
+    int routed = -1;
+    for (int m = 0; m < ctx->topo.num_muxes; m++) {
+        const tca9548a_t *mux = &ctx->mux[m];
+        if (!mux->control_valid) {
+            return -1;
+        }
+        if (mux->control == 0) {
+            continue;
+        }
+        /* More than one channel (or mux) enabled: nothing is singled out */
+        if (routed >= 0 || (mux->control & (mux->control - 1)) != 0) {
+            return -1;
+        }
+        routed = m * TOPO_CHANNELS_PER_MUX + __builtin_ctz(mux->control);
+    }
+
+    return routed;
+}
+
+/* Write one mux if its routing changes, timing the write */
+static int select_mux(tca9548a_t *mux, uint8_t channels) {
+    if (mux->control_valid && mux->control == channels) {
+        return TCA_OK;
+    }
+
+    uint64_t start_ns = metrics_now_ns();
+    int ret = tca_handle_select_mask(mux, channels);
+    metrics_record_since(METRIC_MUX_SELECT, start_ns);
+    return ret;
+}
+
+/* Route every mux to its part of 'mask' (other muxes are disabled) */
+static int select_sensors(sweep_ctx_t *ctx, uint64_t mask) {
+    int target_mux = -1;
+
+    /* Disable first, so two sensors are never routed to the bus together */
+    for (int m = 0; m < ctx->topo.num_muxes; m++) {
+        uint8_t channels = (uint8_t)(mask >> (m * TOPO_CHANNELS_PER_MUX));
+        if (channels == 0) {
+            int ret = select_mux(&ctx->mux[m], 0);
+            if (ret != TCA_OK) {
+                return ret;
+            }
+        } else if (target_mux < 0) {
+            target_mux = m;
+        }
+    }
+
+    for (int m = target_mux; m >= 0 && m < ctx->topo.num_muxes; m++) {
+        uint8_t channels = (uint8_t)(mask >> (m * TOPO_CHANNELS_PER_MUX));
+        if (channels == 0) {
+            continue;
+        }
+        int ret = select_mux(&ctx->mux[m], channels);
+        if (ret != TCA_OK) {
+            return ret;
+        }
+    }
+
+    return TCA_OK;
+}
+
+int sweep_select_channel(sweep_ctx_t *ctx, int sensor) {
+    if (ctx == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+
+    if (sensor < 0 || sensor >= topo_num_sensors(&ctx->topo)) {
+        return TCA_INVALID_CHANNEL;
+    }
+
+    return select_sensors(ctx, 1ull << sensor);
+}
+
+int sweep_read_sensor(sweep_ctx_t *ctx, int sensor, veml3328_raw_data_t *raw) {
+    if (ctx == NULL || raw == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+
+    int ret = sweep_select_channel(ctx, sensor);
+    if (ret != TCA_OK) {
+        return ret;
+    }
+
+    uint64_t start_ns = metrics_now_ns();
+    ret = veml3328_read_all(ctx->fd, ctx->sensor_addr, raw);
+    metrics_record_since(METRIC_VEML_READ_ALL, start_ns);
+    return ret;
+}
+
+int sweep_disable_all(sweep_ctx_t *ctx) {
+    if (ctx == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+
+    return select_sensors(ctx, 0);
+}
+
+int sweep_apply_cfg(sweep_ctx_t *ctx, int sensor, const veml3328_cfg_t *cfg, int *changed) {
+    if (ctx == NULL || cfg == NULL || changed == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+
+    *changed = 0;
+    if (sensor < 0 || sensor >= topo_num_sensors(&ctx->topo)) {
+        return TCA_INVALID_CHANNEL;
+    }
+
+    uint16_t conf = veml3328_encode_cfg(cfg);
+    uint64_t bit = 1ull << sensor;
+
+    if ((ctx->conf_valid & bit) && ctx->conf[sensor] == conf) {
+        return VEML3328_OK;
+    }
+
+    int ret = veml3328_write_reg(ctx->fd, ctx->sensor_addr, VEML3328_REG_CONF, conf);
+    if (ret != VEML3328_OK) {
+        ctx->conf_valid &= ~bit;
+        return ret;
+    }
+
+    ctx->conf[sensor] = conf;
+    ctx->conf_valid |= bit;
+    start_integration(ctx, sensor, sweep_now_ns(), cfg);
+    *changed = 1;
+    return VEML3328_OK;
+}
+
+int sweep_configure_all(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg) {
+    if (ctx == NULL || cfg == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+
+    mask &= topo_all_sensors(&ctx->topo);
+    if (mask == 0) {
+        return SWEEP_OK;
+    }
+
+    int ret = select_sensors(ctx, mask);
+    if (ret != TCA_OK) {
+        return ret;
+    }
+
+    uint16_t conf = veml3328_encode_cfg(cfg);
+    ret = veml3328_write_reg(ctx->fd, ctx->sensor_addr, VEML3328_REG_CONF, conf);
+    if (ret != VEML3328_OK) {
+        ctx->conf_valid &= ~mask;
+        return ret;
+    }
+
+    uint64_t now_ns = sweep_now_ns();
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if (mask & (1ull << i)) {
+            ctx->conf[i] = conf;
+            start_integration(ctx, i, now_ns, cfg);
+        }
+    }
+    ctx->conf_valid |= mask;
+    return SWEEP_OK;
+}
+
+/* Sensors in 'mask' whose cached CONF differs from the requested one */
+static uint64_t stale_sensors(const sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg) {
+    uint64_t stale = 0;
+
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        uint64_t bit = 1ull << i;
+        if ((mask & bit) &&
+            (!(ctx->conf_valid & bit) || ctx->conf[i] != veml3328_encode_cfg(&cfg[i]))) {
+            stale |= bit;
+        }
+    }
+
+    return stale;
+}
+
+/* Phase 3: read 'configured' back-to-back, with as few mux writes as possible */
+static int harvest(sweep_ctx_t *ctx, uint64_t configured, veml3328_raw_data_t *raw,
+                   uint64_t *read_ns, uint64_t *done) {
+    uint8_t order[SWEEP_MAX_SENSORS];
+    int n = topo_schedule(&ctx->topo, configured, sweep_routed_sensor(ctx), order);
+
+    /* Selects and reads of several sensors per combined transaction */
+    if (i2c_bus_combined(ctx->fd)) {
+        sweep_prog_t prog;
+        if (sweep_prog_build(&prog, ctx, order, n) == SWEEP_PROG_OK) {
+            return sweep_prog_run(&prog, ctx, raw, read_ns, done);
+        }
+    }
+
+    *done = 0;
+    for (int k = 0; k < n; k++) {
+        int i = order[k];
+        if (sweep_read_sensor(ctx, i, &raw[i]) != VEML3328_OK) {
+            ctx->conf_valid &= ~(1ull << i);
+            continue;
+        }
+
+        *done |= 1ull << i;
+        read_ns[i] = sweep_now_ns();
+    }
+
+    return SWEEP_OK;
+}
+
+/* Sweep 'mask'; with 'cached' set, sensors with nothing fresh yet get their last sample */
+static int run_sensors(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg,
+                       veml3328_raw_data_t *raw, uint64_t *read_ns, uint64_t *done, uint64_t *cached) {
+    if (ctx == NULL || cfg == NULL || raw == NULL || done == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+
+    uint64_t start_ns = sweep_now_ns();
+    mask &= topo_all_sensors(&ctx->topo) & ~ctx->tripped;
+    uint64_t pending = stale_sensors(ctx, mask, cfg);
+    uint64_t configured = mask & ~pending;
+
+    /* Phase 1: start integration on every sensor that needs a new config.
+       Sensors sharing a configuration are written in one broadcast. */
+    while (pending) {
+        int first = __builtin_ctzll(pending);
+        uint16_t conf = veml3328_encode_cfg(&cfg[first]);
+
+        uint64_t group = 0;
+        for (int i = first; i < SWEEP_MAX_SENSORS; i++) {
+            if ((pending & (1ull << i)) && veml3328_encode_cfg(&cfg[i]) == conf) {
+                group |= 1ull << i;
+            }
+        }
+        pending &= ~group;
+
+        if (sweep_configure_all(ctx, group, &cfg[first]) == SWEEP_OK) {
+            configured |= group;
+        }
+    }
+
+    /* Sensors still integrating hand out what they last returned */
+    uint64_t served = 0;
+    if (cached != NULL) {
+        uint64_t now_ns = sweep_now_ns();
+        for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+            uint64_t bit = 1ull << i;
+            if ((configured & ctx->sample_valid & bit) && now_ns < sweep_fresh_ns(ctx, i)) {
+                raw[i] = ctx->sample[i];
+                if (read_ns != NULL) {
+                    read_ns[i] = ctx->sample_ns[i];
+                }
+                served |= bit;
+            }
+        }
+        configured &= ~served;
+        *cached = served;
+    }
+
+    /* Re-reading a sensor before its cycle ends returns the latched counts of
+       its last read again: wait for a new sample, not just for valid data */
+    uint64_t deadline_ns = 0;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        if ((configured & (1ull << i)) && sweep_fresh_ns(ctx, i) > deadline_ns) {
+            deadline_ns = sweep_fresh_ns(ctx, i);
+        }
+    }
+
+    /* Phase 2: one integration period covers every sensor */
+    if (deadline_ns > sweep_now_ns()) {
+        sweep_sleep_until_ns(deadline_ns);
+    }
+
+    uint64_t times[SWEEP_MAX_SENSORS];
+    int ret = harvest(ctx, configured, raw, times, done);
+    if (ret != SWEEP_OK) {
+        metrics_record_since(METRIC_SWEEP, start_ns);
+        return ret;
+    }
+
+    /* Phase 4: isolate sensors that keep failing, give one isolated sensor a chance */
+    breaker_update(ctx, mask & ~served, *done);
+    if (ctx->tripped != 0) {
+        breaker_probe(ctx);
+    }
+
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        uint64_t bit = 1ull << i;
+        if (!(*done & bit)) {
+            continue;
+        }
+        ctx->sample[i] = raw[i];
+        ctx->sample_ns[i] = times[i];
+        ctx->sample_conf[i] = ctx->conf[i];
+        ctx->sample_valid |= bit;
+        if (read_ns != NULL) {
+            read_ns[i] = times[i];
+        }
+    }
+
+    *done |= served;
+    metrics_record_since(METRIC_SWEEP, start_ns);
+    return SWEEP_OK;
+}
+
+int sweep_run_sensors(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg,
+                      veml3328_raw_data_t *raw, uint64_t *read_ns, uint64_t *done) {
+    return run_sensors(ctx, mask, cfg, raw, read_ns, done, NULL);
+}
+
+int sweep_poll_sensors(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg,
+                       veml3328_raw_data_t *raw, uint64_t *read_ns, uint64_t *done, uint64_t *cached) {
+    if (cached == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+    *cached = 0;
+    return run_sensors(ctx, mask, cfg, raw, read_ns, done, cached);
+}
+
+int sweep_run(sweep_ctx_t *ctx, uint8_t mask, const veml3328_cfg_t cfg[SWEEP_NUM_CHANNELS],
+              veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS], uint64_t read_ns[SWEEP_NUM_CHANNELS]) {
+    uint64_t done;
+    int ret = sweep_run_sensors(ctx, mask, cfg, raw, read_ns, &done);
+    if (ret != SWEEP_OK) {
+        return ret;
+    }
+
+    return (int)(done & 0xFF);
+}
@@ -0,0 +1,147 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include "veml3328.h"
+#include "tca9548a.h"
+#include "topology.h"
+
+#define SWEEP_NUM_CHANNELS  8                   // channels of the first mux (legacy API)
+#define SWEEP_MAX_SENSORS   TOPO_MAX_SENSORS
+
+/* Error codes */
+#define SWEEP_OK            0
+#define SWEEP_ERR_BUS      -1
+#define SWEEP_ERR_NULL     -2
+
+/* Circuit breaker defaults: a sensor whose reads fail this many sweeps in a
+   row is left out of the sweeps and re-probed, first after SWEEP_PROBE_NS,
+   then at doubling intervals up to SWEEP_PROBE_MAX_NS */
+#define SWEEP_TRIP_AFTER    3
+#define SWEEP_PROBE_NS      1000000000ull
+#define SWEEP_PROBE_MAX_NS  30000000000ull
+
+/*
+ * Cached view of the hardware behind the muxes of one bus. Every VEML3328
+ * keeps integrating on its own once configured, so the cache lets a sweep
+ * skip mux writes and CONF writes that would not change anything. Sensors
+ * are indexed as in topology.h.
+ */
+typedef struct {
+    int fd;
+    uint8_t sensor_addr;
+    topo_t topo;
+    tca9548a_t mux[TOPO_MAX_MUXES];             // cache the routing, one per topology mux
+    uint64_t conf_valid;                        // bit n set: conf[n] reflects sensor n
+    uint16_t conf[SWEEP_MAX_SENSORS];           // last CONF value written per sensor
+    uint64_t applied_ns[SWEEP_MAX_SENSORS];     // when the last CONF write restarted integration
+    uint64_t period_ns[SWEEP_MAX_SENSORS];      // integration time of that CONF
+    uint64_t ready_ns[SWEEP_MAX_SENSORS];       // first valid sample after the last CONF write
+
+    /* Last sample read from each sensor, kept for reads that cannot wait */
+    uint64_t sample_valid;                      // bit n set: sample[n] holds a read of sensor n
+    veml3328_raw_data_t sample[SWEEP_MAX_SENSORS];
+    uint64_t sample_ns[SWEEP_MAX_SENSORS];      // monotonic time of the read
+    uint16_t sample_conf[SWEEP_MAX_SENSORS];    // CONF the sample was integrated with
+
+    /* Circuit breaker: failing sensors are isolated so they cannot slow the others */
+    int trip_after;                             // consecutive failures that trip (0: never)
+    uint64_t probe_ns;                          // first re-probe delay
+    uint64_t probe_max_ns;
+    uint64_t tripped;                           // bit n set: sensor n is isolated
+    uint8_t failures[SWEEP_MAX_SENSORS];        // consecutive failed reads
+    uint64_t probe_at_ns[SWEEP_MAX_SENSORS];    // next re-probe of an isolated sensor
+    uint64_t probe_wait_ns[SWEEP_MAX_SENSORS];  // current re-probe interval
+} sweep_ctx_t;
+
+/* Monotonic clock in nanoseconds */
+uint64_t sweep_now_ns(void);
+
+/* Sleep until an absolute CLOCK_MONOTONIC deadline */
+void sweep_sleep_until_ns(uint64_t deadline_ns);
+
+/* Bind a context to an open bus with a single mux. The cache starts empty. */
+void sweep_init(sweep_ctx_t *ctx, int fd, uint8_t mux_addr, uint8_t sensor_addr);
+
+/* Bind a context to an open bus with several cascaded muxes */
+void sweep_init_topology(sweep_ctx_t *ctx, int fd, const topo_t *topo, uint8_t sensor_addr);
+
+/* Forget all cached hardware state (use after a bus error) */
+void sweep_invalidate(sweep_ctx_t *ctx);
+
+/* Circuit breaker settings (trip_after 0 disables it); resets every sensor
+   to healthy. Defaults: SWEEP_TRIP_AFTER, SWEEP_PROBE_NS, SWEEP_PROBE_MAX_NS. */
+void sweep_set_breaker(sweep_ctx_t *ctx, int trip_after, uint64_t probe_ns, uint64_t probe_max_ns);
+
+/* Sensor currently routed to the bus, or -1 if none (or unknown) */
+int sweep_routed_sensor(const sweep_ctx_t *ctx);
+
+/* Latest ready_ns among the configured sensors in 'mask' (0 if none): the
+   sensors integrate back-to-back from there, one cycle per IT */
+uint64_t sweep_ready_ns(const sweep_ctx_t *ctx, uint64_t mask);
+
+/* Earliest time sensor 'sensor' holds a sample newer than its cached one:
+   ready_ns after a CONF write, then the end of each integration cycle.
+   0 if the sensor is not configured. */
+uint64_t sweep_fresh_ns(const sweep_ctx_t *ctx, int sensor);
+
+/* Route the bus to one sensor, disabling the other muxes first.
+   Writes that would not change a mux are skipped. */
+int sweep_select_channel(sweep_ctx_t *ctx, int sensor);
+
+/* Route the bus to one sensor and read its four channels. Returns
+   VEML3328_OK, or the mux or sensor error. */
+int sweep_read_sensor(sweep_ctx_t *ctx, int sensor, veml3328_raw_data_t *raw);
+
+/* Disable every mux of the topology */
+int sweep_disable_all(sweep_ctx_t *ctx);
+
+/* Write the configuration of one (already selected) sensor if it changed.
+   *changed is set when the sensor starts a new integration cycle.
+   TCA_INVALID_CHANNEL if 'sensor' is not in the topology. */
+int sweep_apply_cfg(sweep_ctx_t *ctx, int sensor, const veml3328_cfg_t *cfg, int *changed);
+
+/*
+ * Write one configuration to every sensor in 'mask' with a single CONF write:
+ * all sensors share the same address, so with their channels enabled together
+ * (on any number of muxes) they all latch the same write. Absent sensors
+ * cannot be detected here (any ACK completes the write); the following read
+ * will catch them.
+ */
+int sweep_configure_all(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg);
+
+/*
+ * Pipelined sweep over the sensors in 'mask':
+ *   1. (re)configure every sensor that needs it, broadcasting to sensors
+ *      that share a configuration,
+ *   2. wait once until every sensor holds a sample newer than its last
+ *      read (sweep_fresh_ns()), so no sample is returned twice,
+ *   3. read all sensors back-to-back, in topo_schedule() order,
+ *   4. re-probe at most one isolated sensor whose probe is due; a sensor
+ *      that answers rejoins (and is reconfigured) on the next sweep.
+ * Isolated sensors (ctx->tripped) are skipped and never in *done.
+ * cfg, raw and read_ns are indexed by sensor and only accessed for sensors in
+ * 'mask'; read_ns (optional, may be NULL) receives the monotonic time each
+ * sensor was read. *done receives the mask of sensors read successfully.
+ * Every sample read is also kept in the context (sample[]).
+ */
+int sweep_run_sensors(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg,
+                      veml3328_raw_data_t *raw, uint64_t *read_ns, uint64_t *done);
+
+/*
+ * sweep_run_sensors() that never waits for a sensor it has a sample of:
+ * sensors whose next fresh sample is not ready yet (sweep_fresh_ns()) get
+ * their cached sample instead, with read_ns set to when it was read, and
+ * are flagged in *cached (also part of *done); the sample may predate a
+ * CONF change, ctx->sample_conf[] tells which CONF it was taken with. Only
+ * sensors without any sample are waited for, precisely until ready_ns.
+ */
+int sweep_poll_sensors(sweep_ctx_t *ctx, uint64_t mask, const veml3328_cfg_t *cfg,
+                       veml3328_raw_data_t *raw, uint64_t *read_ns, uint64_t *done, uint64_t *cached);
+
+/* sweep_run_sensors() over the channels of the first mux. Returns the mask
+   of channels read successfully, or SWEEP_ERR_NULL. */
+int sweep_run(sweep_ctx_t *ctx, uint8_t mask, const veml3328_cfg_t cfg[SWEEP_NUM_CHANNELS],
+              veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS], uint64_t read_ns[SWEEP_NUM_CHANNELS]);
+
+#endif // SWEEP_H
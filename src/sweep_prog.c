@@ -0,0 +1,200 @@
+#include "sweep_prog.h"
+
+#include <stddef.h>
+#include <string.h>
+
+static const uint8_t read_regs[4] = {
+    VEML3328_REG_clear, VEML3328_REG_RED, VEML3328_REG_GREEN, VEML3328_REG_BLUE
+};
+
+static void add_msg(sweep_prog_t *prog, uint8_t addr, uint16_t flags, uint16_t len, uint8_t *buf) {
+    prog->msgs[prog->num_msgs++] = (i2c_xfer_msg_t){ addr, flags, len, buf };
+}
+
+/* Start a transaction whose reads (if any) are those of order[first_sensor] on */
+static sweep_prog_batch_t *new_batch(sweep_prog_t *prog, int first_sensor) {
+    sweep_prog_batch_t *batch = &prog->batch[prog->num_batches++];
+    batch->first_msg = prog->num_msgs;
+    batch->num_msgs = 0;
+    batch->first_sensor = first_sensor;
+    batch->num_sensors = 0;
+    batch->switches = 0;
+    return batch;
+}
+
+int sweep_prog_build(sweep_prog_t *prog, const sweep_ctx_t *ctx, const uint8_t *order, int n) {
+    if (prog == NULL || ctx == NULL || order == NULL || n < 0 || n > SWEEP_MAX_SENSORS) {
+        return SWEEP_PROG_ERR;
+    }
+
+    int num_muxes = ctx->topo.num_muxes;
+    prog->fd = ctx->fd;
+    prog->num_muxes = num_muxes;
+    prog->start_valid = 0;
+    prog->num_sensors = 0;
+    prog->num_batches = 0;
+    prog->num_msgs = 0;
+    memcpy(prog->regs, read_regs, sizeof(read_regs));
+
+    /* Mux state as the messages leave it */
+    uint8_t control[TOPO_MAX_MUXES] = {0};
+    uint8_t known = 0;
+    for (int m = 0; m < num_muxes; m++) {
+        prog->start_control[m] = ctx->mux[m].control;
+        if (ctx->mux[m].control_valid) {
+            prog->start_valid |= (uint8_t)(1u << m);
+            control[m] = ctx->mux[m].control;
+            known |= (uint8_t)(1u << m);
+        }
+    }
+
+    int num_writes = 0;
+    sweep_prog_batch_t *batch = NULL;
+
+    for (int k = 0; k < n; k++) {
+        int sensor = order[k];
+        if (sensor >= topo_num_sensors(&ctx->topo)) {
+            return SWEEP_PROG_ERR;
+        }
+        int target_mux = sensor / TOPO_CHANNELS_PER_MUX;
+        uint8_t target = (uint8_t)(1u << (sensor % TOPO_CHANNELS_PER_MUX));
+
+        /* Disable the other muxes first, so two sensors never share the bus */
+        uint8_t writes = 0;
+        for (int m = 0; m < num_muxes; m++) {
+            uint8_t want = (m == target_mux) ? target : 0;
+            if (!(known & (1u << m)) || control[m] != want) {
+                writes |= (uint8_t)(1u << m);
+            }
+        }
+
+        /* The mux writes close the current transaction (after the reads of
+           the previous sensor): the channels switch on its STOP */
+        int num_mux_writes = __builtin_popcount(writes);
+        if (num_mux_writes > 0) {
+            if (batch == NULL || batch->num_msgs + num_mux_writes > I2C_MAX_MSGS) {
+                batch = new_batch(prog, k);
+            }
+            for (int pass = 0; pass < 2; pass++) {
+                for (int m = 0; m < num_muxes; m++) {
+                    /* pass 0: disables, pass 1: the mux of the sensor */
+                    if (!(writes & (1u << m)) || (m == target_mux) != (pass == 1)) {
+                        continue;
+                    }
+                    control[m] = (m == target_mux) ? target : 0;
+                    prog->control[num_writes] = control[m];
+                    add_msg(prog, ctx->mux[m].dev_addr, 0, 1, &prog->control[num_writes++]);
+                }
+            }
+            batch->num_msgs += num_mux_writes;
+            batch->switches = 1;
+            memcpy(batch->control, control, sizeof(control));
+        }
+        known = (uint8_t)((1u << num_muxes) - 1);
+
+        /* The reads need the new routing: a later transaction */
+        if (batch == NULL || batch->switches || batch->num_msgs + SWEEP_PROG_READ_MSGS > I2C_MAX_MSGS) {
+            batch = new_batch(prog, k);
+            memcpy(batch->control, control, sizeof(control));
+        }
+        for (int r = 0; r < 4; r++) {
+            add_msg(prog, ctx->sensor_addr, 0, 1, &prog->regs[r]);
+            add_msg(prog, ctx->sensor_addr, I2C_XFER_RD, 2, &prog->rx[k][2 * r]);
+        }
+        batch->num_msgs += SWEEP_PROG_READ_MSGS;
+        batch->num_sensors++;
+        prog->order[prog->num_sensors++] = (uint8_t)sensor;
+    }
+
+    return SWEEP_PROG_OK;
+}
+
+/* The mux cache of 'ctx' must match what the program was built for */
+static int prog_matches(const sweep_prog_t *prog, const sweep_ctx_t *ctx) {
+    if (prog->fd != ctx->fd || prog->num_muxes != ctx->topo.num_muxes) {
+        return 0;
+    }
+
+    for (int m = 0; m < prog->num_muxes; m++) {
+        if ((prog->start_valid & (1u << m)) &&
+            (!ctx->mux[m].control_valid || ctx->mux[m].control != prog->start_control[m])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void decode_raw(const uint8_t rx[8], veml3328_raw_data_t *out) {
+    out->clear = (uint16_t)rx[0] | ((uint16_t)rx[1] << 8);     // LSB | MSB
+    out->red   = (uint16_t)rx[2] | ((uint16_t)rx[3] << 8);
+    out->green = (uint16_t)rx[4] | ((uint16_t)rx[5] << 8);
+    out->blue  = (uint16_t)rx[6] | ((uint16_t)rx[7] << 8);
+}
+
+/* One sensor the classic way: select, then a batched register read */
+static void read_one(sweep_ctx_t *ctx, int sensor, veml3328_raw_data_t *raw, uint64_t *read_ns, uint64_t *done) {
+    if (sweep_read_sensor(ctx, sensor, &raw[sensor]) != VEML3328_OK) {
+        ctx->conf_valid &= ~(1ull << sensor);
+        return;
+    }
+
+    *done |= 1ull << sensor;
+    if (read_ns != NULL) {
+        read_ns[sensor] = sweep_now_ns();
+    }
+}
+
+int sweep_prog_run(sweep_prog_t *prog, sweep_ctx_t *ctx, veml3328_raw_data_t *raw,
+                   uint64_t *read_ns, uint64_t *done) {
+    if (prog == NULL || ctx == NULL || raw == NULL || done == NULL) {
+        return SWEEP_ERR_NULL;
+    }
+    if (!prog_matches(prog, ctx)) {
+        return SWEEP_PROG_ERR_STALE;
+    }
+
+    *done = 0;
+    for (int b = 0; b < prog->num_batches; b++) {
+        sweep_prog_batch_t *batch = &prog->batch[b];
+        int first = batch->first_sensor;
+        int last = first + batch->num_sensors;
+
+        if (i2c_transfer(ctx->fd, &prog->msgs[batch->first_msg], batch->num_msgs) == 0) {
+            uint64_t now_ns = sweep_now_ns();
+            for (int k = first; k < last; k++) {
+                int sensor = prog->order[k];
+                decode_raw(prog->rx[k], &raw[sensor]);
+                *done |= 1ull << sensor;
+                if (read_ns != NULL) {
+                    read_ns[sensor] = now_ns;
+                }
+            }
+
+            for (int m = 0; m < prog->num_muxes; m++) {
+                ctx->mux[m].control = batch->control[m];
+                ctx->mux[m].control_valid = 1;
+            }
+            continue;
+        }
+
+        /* A NACK aborts the whole transaction, leaving the muxes anywhere:
+           redo the batch sensor by sensor to tell which one failed */
+        for (int m = 0; m < prog->num_muxes; m++) {
+            tca_handle_invalidate(&ctx->mux[m]);
+        }
+        for (int k = first; k < last; k++) {
+            read_one(ctx, prog->order[k], raw, read_ns, done);
+        }
+
+        /* The next batch reads order[last] and needs the routing this one
+           should have left: select it, or read the rest one by one */
+        if (last < prog->num_sensors && sweep_select_channel(ctx, prog->order[last]) != TCA_OK) {
+            for (int k = last; k < prog->num_sensors; k++) {
+                read_one(ctx, prog->order[k], raw, read_ns, done);
+            }
+            return SWEEP_OK;
+        }
+    }
+
+    return SWEEP_OK;
+}
@@ -0,0 +1,79 @@
+#ifndef SWEEP_PROG_H
+#define SWEEP_PROG_H
+
+#include <stdint.h>
+#include "i2c_driver_pi.h"
+#include "sweep.h"
+
+/*
+ * Sweep program: the harvest phase of a sweep compiled into I2C messages.
+ * For every sensor, in order, the mux control writes that route it (other
+ * muxes disabled first) are followed by the four register write/read pairs
+ * of its C, R, G and B channels. Writes that would not change a mux are left
+ * out. The messages are cut into batches of at most I2C_MAX_MSGS, each run
+ * as one combined transaction (one I2C_RDWR).
+ *
+ * A TCA9548A only switches channels at the STOP that ends the transaction
+ * carrying its control write, so mux writes always end a batch: a batch is
+ * the reads of one routed sensor followed by the writes routing the next.
+ * A sweep of n sensors costs n + 1 kernel entries instead of two per sensor.
+ *
+ * A program assumes the mux state the context had when it was built and
+ * records the state each batch leaves behind. It keeps pointers into itself:
+ * build it where it will be run and do not copy it.
+ */
+
+#define SWEEP_PROG_READ_MSGS    8               // 4 register write/read pairs per sensor
+#define SWEEP_PROG_MAX_WRITES   (TOPO_MAX_MUXES + 2 * SWEEP_MAX_SENSORS)
+#define SWEEP_PROG_MAX_MSGS     (SWEEP_PROG_MAX_WRITES + SWEEP_PROG_READ_MSGS * SWEEP_MAX_SENSORS)
+
+/* Error codes */
+#define SWEEP_PROG_OK            0
+#define SWEEP_PROG_ERR          -1              // bad argument
+#define SWEEP_PROG_ERR_STALE    -2              // mux state differs from the one the program assumes
+
+typedef struct {
+    int first_msg;
+    int num_msgs;
+    int first_sensor;                           // index into order[]
+    int num_sensors;
+    int switches;                               // ends with mux writes
+    uint8_t control[TOPO_MAX_MUXES];            // mux state once the batch ran
+} sweep_prog_batch_t;
+
+typedef struct {
+    int fd;
+    int num_muxes;
+    uint8_t start_valid;                        // bit m: the state of mux m is assumed known
+    uint8_t start_control[TOPO_MAX_MUXES];
+
+    int num_sensors;
+    uint8_t order[SWEEP_MAX_SENSORS];
+    int num_batches;
+    sweep_prog_batch_t batch[SWEEP_MAX_SENSORS + 1];
+
+    int num_msgs;
+    i2c_xfer_msg_t msgs[SWEEP_PROG_MAX_MSGS];
+    uint8_t regs[4];                            // register pointers written before each read
+    uint8_t control[SWEEP_PROG_MAX_WRITES];     // control bytes of the mux writes
+    uint8_t rx[SWEEP_MAX_SENSORS][8];           // C, R, G, B of each sensor, LSB first
+} sweep_prog_t;
+
+/*
+ * Compile the harvest of the 'n' sensors of 'order' (e.g. topo_schedule())
+ * starting from the mux state cached in 'ctx'.
+ * Returns SWEEP_PROG_OK or SWEEP_PROG_ERR.
+ */
+int sweep_prog_build(sweep_prog_t *prog, const sweep_ctx_t *ctx, const uint8_t *order, int n);
+
+/*
+ * Run a program built for 'ctx'. raw[] and read_ns[] (optional) are indexed
+ * by sensor; *done receives the mask of sensors read. A failed batch is
+ * retried sensor by sensor, so one absent sensor only loses itself. The mux
+ * cache of 'ctx' follows the batches.
+ * Returns SWEEP_OK, SWEEP_ERR_NULL or SWEEP_PROG_ERR_STALE (nothing was run).
+ */
+int sweep_prog_run(sweep_prog_t *prog, sweep_ctx_t *ctx, veml3328_raw_data_t *raw,
+                   uint64_t *read_ns, uint64_t *done);
+
+#endif // SWEEP_PROG_H
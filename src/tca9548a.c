@@ -44,4 +44,59 @@ int tca_select_channel(int i2c_fd, uint8_t dev_addr_7bit, int channel) {
 
 int tca_disable_all(int i2c_fd, uint8_t dev_addr_7bit) {
     return tca_write_control(i2c_fd, dev_addr_7bit, 0x00);
-}
\ No newline at end of file
+}
+
+int tca_select_mask(int i2c_fd, uint8_t dev_addr_7bit, uint8_t mask) {
+    return tca_write_control(i2c_fd, dev_addr_7bit, mask);
+}
+
+void tca_handle_init(tca9548a_t *tca, int i2c_fd, uint8_t dev_addr_7bit) {
+    if (tca == NULL) {
+        return;
+    }
+
+    tca->i2c_fd = i2c_fd;
+    tca->dev_addr = dev_addr_7bit;
+    tca_handle_invalidate(tca);
+}
+
+void tca_handle_invalidate(tca9548a_t *tca) {
+    if (tca == NULL) {
+        return;
+    }
+
+    tca->control = 0x00;
+    tca->control_valid = 0;
+}
+
+int tca_handle_select_mask(tca9548a_t *tca, uint8_t mask) {
+    if (tca == NULL) {
+        return TCA_ERR_I2C_WRITE;
+    }
+
+    if (tca->control_valid && tca->control == mask) {
+        return TCA_OK;      // Routing already in place
+    }
+
+    int ret = tca_write_control(tca->i2c_fd, tca->dev_addr, mask);
+    if (ret != TCA_OK) {
+        tca->control_valid = 0;     // Unknown state after a failed write
+        return ret;
+    }
+
+    tca->control = mask;
+    tca->control_valid = 1;
+    return TCA_OK;
+}
+
+int tca_handle_select_channel(tca9548a_t *tca, int channel) {
+    uint8_t control = tca_encode_channel(channel);
+    if (control == TCA_INVALID_CHANNEL) {
+        return TCA_INVALID_CHANNEL;
+    }
+    return tca_handle_select_mask(tca, control);
+}
+
+int tca_handle_disable_all(tca9548a_t *tca) {
+    return tca_handle_select_mask(tca, 0x00);
+}
@@ -27,6 +27,35 @@ int tca_select_channel(int i2c_fd, uint8_t dev_addr_7bit, int channel);
 /* Disable all channels*/
 int tca_disable_all(int i2c_fd, uint8_t dev_addr_7bit);
 
+/* Enable every channel set in 'mask' at once (bit n = channel n)*/
+int tca_select_mask(int i2c_fd, uint8_t dev_addr_7bit, uint8_t mask);
+
+/*
+ * Stateful multiplexer handle. Remembers the last control byte written so
+ * that selects which would not change the routing skip the bus write.
+ */
+typedef struct {
+    int i2c_fd;
+    uint8_t dev_addr;
+    uint8_t control;        // last control byte written
+    int control_valid;      // 0 until the first successful write (or after an error)
+} tca9548a_t;
+
+/* Bind a handle to a mux; the control byte is unknown until first write*/
+void tca_handle_init(tca9548a_t *tca, int i2c_fd, uint8_t dev_addr_7bit);
+
+/* Forget the cached control byte (e.g. after a bus error or mux reset)*/
+void tca_handle_invalidate(tca9548a_t *tca);
+
+/* Route the bus to every channel in 'mask', skipping the write if unchanged*/
+int tca_handle_select_mask(tca9548a_t *tca, uint8_t mask);
+
+/* Route the bus to a single channel, skipping the write if unchanged*/
+int tca_handle_select_channel(tca9548a_t *tca, int channel);
+
+/* Disable all channels, skipping the write if already disabled*/
+int tca_handle_disable_all(tca9548a_t *tca);
+
 
 
 
@@ -5,10 +5,12 @@
 #include "i2c_driver_pi.h"
 #include "tca9548a.h"
 #include "veml3328.h"
+#include "topology.h"
+#include "sample_timer.h"
 
 #define I2C_DEV_PATH    "/dev/i2c-1"
-#define TCA9548A_ADDR   0x70
 #define VEML3328_ADDR   VEML3328_I2C_ADDR
+#define READ_MARGIN_NS  1000000ull      // read 1 ms after each integration cycle ends
 
 static const veml3328_cfg_t test_cfg = {
     .gain_factor = 4.0f,
@@ -22,15 +24,17 @@ static const veml3328_cfg_t test_cfg = {
 int main(int argc, char *argv[]) {
     if (argc < 2)
     {
-        fprintf(stderr, "USAGE: %s <channel_index 0-7> [num_samples]\n", argv[0]);
+        fprintf(stderr, "USAGE: %s <sensor_index 0-63> [num_samples] [bus] [muxes]\n", argv[0]);
         return EXIT_FAILURE;
     }
     
     int channel = atoi(argv[1]);
     int num_samples = argc >= 3 ? atoi(argv[2]) : 1;
+    const char *bus_path = argc >= 4 ? argv[3] : I2C_DEV_PATH;
+    const char *mux_spec = argc >= 5 ? argv[4] : NULL;      // e.g. "0x70,0x71" or "auto"
     
-    if(channel < 0 || channel > 7) {
-        fprintf(stderr, "ERROR: Channel index must be between 0 and 7.\n");
+    if(channel < 0 || channel >= TOPO_MAX_SENSORS) {
+        fprintf(stderr, "ERROR: Sensor index must be between 0 and %d.\n", TOPO_MAX_SENSORS - 1);
         return EXIT_FAILURE;
     }
 
@@ -39,30 +43,43 @@ int main(int argc, char *argv[]) {
         num_samples = 1;
     }
     
-    printf("Testing TCA channel %d for %d samples(s).\n", channel, num_samples);
+    printf("Testing sensor %d for %d samples(s).\n", channel, num_samples);
 
     /* Open I2C bus */
-    int fd = i2c_open_bus(I2C_DEV_PATH);
+    int fd = i2c_open_bus(bus_path);
     if (fd < 0) {
-        fprintf(stderr, "ERROR: Unable to open I2C bus %s\n", I2C_DEV_PATH);
+        fprintf(stderr, "ERROR: Unable to open I2C bus %s\n", bus_path);
         return EXIT_FAILURE;
     }
 
-    printf("I2C bus opened on %s (fd = %d)\n", I2C_DEV_PATH, fd);
+    printf("I2C bus opened on %s (fd = %d)\n", bus_path, fd);
 
-    int ret = tca_disable_all(fd, TCA9548A_ADDR);
-    if (ret != TCA_OK) {
-        fprintf(stderr, "WARNING: tca_disable_all failed (ret=%d)\n", ret);
+    topo_t topo;
+    uint8_t mux_addr;
+    int mux_channel;
+    if (topo_from_spec(&topo, fd, mux_spec) != TOPO_OK ||
+        topo_sensor_location(&topo, channel, &mux_addr, &mux_channel) != TOPO_OK) {
+        fprintf(stderr, "ERROR: Sensor %d is not part of the mux topology\n", channel);
+        i2c_close_bus(fd);
+        return EXIT_FAILURE;
+    }
+
+    /* Only the requested sensor may be routed: disable every mux first */
+    for (int m = 0; m < topo.num_muxes; m++) {
+        int ret = tca_disable_all(fd, topo.mux_addr[m]);
+        if (ret != TCA_OK) {
+            fprintf(stderr, "WARNING: tca_disable_all 0x%02x failed (ret=%d)\n", topo.mux_addr[m], ret);
+        }
     }
 
     /* Select requested channel */
-    if (tca_select_channel(fd, TCA9548A_ADDR, channel) != TCA_OK) {
-        fprintf(stderr, "ERROR: Unable to select TCA9548A channel %d\n", channel);
+    if (tca_select_channel(fd, mux_addr, mux_channel) != TCA_OK) {
+        fprintf(stderr, "ERROR: Unable to select TCA9548A 0x%02x channel %d\n", mux_addr, mux_channel);
         i2c_close_bus(fd);
         return EXIT_FAILURE;
     }
 
-    printf("TCA9548A channel %d selected.\n", channel);
+    printf("TCA9548A 0x%02x channel %d selected.\n", mux_addr, mux_channel);
     usleep(1000); // 1 ms
 
     /* Configure VEML3328 sensor */
@@ -72,6 +89,7 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
     
+    uint64_t cfg_ns = sample_timer_now_ns();
     veml3328_apply_cfg(fd, VEML3328_ADDR, &test_cfg);
 
     veml3328_cfg_t real_cfg = {0};
@@ -85,9 +103,25 @@ int main(int argc, char *argv[]) {
         fprintf(stderr, "WARNING: veml3328_read_cfg failed\n");
     }
 
-    usleep( (useconds_t)(test_cfg.it_ms * 1000.0f) ); // wait for integration
+    /* Samples on the sensor's integration cycle: one read per completed cycle */
+    veml3328_cfg_t applied = test_cfg;
+    veml3328_decode_cfg(veml3328_encode_cfg(&test_cfg), test_cfg.ds_it_ms, test_cfg.dark_offset, &applied);
+    uint64_t period_ns = (uint64_t)(applied.it_ms * 1000000.0f);
+
+    sample_timer_t timer;
+    sample_timer_init(&timer, period_ns, cfg_ns + period_ns + READ_MARGIN_NS);
     
     for (int sample = 0; sample < num_samples; sample++) {
+        uint64_t tick_ns;
+        int missed = sample_timer_wait(&timer, &tick_ns);
+        if (missed < 0) {
+            fprintf(stderr, "ERROR: Sampling timer failed\n");
+            break;
+        }
+        if (missed > 0) {
+            fprintf(stderr, "WARNING: %d integration cycle(s) missed\n", missed);
+        }
+
         /* Read raw data from VEML3328 */
         veml3328_raw_data_t raw_data;
         if (veml3328_read_all(fd, VEML3328_ADDR, &raw_data) != VEML3328_OK) {
@@ -111,11 +145,15 @@ int main(int argc, char *argv[]) {
         printf("Normalized RGB Values of sample %d:\n", sample + 1);
         printf("Red: %d  ,  Green: %d  ,  Blue:  %d\n", R255, G255, B255);
         printf("Intensity: %.3f uW/cm^2  ,  Wavelength: %.1f\n", norm_rgb.irradiance_uW_per_cm2, norm_rgb.wavelength);
-
-        usleep( (useconds_t)(test_cfg.it_ms * 1000.0f) ); 
+        printf("Tick: %llu ns (+%.1f us)\n", (unsigned long long)tick_ns, timer.last_late_ns / 1000.0);
     }
 
-    tca_disable_all(fd, TCA9548A_ADDR);
+    printf("Timing: %llu samples, %llu missed cycles, jitter %.1f us (max late %.1f us)\n",
+           (unsigned long long)timer.stats.ticks, (unsigned long long)timer.stats.missed,
+           sample_timer_jitter_ns(&timer.stats) / 1000.0, timer.stats.max_late_ns / 1000.0);
+    sample_timer_close(&timer);
+
+    tca_disable_all(fd, mux_addr);
 
     /* Close I2C bus */
     i2c_close_bus(fd);
@@ -0,0 +1,177 @@
+#include "topology.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+int topo_init(topo_t *topo, const uint8_t *mux_addrs, int num_muxes) {
+    if (topo == NULL || mux_addrs == NULL || num_muxes < 1 || num_muxes > TOPO_MAX_MUXES) {
+        return TOPO_ERR_INVALID;
+    }
+
+    /* Insert in ascending order so sensor indices do not depend on the input order */
+    topo_t sorted = {0};
+    for (int i = 0; i < num_muxes; i++) {
+        uint8_t addr = mux_addrs[i];
+        if (addr < TCA_ADDRESS_BASE || addr > TCA_ADDRESS_LAST) {
+            return TOPO_ERR_INVALID;
+        }
+
+        int pos = sorted.num_muxes;
+        while (pos > 0 && sorted.mux_addr[pos - 1] > addr) {
+            sorted.mux_addr[pos] = sorted.mux_addr[pos - 1];
+            pos--;
+        }
+        if (pos > 0 && sorted.mux_addr[pos - 1] == addr) {
+            return TOPO_ERR_INVALID;
+        }
+        sorted.mux_addr[pos] = addr;
+        sorted.num_muxes++;
+    }
+
+    *topo = sorted;
+    return TOPO_OK;
+}
+
+int topo_discover(topo_t *topo, int i2c_fd) {
+    if (topo == NULL) {
+        return TOPO_ERR_INVALID;
+    }
+
+    uint8_t found[TOPO_MAX_MUXES];
+    int n = 0;
+    for (uint8_t addr = TCA_ADDRESS_BASE; addr <= TCA_ADDRESS_LAST; addr++) {
+        uint8_t control;
+        if (tca_read_control(i2c_fd, addr, &control) == TCA_OK) {
+            found[n++] = addr;
+        }
+    }
+
+    if (n == 0) {
+        return TOPO_ERR_NOT_FOUND;
+    }
+
+    return topo_init(topo, found, n);
+}
+
+int topo_from_spec(topo_t *topo, int i2c_fd, const char *spec) {
+    if (topo == NULL) {
+        return TOPO_ERR_INVALID;
+    }
+
+    if (spec == NULL || spec[0] == '\0') {
+        uint8_t addr = TCA_ADDRESS_BASE;
+        return topo_init(topo, &addr, 1);
+    }
+
+    if (strcmp(spec, "auto") == 0) {
+        return topo_discover(topo, i2c_fd);
+    }
+
+    uint8_t addrs[TOPO_MAX_MUXES];
+    int n = 0;
+    const char *p = spec;
+    while (*p != '\0') {
+        char *end;
+        unsigned long addr = strtoul(p, &end, 0);
+        if (end == p || n == TOPO_MAX_MUXES || addr > 0xFF) {
+            return TOPO_ERR_INVALID;
+        }
+        addrs[n++] = (uint8_t)addr;
+
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return TOPO_ERR_INVALID;
+        }
+        p = end;
+    }
+
+    return topo_init(topo, addrs, n);
+}
+
+int topo_num_sensors(const topo_t *topo) {
+    if (topo == NULL) {
+        return 0;
+    }
+
+    return topo->num_muxes * TOPO_CHANNELS_PER_MUX;
+}
+
+uint64_t topo_all_sensors(const topo_t *topo) {
+    int n = topo_num_sensors(topo);
+    if (n >= 64) {
+        return ~0ull;
+    }
+
+    return (1ull << n) - 1;
+}
+
+int topo_sensor_index(const topo_t *topo, uint8_t mux_addr, int channel) {
+    if (topo == NULL || channel < 0 || channel >= TOPO_CHANNELS_PER_MUX) {
+        return TOPO_ERR_NOT_FOUND;
+    }
+
+    for (int m = 0; m < topo->num_muxes; m++) {
+        if (topo->mux_addr[m] == mux_addr) {
+            return m * TOPO_CHANNELS_PER_MUX + channel;
+        }
+    }
+
+    return TOPO_ERR_NOT_FOUND;
+}
+
+int topo_sensor_location(const topo_t *topo, int index, uint8_t *mux_addr, int *channel) {
+    if (topo == NULL || index < 0 || index >= topo_num_sensors(topo)) {
+        return TOPO_ERR_NOT_FOUND;
+    }
+
+    if (mux_addr != NULL) {
+        *mux_addr = topo->mux_addr[index / TOPO_CHANNELS_PER_MUX];
+    }
+    if (channel != NULL) {
+        *channel = index % TOPO_CHANNELS_PER_MUX;
+    }
+    return TOPO_OK;
+}
+
+/* Append the selected channels of one mux, 'first' (if selected) leading */
+static int schedule_mux(uint64_t mask, int mux, int first, uint8_t *order, int n) {
+    if (first >= 0 && (mask & (1ull << first))) {
+        order[n++] = (uint8_t)first;
+    }
+
+    for (int ch = 0; ch < TOPO_CHANNELS_PER_MUX; ch++) {
+        int index = mux * TOPO_CHANNELS_PER_MUX + ch;
+        if (index != first && (mask & (1ull << index))) {
+            order[n++] = (uint8_t)index;
+        }
+    }
+
+    return n;
+}
+
+int topo_schedule(const topo_t *topo, uint64_t mask, int current, uint8_t order[TOPO_MAX_SENSORS]) {
+    if (topo == NULL || order == NULL) {
+        return 0;
+    }
+
+    mask &= topo_all_sensors(topo);
+    if (current >= topo_num_sensors(topo)) {
+        current = -1;
+    }
+
+    int n = 0;
+    int current_mux = (current >= 0) ? current / TOPO_CHANNELS_PER_MUX : -1;
+    if (current_mux >= 0) {
+        n = schedule_mux(mask, current_mux, current, order, n);
+    }
+
+    for (int m = 0; m < topo->num_muxes; m++) {
+        if (m != current_mux) {
+            n = schedule_mux(mask, m, -1, order, n);
+        }
+    }
+
+    return n;
+}
@@ -0,0 +1,66 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdint.h>
+#include "tca9548a.h"
+
+/*
+ * Bus topology: up to eight TCA9548A muxes (A2..A0 give 0x70..0x77), each
+ * with eight downstream channels, so up to 64 sensors per bus. Every sensor
+ * has the same address, hence at most one downstream channel across all muxes
+ * may be routed while reading.
+ *
+ * Sensors are numbered by position: index = mux position * 8 + channel, with
+ * the muxes sorted by address. 64-bit masks select sensors by index.
+ */
+
+#define TOPO_MAX_MUXES          8
+#define TOPO_CHANNELS_PER_MUX   8
+#define TOPO_MAX_SENSORS        (TOPO_MAX_MUXES * TOPO_CHANNELS_PER_MUX)
+#define TCA_ADDRESS_LAST        0x77
+
+/* Error codes */
+#define TOPO_OK                 0
+#define TOPO_ERR_INVALID       -1
+#define TOPO_ERR_NOT_FOUND     -2
+
+typedef struct {
+    int num_muxes;
+    uint8_t mux_addr[TOPO_MAX_MUXES];       // ascending
+} topo_t;
+
+/* Topology of the given mux addresses (0x70..0x77, duplicates rejected) */
+int topo_init(topo_t *topo, const uint8_t *mux_addrs, int num_muxes);
+
+/* Probe 0x70..0x77 on an open bus and keep every mux that answers */
+int topo_discover(topo_t *topo, int i2c_fd);
+
+/*
+ * Build a topology from a textual spec:
+ *   NULL or ""          single mux at TCA_ADDRESS_BASE
+ *   "auto"              topo_discover()
+ *   "0x70,0x71,0x74"    explicit list
+ */
+int topo_from_spec(topo_t *topo, int i2c_fd, const char *spec);
+
+/* Number of addressable sensors and the mask covering all of them */
+int topo_num_sensors(const topo_t *topo);
+uint64_t topo_all_sensors(const topo_t *topo);
+
+/* Sensor index of (mux address, channel), or TOPO_ERR_NOT_FOUND */
+int topo_sensor_index(const topo_t *topo, uint8_t mux_addr, int channel);
+
+/* Mux address and channel of a sensor index */
+int topo_sensor_location(const topo_t *topo, int index, uint8_t *mux_addr, int *channel);
+
+/*
+ * Order in which to read the sensors in 'mask' with the fewest mux writes.
+ * Staying on one mux costs one write per channel; moving to another mux
+ * also costs the write that disables the previous one. The sensor routed
+ * right now ('current', -1 if none) is read first for free, then the rest of
+ * its mux, then the other muxes one after the other. Returns the number of
+ * entries written to 'order'.
+ */
+int topo_schedule(const topo_t *topo, uint64_t mask, int current, uint8_t order[TOPO_MAX_SENSORS]);
+
+#endif // TOPOLOGY_H
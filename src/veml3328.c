@@ -12,6 +12,7 @@
 extern int i2c_write_bytes(int fd, uint8_t dev_addr, const uint8_t *buf, int length);
 //extern int i2c_read_bytes(int fd, uint8_t dev_addr, uint8_t *buf, int length);
 extern int i2c_write_read(int fd, uint8_t dev_addr, const uint8_t *write_buf, int write_length, uint8_t *read_buf, int read_length);
+extern int i2c_read_regs(int fd, uint8_t dev_addr, const uint8_t *regs, int num_regs, uint8_t *read_buf, int reg_length);
 
 static uint16_t encode_it_bits(float it_ms) {
     // Datasheet: 00=50ms, 01=100ms, 10=200ms, 11=400ms
@@ -106,19 +107,51 @@ int veml3328_config(int i2c_fd, uint8_t dev_addr) {
     return veml3328_write_reg(i2c_fd, dev_addr, VEML3328_REG_CONF, conf_value);
 }
 
-int veml3328_apply_cfg(int i2c_fd, uint8_t dev_addr, const veml3328_cfg_t *cfg) {
+uint16_t veml3328_encode_cfg(const veml3328_cfg_t *cfg) {
+    uint16_t conf_value = 0x0000;   // Start with default config
     if (cfg == NULL){
-        return VEML3328_ERR_NULL;
+        return conf_value;
     }
 
-    uint16_t conf_value = 0x0000;   // Start with default config
-
     conf_value |= (encode_dg_bits(cfg->dg_factor)       << VEML3328_CONF_DG);
     conf_value |= (encode_gain_bits(cfg->gain_factor)   << VEML3328_CONF_GAIN);
     conf_value |= (encode_sens_bits(cfg->sens_factor)   << VEML3328_CONF_SENS);
     conf_value |= (encode_it_bits(cfg->it_ms)           << VEML3328_CONF_IT);
 
-    return veml3328_write_reg(i2c_fd, dev_addr, VEML3328_REG_CONF, conf_value);
+    return conf_value;
+}
+
+int veml3328_decode_cfg(uint16_t conf, float ds_it_ms, uint16_t dark_offset, veml3328_cfg_t *cfg_out) {
+    if (cfg_out == NULL){
+        return VEML3328_ERR_NULL;
+    }
+
+    cfg_out->it_ms       = decode_it_ms(conf);
+    cfg_out->gain_factor = decode_gain(conf);
+    cfg_out->dg_factor   = decode_dg(conf);
+    cfg_out->sens_factor = (float)((conf >> VEML3328_CONF_SENS) & 0x1);
+    cfg_out->ds_it_ms    = ds_it_ms;
+    cfg_out->dark_offset = dark_offset;
+
+    return VEML3328_OK;
+}
+
+float veml3328_cfg_exposure(const veml3328_cfg_t *cfg) {
+    if (cfg == NULL){
+        return 0.0f;
+    }
+
+    /* Round-trip through CONF so the result matches the supported settings */
+    uint16_t conf = veml3328_encode_cfg(cfg);
+    return decode_it_ms(conf) * decode_gain(conf) * decode_dg(conf) * decode_sens(conf);
+}
+
+int veml3328_apply_cfg(int i2c_fd, uint8_t dev_addr, const veml3328_cfg_t *cfg) {
+    if (cfg == NULL){
+        return VEML3328_ERR_NULL;
+    }
+
+    return veml3328_write_reg(i2c_fd, dev_addr, VEML3328_REG_CONF, veml3328_encode_cfg(cfg));
 }
 
 int veml3328_read_cfg (int i2c_fd, uint8_t dev_addr, veml3328_cfg_t *cfg_out) {
@@ -179,14 +212,20 @@ int veml3328_read_all(int i2c_fd, uint8_t dev_addr, veml3328_raw_data_t *out) {
         return VEML3328_ERR_NULL;
     }
 
-    if (veml3328_read_reg(i2c_fd, dev_addr, VEML3328_REG_clear, &out->clear) != VEML3328_OK ||
-        veml3328_read_reg(i2c_fd, dev_addr, VEML3328_REG_RED, &out->red) != VEML3328_OK || 
-        veml3328_read_reg(i2c_fd, dev_addr, VEML3328_REG_GREEN, &out->green) != VEML3328_OK || 
-        veml3328_read_reg(i2c_fd, dev_addr, VEML3328_REG_BLUE, &out->blue) != VEML3328_OK){
-        
+    /* All four channels in one bus transaction */
+    static const uint8_t regs[4] = {
+        VEML3328_REG_clear, VEML3328_REG_RED, VEML3328_REG_GREEN, VEML3328_REG_BLUE
+    };
+    uint8_t buf[8];
+
+    if (i2c_read_regs(i2c_fd, dev_addr, regs, 4, buf, 2) != 0){
         return VEML3328_ERR_I2C;
     }
 
+    out->clear = (uint16_t)buf[0] | ((uint16_t)buf[1] << 8); // LSB | MSB
+    out->red   = (uint16_t)buf[2] | ((uint16_t)buf[3] << 8);
+    out->green = (uint16_t)buf[4] | ((uint16_t)buf[5] << 8);
+    out->blue  = (uint16_t)buf[6] | ((uint16_t)buf[7] << 8);
     return VEML3328_OK;
 }
 
@@ -17,6 +17,7 @@
 #define VEML3328_REG_RED    0x05
 #define VEML3328_REG_GREEN  0x06
 #define VEML3328_REG_BLUE   0x07
+#define VEML3328_REG_ID     0x0C
 
 /* Clear channel base responsivity */
 #define VEML3328_CLEAR_RESP_BASE 57.0f // from datasheet
@@ -56,8 +57,20 @@ typedef struct {
 /* Sensor initial configuration */
 int veml3328_config(int i2c_fd, uint8_t dev_addr);
 
+/* Encode a configuration into the CONF register value */
+uint16_t veml3328_encode_cfg(const veml3328_cfg_t *cfg);
+
+/* Decode a CONF register value (inverse of veml3328_encode_cfg: sens_factor
+   is the low-sensitivity flag). ds_it_ms and dark_offset are not part of
+   CONF and are taken from the arguments. */
+int veml3328_decode_cfg(uint16_t conf, float ds_it_ms, uint16_t dark_offset, veml3328_cfg_t *cfg_out);
+
 int veml3328_apply_cfg(int i2c_fd, uint8_t dev_addr, const veml3328_cfg_t *cfg);
 
+/* Relative responsivity of a configuration as the sensor will apply it
+   (IT ms x gain x DG x sensitivity): counts scale linearly with it */
+float veml3328_cfg_exposure(const veml3328_cfg_t *cfg);
+
 int veml3328_read_cfg (int i2c_fd, uint8_t dev_addr, veml3328_cfg_t *cfg_out);
 
 /* write 16-bit address */
@@ -0,0 +1,125 @@
+#include "wire_frame.h"
+
+#include <string.h>
+
+static void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put_u64(uint8_t *p, uint64_t v) {
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p) {
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static uint64_t get_u64(const uint8_t *p) {
+    return get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+size_t wire_frame_size(uint64_t mask) {
+    return WIRE_FRAME_HEADER_SIZE + (size_t)__builtin_popcountll(mask) * WIRE_FRAME_RECORD_SIZE;
+}
+
+int wire_frame_encode(const acq_frame_t *frame, uint64_t mask, uint8_t *buf, size_t len) {
+    if (frame == NULL || buf == NULL) {
+        return WIRE_FRAME_ERR;
+    }
+
+    uint64_t carried = mask & frame->channel_mask;
+    size_t size = wire_frame_size(carried);
+    if (len < size) {
+        return WIRE_FRAME_ERR;
+    }
+
+    put_u32(buf, WIRE_FRAME_MAGIC);
+    buf[4] = WIRE_FRAME_VERSION;
+    buf[5] = frame->sensitivity;
+    put_u16(buf + 6, WIRE_FRAME_HEADER_SIZE);
+    put_u64(buf + 8, frame->seq);
+    put_u64(buf + 16, frame->timestamp_ns);
+    put_u64(buf + 24, frame->wall_ns);
+    put_u64(buf + 32, carried);
+    put_u64(buf + 40, frame->valid_mask & carried);
+    put_u32(buf + 48, frame->spread_ns);
+    put_u16(buf + 52, WIRE_FRAME_RECORD_SIZE);
+    put_u16(buf + 54, 0);
+
+    uint8_t *p = buf + WIRE_FRAME_HEADER_SIZE;
+    for (int i = 0; i < ACQ_MAX_CHANNELS; i++) {
+        uint64_t bit = 1ull << i;
+        if (!(carried & bit)) {
+            continue;
+        }
+
+        const veml3328_raw_data_t *raw = &frame->raw[i];
+        int valid = (frame->valid_mask & bit) != 0;
+        put_u16(p, valid ? frame->conf[i] : 0);
+        put_u16(p + 2, valid ? raw->clear : 0);
+        put_u16(p + 4, valid ? raw->red : 0);
+        put_u16(p + 6, valid ? raw->green : 0);
+        put_u16(p + 8, valid ? raw->blue : 0);
+        p += WIRE_FRAME_RECORD_SIZE;
+    }
+
+    return (int)size;
+}
+
+int wire_frame_decode(const uint8_t *buf, size_t len, acq_frame_t *out) {
+    if (buf == NULL || out == NULL || len < WIRE_FRAME_HEADER_SIZE) {
+        return WIRE_FRAME_ERR;
+    }
+    if (get_u32(buf) != WIRE_FRAME_MAGIC || buf[4] != WIRE_FRAME_VERSION) {
+        return WIRE_FRAME_ERR_FORMAT;
+    }
+
+    /* Sizes are read from the frame, so later versions may grow them */
+    size_t header_size = get_u16(buf + 6);
+    size_t record_size = get_u16(buf + 52);
+    if (header_size < WIRE_FRAME_HEADER_SIZE || record_size < WIRE_FRAME_RECORD_SIZE) {
+        return WIRE_FRAME_ERR_FORMAT;
+    }
+
+    uint64_t carried = get_u64(buf + 32);
+    size_t size = header_size + (size_t)__builtin_popcountll(carried) * record_size;
+    if (len < size) {
+        return WIRE_FRAME_ERR;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->sensitivity = buf[5];
+    out->seq = get_u64(buf + 8);
+    out->timestamp_ns = get_u64(buf + 16);
+    out->wall_ns = get_u64(buf + 24);
+    out->channel_mask = carried;
+    out->valid_mask = get_u64(buf + 40);
+    out->spread_ns = get_u32(buf + 48);
+
+    const uint8_t *p = buf + header_size;
+    for (int i = 0; i < ACQ_MAX_CHANNELS; i++) {
+        if (!(carried & (1ull << i))) {
+            continue;
+        }
+
+        out->conf[i] = get_u16(p);
+        out->raw[i].clear = get_u16(p + 2);
+        out->raw[i].red = get_u16(p + 4);
+        out->raw[i].green = get_u16(p + 6);
+        out->raw[i].blue = get_u16(p + 8);
+        p += record_size;
+    }
+
+    return (int)size;
+}
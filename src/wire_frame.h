@@ -0,0 +1,57 @@
+#ifndef WIRE_FRAME_H
+#define WIRE_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "acq_frame.h"
+
+/*
+ * Compact binary encoding of a frame for the network and for logs, all
+ * fields little-endian:
+ *
+ *   offset  size
+ *        0     4  magic "VMLF"
+ *        4     1  version
+ *        5     1  sensitivity (1 = low sensitivity, 1/3)
+ *        6     2  header size (WIRE_FRAME_HEADER_SIZE)
+ *        8     8  seq
+ *       16     8  timestamp_ns (CLOCK_MONOTONIC, first sensor read)
+ *       24     8  wall_ns (CLOCK_REALTIME)
+ *       32     8  channel_mask: sensors carried, one record each in index order
+ *       40     8  valid_mask: sensors read successfully (others are zeroed)
+ *       48     4  spread_ns: first to last sensor read
+ *       52     2  record size (WIRE_FRAME_RECORD_SIZE)
+ *       54     2  reserved
+ *
+ * followed by one record per sensor of channel_mask: CONF, then the raw C,
+ * R, G, B counts, as uint16. A frame is therefore self-delimiting and frames
+ * can be concatenated into a stream.
+ */
+
+#define WIRE_FRAME_MAGIC        0x464C4D56u     // "VMLF"
+#define WIRE_FRAME_VERSION      1
+#define WIRE_FRAME_HEADER_SIZE  56
+#define WIRE_FRAME_RECORD_SIZE  10
+#define WIRE_FRAME_MAX_SIZE     (WIRE_FRAME_HEADER_SIZE + ACQ_MAX_CHANNELS * WIRE_FRAME_RECORD_SIZE)
+
+/* Error codes */
+#define WIRE_FRAME_ERR          -1              // bad argument or buffer too small
+#define WIRE_FRAME_ERR_FORMAT   -2              // not a frame, or an unknown version
+
+/* Encoded size of a frame carrying the sensors of 'mask' */
+size_t wire_frame_size(uint64_t mask);
+
+/*
+ * Encode the sensors of 'mask' sampled in 'frame' (mask & frame->channel_mask)
+ * into 'buf'. Returns the number of bytes written or WIRE_FRAME_ERR.
+ */
+int wire_frame_encode(const acq_frame_t *frame, uint64_t mask, uint8_t *buf, size_t len);
+
+/*
+ * Decode one frame from 'buf' into 'out' (entries of the sensors not carried
+ * are zeroed). Returns the number of bytes consumed, WIRE_FRAME_ERR if 'buf'
+ * holds less than a whole frame, or WIRE_FRAME_ERR_FORMAT.
+ */
+int wire_frame_decode(const uint8_t *buf, size_t len, acq_frame_t *out);
+
+#endif // WIRE_FRAME_H
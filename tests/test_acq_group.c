@@ -0,0 +1,140 @@
+#include "unity.h"
+#include "../src/acq_group.h"
+#include "../src/i2c_sim.h"
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+/* Parallel sweeps over several simulated buses */
+#define TEST_IT_MS  50.0f
+
+static const veml3328_cfg_t test_cfg = {
+    .gain_factor = 1.0f,
+    .dg_factor   = 1.0f,
+    .sens_factor = 0.0f,
+    .it_ms       = TEST_IT_MS,
+    .ds_it_ms    = 100.0f,
+    .dark_offset = 0
+};
+
+static acq_group_t group;
+static veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+static acq_frame_t frame;
+
+void setUp(void) {
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        cfg[i] = test_cfg;
+    }
+    memset(&frame, 0, sizeof(frame));
+}
+
+void tearDown(void) {
+    acq_group_close(&group);
+}
+
+/* Tests */
+void test_group_merges_buses(void) {
+    const char *buses[] = { "sim:", "sim:muxes=2" };
+    const char *muxes[] = { "auto" };
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_OK, acq_group_open(&group, buses, 2, muxes, 1));
+    TEST_ASSERT_EQUAL_INT(24, group.num_sensors);
+    TEST_ASSERT_EQUAL_INT(8, group.bus[1].first_sensor);
+
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_OK, acq_group_sweep(&group, 0xFFFFFF, cfg, &frame, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFFFF, frame.valid_mask);
+    TEST_ASSERT_EQUAL_UINT8(2, frame.num_buses);
+    TEST_ASSERT_EQUAL_UINT8(16, frame.bus_sensors[1]);
+
+    /* Sensor 16 is the second mux of the second bus (10% more light) */
+    TEST_ASSERT_EQUAL_UINT16(100, frame.raw[8].clear);
+    TEST_ASSERT_EQUAL_UINT16(110, frame.raw[16].clear);
+}
+
+/* Rendezvous of the bus threads: the first transfer on each bus waits until
+   every bus has started one, which only happens if they run concurrently */
+#define RENDEZVOUS_TIMEOUT_S    5
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t arrived;
+    int fds[ACQ_MAX_BUSES];
+    int num_buses;
+    unsigned int started;                 // bit b: bus b entered a transfer
+    int timed_out;
+} meet = { .lock = PTHREAD_MUTEX_INITIALIZER, .arrived = PTHREAD_COND_INITIALIZER };
+
+static void rendezvous_hook(int fd, void *user) {
+    (void)user;
+    unsigned int all = (1u << meet.num_buses) - 1;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += RENDEZVOUS_TIMEOUT_S;
+
+    pthread_mutex_lock(&meet.lock);
+    for (int b = 0; b < meet.num_buses; b++) {
+        if (meet.fds[b] == fd) {
+            meet.started |= 1u << b;
+        }
+    }
+    pthread_cond_broadcast(&meet.arrived);
+    while (meet.started != all && !meet.timed_out) {
+        if (pthread_cond_timedwait(&meet.arrived, &meet.lock, &deadline) == ETIMEDOUT) {
+            meet.timed_out = 1;
+        }
+    }
+    pthread_mutex_unlock(&meet.lock);
+}
+
+void test_group_buses_run_in_parallel(void) {
+    const char *buses[] = { "sim:", "sim:" };
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_OK, acq_group_open(&group, buses, 2, NULL, 0));
+
+    meet.num_buses = 2;
+    meet.started = 0;
+    meet.timed_out = 0;
+    for (int b = 0; b < 2; b++) {
+        meet.fds[b] = group.bus[b].fd;
+        TEST_ASSERT_EQUAL_INT(0, i2c_sim_set_hook(group.bus[b].fd, rendezvous_hook, NULL));
+    }
+
+    /* A serial sweep would hold the first bus until the timeout */
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_OK, acq_group_sweep(&group, 0xFFFF, cfg, &frame, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFF, frame.valid_mask);
+    TEST_ASSERT_EQUAL_HEX(0x3, meet.started);
+    TEST_ASSERT_FALSE(meet.timed_out);
+}
+
+void test_group_failed_bus(void) {
+    const char *buses[] = { "sim:", "sim:nack=1" };
+    const char *muxes[] = { "0x70", "0x70" };
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_OK, acq_group_open(&group, buses, 2, muxes, 2));
+
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_OK, acq_group_sweep(&group, 0xFFFF, cfg, &frame, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFF, frame.channel_mask);
+    TEST_ASSERT_EQUAL_HEX64(0x00FF, frame.valid_mask);
+}
+
+void test_group_open_errors(void) {
+    const char *too_many[] = { "sim:muxes=8", "sim:" };
+    const char *all[] = { "auto" };
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_ERR_INVALID, acq_group_open(&group, too_many, 2, all, 1));
+
+    const char *missing[] = { "sim:", "/dev/i2c-does-not-exist" };
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_ERR_BUS, acq_group_open(&group, missing, 2, NULL, 0));
+
+    const char *specs[] = { "0x70", "0x70", "0x70" };
+    TEST_ASSERT_EQUAL_INT(ACQ_GROUP_ERR_INVALID, acq_group_open(&group, missing, 2, specs, 3));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_group_merges_buses);
+    RUN_TEST(test_group_buses_run_in_parallel);
+    RUN_TEST(test_group_failed_bus);
+    RUN_TEST(test_group_open_errors);
+
+    return UNITY_END();
+}
@@ -0,0 +1,151 @@
+#include "unity.h"
+#include "../src/autoexp.h"
+#include "../src/i2c_driver_pi.h"
+#include "../src/i2c_sim.h"
+#include "../src/sweep.h"
+#include <stdint.h>
+
+/* Auto-exposure decisions, and convergence against the simulated bus */
+static const veml3328_cfg_t base_cfg = {
+    .gain_factor = 1.0f,
+    .dg_factor   = 1.0f,
+    .sens_factor = 0.0f,
+    .it_ms       = 400.0f,
+    .ds_it_ms    = 100.0f,
+    .dark_offset = 0
+};
+
+static autoexp_t ae;
+
+static veml3328_raw_data_t flat_raw(uint16_t counts) {
+    veml3328_raw_data_t raw = { counts, counts / 2, counts / 2, counts / 4 };
+    return raw;
+}
+
+void setUp(void) {
+    autoexp_init(&ae, 0, 0);
+}
+
+void tearDown(void) {}
+
+/* Tests */
+void test_initial_step_is_short(void) {
+    veml3328_cfg_t cfg;
+    autoexp_cfg(&ae, 5, &base_cfg, &cfg);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, cfg.it_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, cfg.gain_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f, cfg.dg_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 100.0f, cfg.ds_it_ms);    // kept from the base
+}
+
+void test_saturation_steps_down(void) {
+    veml3328_cfg_t used;
+    autoexp_cfg(&ae, 0, &base_cfg, &used);
+    veml3328_raw_data_t raw = flat_raw(AUTOEXP_SATURATION);
+    TEST_ASSERT_EQUAL_INT(0, autoexp_update(&ae, 0, &used, &raw));
+    TEST_ASSERT_EQUAL_UINT8(1, ae.sensor[0].saturated);
+
+    veml3328_cfg_t next;
+    autoexp_cfg(&ae, 0, &base_cfg, &next);
+    TEST_ASSERT_TRUE(veml3328_cfg_exposure(&next) * 4.0f <= veml3328_cfg_exposure(&used));
+}
+
+void test_dim_source_gets_longest_exposure(void) {
+    veml3328_cfg_t used;
+    autoexp_cfg(&ae, 0, &base_cfg, &used);
+    veml3328_raw_data_t raw = flat_raw(10);
+    TEST_ASSERT_EQUAL_INT(0, autoexp_update(&ae, 0, &used, &raw));
+
+    veml3328_cfg_t next;
+    autoexp_cfg(&ae, 0, &base_cfg, &next);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 400.0f, next.it_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, next.gain_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 4.0f, next.dg_factor);
+}
+
+void test_prefers_shorter_integration(void) {
+    /* 30000 counts at 400 ms, 4x: 50 ms with 4x analog x 4x digital gives 15000 */
+    veml3328_cfg_t used = base_cfg;
+    used.gain_factor = 4.0f;
+    veml3328_raw_data_t raw = flat_raw(30000);
+    TEST_ASSERT_EQUAL_INT(1, autoexp_update(&ae, 0, &used, &raw));
+
+    veml3328_cfg_t next;
+    autoexp_cfg(&ae, 0, &base_cfg, &next);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, next.it_ms);
+}
+
+void test_in_window_is_kept_and_remembered(void) {
+    veml3328_cfg_t used;
+    autoexp_cfg(&ae, 3, &base_cfg, &used);
+    veml3328_raw_data_t raw = flat_raw(20000);
+    TEST_ASSERT_EQUAL_INT(1, autoexp_update(&ae, 3, &used, &raw));
+    uint8_t good = ae.sensor[3].step;
+    TEST_ASSERT_EQUAL_UINT8(good, ae.sensor[3].good_step);
+
+    /* A dark sample moves the sensor away; a failed read brings it back */
+    raw = flat_raw(0);
+    autoexp_update(&ae, 3, &used, &raw);
+    TEST_ASSERT_NOT_EQUAL(good, ae.sensor[3].step);
+    autoexp_lost(&ae, 3);
+    TEST_ASSERT_EQUAL_UINT8(good, ae.sensor[3].step);
+}
+
+void test_invalid_arguments(void) {
+    veml3328_raw_data_t raw = flat_raw(100);
+    TEST_ASSERT_EQUAL_INT(-1, autoexp_update(&ae, AUTOEXP_MAX_SENSORS, &base_cfg, &raw));
+    TEST_ASSERT_EQUAL_INT(-1, autoexp_update(&ae, 0, NULL, &raw));
+    TEST_ASSERT_EQUAL_INT(24, autoexp_num_steps());
+}
+
+void test_converges_on_simulated_bus(void) {
+    int fd = i2c_open_bus("sim:");
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    /* Channel 0 under a lamp, channel 1 almost dark */
+    const i2c_sim_light_t bright = { 1000.0f, 500.0f, 400.0f, 200.0f };
+    const i2c_sim_light_t dim = { 1.0f, 0.5f, 0.5f, 0.25f };
+    i2c_sim_set_light(fd, 0, 0, &bright);
+    i2c_sim_set_light(fd, 0, 1, &dim);
+
+    sweep_ctx_t ctx;
+    sweep_init(&ctx, fd, I2C_SIM_MUX_BASE, VEML3328_I2C_ADDR);
+
+    veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    int in_window[2] = {0};
+    for (int round = 0; round < 6; round++) {
+        for (int i = 0; i < 2; i++) {
+            autoexp_cfg(&ae, i, &base_cfg, &cfg[i]);
+        }
+
+        uint64_t done = 0;
+        sweep_run_sensors(&ctx, 0x3, cfg, raw, NULL, &done);
+        TEST_ASSERT_EQUAL_HEX64(0x3, done);
+        for (int i = 0; i < 2; i++) {
+            in_window[i] = autoexp_update(&ae, i, &cfg[i], &raw[i]);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_INT(1, in_window[0]);
+    TEST_ASSERT_EQUAL_INT(1, in_window[1]);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 50.0f, cfg[0].it_ms);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 400.0f, cfg[1].it_ms);
+
+    sweep_disable_all(&ctx);
+    i2c_close_bus(fd);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_initial_step_is_short);
+    RUN_TEST(test_saturation_steps_down);
+    RUN_TEST(test_dim_source_gets_longest_exposure);
+    RUN_TEST(test_prefers_shorter_integration);
+    RUN_TEST(test_in_window_is_kept_and_remembered);
+    RUN_TEST(test_invalid_arguments);
+    RUN_TEST(test_converges_on_simulated_bus);
+
+    return UNITY_END();
+}
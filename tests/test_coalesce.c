@@ -0,0 +1,151 @@
+#include "unity.h"
+#include "../src/coalesce.h"
+#include <stdint.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Request coalescing: concurrent callers share sweeps */
+#define CALLERS     8
+
+typedef struct {
+    int sensitivity;
+    uint64_t mask;
+} result_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int sweeps;
+    uint64_t masks[CALLERS * 2];
+    int sensitivities[CALLERS * 2];
+    uint64_t fail_mask;
+} fake_bus_t;
+
+static coalescer_t coalescer;
+static fake_bus_t bus;
+
+/* Slow sweep recording what it was asked for; each result names its sweep */
+static uint64_t fake_sweep(void *user, uint64_t mask, int sensitivity, void *results) {
+    fake_bus_t *b = user;
+    pthread_mutex_lock(&b->lock);
+    int n = b->sweeps++;
+    if (n < CALLERS * 2) {
+        b->masks[n] = mask;
+        b->sensitivities[n] = sensitivity;
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    usleep(20000);
+
+    result_t *out = results;
+    for (int i = 0; i < COALESCE_MAX_SENSORS; i++) {
+        if (mask & (1ull << i)) {
+            out[i].sensitivity = sensitivity;
+            out[i].mask = mask;
+        }
+    }
+    return mask & ~b->fail_mask;
+}
+
+typedef struct {
+    uint64_t mask;
+    int sensitivity;
+    uint64_t done;
+    result_t results[COALESCE_MAX_SENSORS];
+} caller_t;
+
+static void *caller(void *arg) {
+    caller_t *c = arg;
+    c->done = coalescer_sweep(&coalescer, c->mask, c->sensitivity, c->results);
+    return NULL;
+}
+
+static void run_callers(caller_t *callers, int n) {
+    pthread_t threads[CALLERS];
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[i], NULL, caller, &callers[i]));
+    }
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+void setUp(void) {
+    memset(&bus, 0, sizeof(bus));
+    pthread_mutex_init(&bus.lock, NULL);
+    TEST_ASSERT_EQUAL_INT(0, coalescer_init(&coalescer, sizeof(result_t), fake_sweep, &bus));
+}
+
+void tearDown(void) {
+    coalescer_destroy(&coalescer);
+    pthread_mutex_destroy(&bus.lock);
+}
+
+/* Tests */
+void test_init_rejects_bad_arguments(void) {
+    coalescer_t c;
+    TEST_ASSERT_EQUAL_INT(-1, coalescer_init(&c, 0, fake_sweep, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, coalescer_init(&c, sizeof(result_t), NULL, NULL));
+
+    result_t results[COALESCE_MAX_SENSORS];
+    TEST_ASSERT_EQUAL_HEX64(0, coalescer_sweep(&coalescer, 0, 0, results));
+    TEST_ASSERT_EQUAL_INT(0, bus.sweeps);
+}
+
+void test_single_caller_sweeps_its_mask(void) {
+    bus.fail_mask = 0x4;
+    caller_t c = { .mask = 0x7, .sensitivity = 1 };
+    caller(&c);
+
+    TEST_ASSERT_EQUAL_INT(1, bus.sweeps);
+    TEST_ASSERT_EQUAL_HEX64(0x7, bus.masks[0]);
+    TEST_ASSERT_EQUAL_HEX64(0x3, c.done);
+    TEST_ASSERT_EQUAL_INT(1, c.results[0].sensitivity);
+}
+
+void test_concurrent_callers_share_sweeps(void) {
+    caller_t callers[CALLERS] = {0};
+    for (int i = 0; i < CALLERS; i++) {
+        callers[i].mask = 1ull << (i % 4);        // overlapping channel sets
+        callers[i].sensitivity = 0;
+    }
+    run_callers(callers, CALLERS);
+
+    /* The first caller sweeps alone, the others pile into at most one more
+       sweep per arrival window */
+    TEST_ASSERT_TRUE(bus.sweeps < CALLERS);
+    TEST_ASSERT_EQUAL_UINT64(CALLERS, coalescer.requests);
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)bus.sweeps, coalescer.sweeps);
+    for (int i = 0; i < CALLERS; i++) {
+        TEST_ASSERT_EQUAL_HEX64(callers[i].mask, callers[i].done);
+        int ch = i % 4;
+        TEST_ASSERT_TRUE(callers[i].results[ch].mask & callers[i].mask);
+    }
+}
+
+void test_sensitivities_are_never_mixed(void) {
+    caller_t callers[CALLERS] = {0};
+    for (int i = 0; i < CALLERS; i++) {
+        callers[i].mask = 0x3;
+        callers[i].sensitivity = i & 1;
+    }
+    run_callers(callers, CALLERS);
+
+    TEST_ASSERT_TRUE(bus.sweeps >= 2);
+    for (int i = 0; i < CALLERS; i++) {
+        TEST_ASSERT_EQUAL_HEX64(0x3, callers[i].done);
+        TEST_ASSERT_EQUAL_INT(callers[i].sensitivity, callers[i].results[0].sensitivity);
+        TEST_ASSERT_EQUAL_INT(callers[i].sensitivity, callers[i].results[1].sensitivity);
+    }
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_init_rejects_bad_arguments);
+    RUN_TEST(test_single_caller_sweeps_its_mask);
+    RUN_TEST(test_concurrent_callers_share_sweeps);
+    RUN_TEST(test_sensitivities_are_never_mixed);
+
+    return UNITY_END();
+}
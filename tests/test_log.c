@@ -0,0 +1,176 @@
+#include "unity.h"
+#include "../src/log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Record ring, level filtering and the drain thread of the logger */
+#define LOG_PATH    "/tmp/test_log.txt"
+
+/* Discard whatever an earlier test left in the ring */
+static void drain_ring(void) {
+    log_record_t rec;
+    while (log_pop(&rec)) {
+    }
+}
+
+void setUp(void) {
+    /* No drain thread: the tests pop the records themselves */
+    log_close();
+    drain_ring();
+    log_set_level(LOG_DEBUG);
+}
+
+void tearDown(void) {
+    log_close();
+    unlink(LOG_PATH);
+}
+
+/* Tests */
+void test_record_fields(void) {
+    LOG_W("Failed to read from I2C device", EREMOTEIO, 3, 0x10, 5, 8);
+
+    log_record_t rec;
+    TEST_ASSERT_EQUAL_INT(1, log_pop(&rec));
+    TEST_ASSERT_EQUAL_STRING("Failed to read from I2C device", rec.msg);
+    TEST_ASSERT_EQUAL_INT(LOG_WARN, rec.level);
+    TEST_ASSERT_EQUAL_INT(EREMOTEIO, rec.err);
+    TEST_ASSERT_EQUAL_INT(3, rec.bus);
+    TEST_ASSERT_EQUAL_HEX8(0x10, rec.addr);
+    TEST_ASSERT_EQUAL_INT(5, rec.channel);
+    TEST_ASSERT_EQUAL_INT64(8, rec.value);
+    TEST_ASSERT_TRUE(rec.timestamp_ns > 0);
+    TEST_ASSERT_EQUAL_INT(0, log_pop(&rec));
+}
+
+void test_records_keep_their_order(void) {
+    for (int i = 0; i < 100; i++) {
+        LOG_I("tick", 0, -1, 0, -1, i);
+    }
+
+    log_record_t rec;
+    uint64_t last_ns = 0;
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_INT(1, log_pop(&rec));
+        TEST_ASSERT_EQUAL_INT64(i, rec.value);
+        TEST_ASSERT_TRUE(rec.timestamp_ns >= last_ns);
+        last_ns = rec.timestamp_ns;
+    }
+    TEST_ASSERT_EQUAL_INT(0, log_pop(&rec));
+}
+
+void test_runtime_level_filters(void) {
+    TEST_ASSERT_EQUAL_INT(LOG_DEBUG, log_set_level(LOG_WARN));
+
+    LOG_D("debug", 0, -1, 0, -1, 0);
+    LOG_I("info", 0, -1, 0, -1, 0);
+    LOG_W("warn", 0, -1, 0, -1, 0);
+    LOG_E("error", 0, -1, 0, -1, 0);
+
+    log_record_t rec;
+    TEST_ASSERT_EQUAL_INT(1, log_pop(&rec));
+    TEST_ASSERT_EQUAL_STRING("warn", rec.msg);
+    TEST_ASSERT_EQUAL_INT(1, log_pop(&rec));
+    TEST_ASSERT_EQUAL_STRING("error", rec.msg);
+    TEST_ASSERT_EQUAL_INT(0, log_pop(&rec));
+
+    /* Out of range levels are clamped */
+    TEST_ASSERT_EQUAL_INT(LOG_WARN, log_set_level(99));
+    TEST_ASSERT_EQUAL_INT(LOG_DEBUG, log_set_level(-1));
+}
+
+void test_full_ring_drops_and_counts(void) {
+    uint64_t lost = log_dropped();
+
+    for (int i = 0; i < LOG_RING_SIZE + 10; i++) {
+        LOG_D("flood", 0, -1, 0, -1, i);
+    }
+    TEST_ASSERT_EQUAL_UINT64(lost + 10, log_dropped());
+
+    /* The oldest records are kept, the newest are the ones dropped */
+    log_record_t rec;
+    int count = 0;
+    while (log_pop(&rec)) {
+        TEST_ASSERT_EQUAL_INT64(count, rec.value);
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT(LOG_RING_SIZE, count);
+
+    /* Room again once drained */
+    LOG_D("flood", 0, -1, 0, -1, 0);
+    TEST_ASSERT_EQUAL_INT(1, log_pop(&rec));
+}
+
+void test_format_only_present_fields(void) {
+    log_record_t rec = {
+        .timestamp_ns = 12000345000ull,
+        .msg = "Failed to write to I2C device",
+        .value = 2,
+        .err = EREMOTEIO,
+        .bus = 4,
+        .channel = -1,
+        .level = LOG_WARN,
+        .addr = 0x10
+    };
+    char line[256];
+    char expected[256];
+    snprintf(expected, sizeof(expected),
+             "[12.000345] WARN Failed to write to I2C device bus=4 addr=0x10 value=2: %s", strerror(EREMOTEIO));
+    TEST_ASSERT_EQUAL_INT((int)strlen(expected), log_format(&rec, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING(expected, line);
+
+    log_record_t bare = { .timestamp_ns = 0, .msg = "bare", .bus = -1, .channel = -1, .level = LOG_ERROR };
+    log_format(&bare, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("[0.000000] ERROR bare", line);
+
+    /* Truncated, still terminated */
+    char small[16];
+    log_format(&rec, small, sizeof(small));
+    TEST_ASSERT_EQUAL_INT(15, (int)strlen(small));
+}
+
+void test_drain_thread_writes_file(void) {
+    unlink(LOG_PATH);
+    TEST_ASSERT_EQUAL_INT(0, log_open(LOG_PATH));
+
+    LOG_E("Failed to perform I2C combined transaction", ETIMEDOUT, 3, 0x10, -1, 4);
+    LOG_I("sweep done", 0, -1, 0, 7, 0);
+
+    /* Closing writes what is still queued */
+    log_close();
+
+    /* Records in order; a drop report from the flood test may follow them */
+    FILE *f = fopen(LOG_PATH, "r");
+    TEST_ASSERT_NOT_NULL(f);
+    char line[256];
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), f));
+    TEST_ASSERT_NOT_NULL(strstr(line, "ERROR Failed to perform I2C combined transaction bus=3 addr=0x10 value=4"));
+    TEST_ASSERT_NOT_NULL(strstr(line, strerror(ETIMEDOUT)));
+    TEST_ASSERT_NOT_NULL(fgets(line, sizeof(line), f));
+    TEST_ASSERT_NOT_NULL(strstr(line, "INFO sweep done sensor=7"));
+    while (fgets(line, sizeof(line), f) != NULL) {
+        TEST_ASSERT_NOT_NULL(strstr(line, "log record(s) dropped"));
+    }
+    fclose(f);
+
+    TEST_ASSERT_EQUAL_INT(-1, log_open("/nonexistent/dir/log.txt"));
+}
+
+int main(void) {
+    /* Open and close once so the first record does not start a drain thread */
+    log_open(NULL);
+    log_close();
+
+    UNITY_BEGIN();
+
+    RUN_TEST(test_record_fields);
+    RUN_TEST(test_records_keep_their_order);
+    RUN_TEST(test_runtime_level_filters);
+    RUN_TEST(test_full_ring_drops_and_counts);
+    RUN_TEST(test_format_only_present_fields);
+    RUN_TEST(test_drain_thread_writes_file);
+
+    return UNITY_END();
+}
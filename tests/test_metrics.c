@@ -0,0 +1,149 @@
+#include "unity.h"
+#include "../src/metrics.h"
+#include <stdint.h>
+#include <pthread.h>
+
+/* Bucket layout, quantiles and counters of the latency histograms */
+#define THREADS         4
+#define PER_THREAD      100000
+
+void setUp(void) {
+    metrics_reset();
+}
+
+void tearDown(void) {}
+
+/* Tests */
+void test_buckets_cover_values(void) {
+    /* Exact below 32 ns */
+    for (uint64_t ns = 0; ns < 32; ns++) {
+        TEST_ASSERT_EQUAL_INT((int)ns, metrics_bucket_index(ns));
+        TEST_ASSERT_EQUAL_UINT64(ns, metrics_bucket_upper_ns((int)ns));
+    }
+
+    /* Every value falls in a bucket whose range holds it, within 1/16 */
+    uint64_t values[] = { 32, 33, 100, 1000, 4095, 4096, 123456, 1000000, 999999999, 60000000000ull };
+    for (unsigned k = 0; k < sizeof(values) / sizeof(values[0]); k++) {
+        int index = metrics_bucket_index(values[k]);
+        uint64_t upper = metrics_bucket_upper_ns(index);
+        uint64_t lower = metrics_bucket_upper_ns(index - 1) + 1;
+        TEST_ASSERT_TRUE(values[k] >= lower && values[k] <= upper);
+        TEST_ASSERT_TRUE(upper - lower < values[k] / 16 + 1);
+    }
+
+    /* Buckets are contiguous */
+    for (int i = 1; i < METRICS_BUCKETS - 1; i++) {
+        TEST_ASSERT_EQUAL_INT(i, metrics_bucket_index(metrics_bucket_upper_ns(i - 1) + 1));
+    }
+
+    /* Huge values share the last bucket */
+    TEST_ASSERT_EQUAL_INT(METRICS_BUCKETS - 1, metrics_bucket_index(UINT64_MAX));
+}
+
+void test_quantiles_within_resolution(void) {
+    /* 1..1000 us, uniformly */
+    for (uint64_t us = 1; us <= 1000; us++) {
+        metrics_record(METRIC_SWEEP, us * 1000);
+    }
+
+    metrics_snapshot_t snap;
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_SWEEP, &snap));
+    TEST_ASSERT_EQUAL_UINT64(1000, snap.count);
+    TEST_ASSERT_EQUAL_UINT64(500500000ull, snap.sum_ns);
+    TEST_ASSERT_EQUAL_UINT64(1000000, snap.max_ns);
+
+    TEST_ASSERT_UINT64_WITHIN(500000 / 16, 500000, metrics_quantile_ns(&snap, 0.5));
+    TEST_ASSERT_UINT64_WITHIN(990000 / 16, 990000, metrics_quantile_ns(&snap, 0.99));
+    TEST_ASSERT_EQUAL_UINT64(1000000, metrics_quantile_ns(&snap, 1.0));
+    TEST_ASSERT_UINT64_WITHIN(1000 / 16, 1000, metrics_quantile_ns(&snap, 0.0));
+
+    /* Other histograms untouched */
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_MUX_SELECT, &snap));
+    TEST_ASSERT_EQUAL_UINT64(0, snap.count);
+    TEST_ASSERT_EQUAL_UINT64(0, metrics_quantile_ns(&snap, 0.5));
+}
+
+void test_count_le(void) {
+    metrics_record(METRIC_I2C_WRITE_READ, 50000);       // 50 us
+    metrics_record(METRIC_I2C_WRITE_READ, 200000);      // 200 us
+    metrics_record(METRIC_I2C_WRITE_READ, 200000);
+    metrics_record(METRIC_I2C_WRITE_READ, 5000000);     // 5 ms
+
+    metrics_snapshot_t snap;
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_I2C_WRITE_READ, &snap));
+    TEST_ASSERT_EQUAL_UINT64(0, metrics_count_le(&snap, 10000));
+    TEST_ASSERT_EQUAL_UINT64(1, metrics_count_le(&snap, 100000));
+    TEST_ASSERT_EQUAL_UINT64(3, metrics_count_le(&snap, 1000000));
+    TEST_ASSERT_EQUAL_UINT64(4, metrics_count_le(&snap, 10000000));
+    TEST_ASSERT_EQUAL_UINT64(4, metrics_count_le(&snap, UINT64_MAX));
+}
+
+static void *recorder(void *arg) {
+    uint64_t base = (uint64_t)(uintptr_t)arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        metrics_record(METRIC_I2C_TRANSFER, base + (uint64_t)i);
+    }
+    return NULL;
+}
+
+void test_concurrent_records_are_not_lost(void) {
+    pthread_t threads[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        TEST_ASSERT_EQUAL_INT(0, pthread_create(&threads[t], NULL, recorder, (void *)(uintptr_t)(t * 1000)));
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    metrics_snapshot_t snap;
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_I2C_TRANSFER, &snap));
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)THREADS * PER_THREAD, snap.count);
+    TEST_ASSERT_EQUAL_UINT64((THREADS - 1) * 1000 + PER_THREAD - 1, snap.max_ns);
+}
+
+void test_channel_counters(void) {
+    metrics_count_sweep(0x0F, 0x30, 0x01);
+    metrics_count_sweep(0x0F, 0x10, 0x00);
+
+    metrics_channel_t ch = metrics_channel(0);
+    TEST_ASSERT_EQUAL_UINT64(2, ch.samples);
+    TEST_ASSERT_EQUAL_UINT64(0, ch.errors);
+    TEST_ASSERT_EQUAL_UINT64(1, ch.saturated);
+
+    ch = metrics_channel(4);
+    TEST_ASSERT_EQUAL_UINT64(0, ch.samples);
+    TEST_ASSERT_EQUAL_UINT64(2, ch.errors);
+
+    ch = metrics_channel(5);
+    TEST_ASSERT_EQUAL_UINT64(1, ch.errors);
+
+    /* Saturation only counts for sensors read */
+    metrics_count_sweep(0x00, 0x00, 0x80);
+    TEST_ASSERT_EQUAL_UINT64(0, metrics_channel(7).saturated);
+
+    metrics_count_sweep(1ull << 63, 0, 0);
+    TEST_ASSERT_EQUAL_UINT64(1, metrics_channel(63).samples);
+    TEST_ASSERT_EQUAL_UINT64(0, metrics_channel(64).samples);
+}
+
+void test_unknown_metric(void) {
+    metrics_snapshot_t snap;
+    metrics_record(METRICS_NUM_LATENCIES, 10);
+    TEST_ASSERT_EQUAL_INT(-1, metrics_snapshot(METRICS_NUM_LATENCIES, &snap));
+    TEST_ASSERT_EQUAL_INT(-1, metrics_snapshot(-1, &snap));
+    TEST_ASSERT_NULL(metrics_latency_name(METRICS_NUM_LATENCIES));
+    TEST_ASSERT_EQUAL_STRING("sweep", metrics_latency_name(METRIC_SWEEP));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_buckets_cover_values);
+    RUN_TEST(test_quantiles_within_resolution);
+    RUN_TEST(test_count_le);
+    RUN_TEST(test_concurrent_records_are_not_lost);
+    RUN_TEST(test_channel_counters);
+    RUN_TEST(test_unknown_metric);
+
+    return UNITY_END();
+}
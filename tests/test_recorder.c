@@ -0,0 +1,180 @@
+#include "unity.h"
+#include "../src/recorder.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+/* On-disk recorder: rotation, retention and range scans by time and channel */
+#define MS              1000000ull
+#define T0              1700000000000000000ull
+#define SMALL_SEGMENT   (RECORDER_HEADER_SIZE + 4096)
+
+static char dir[64];
+static recorder_t rec;
+
+static acq_frame_t make_frame(uint64_t n, uint64_t channel_mask) {
+    acq_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.seq = n + 1;
+    frame.wall_ns = T0 + n * 10 * MS;
+    frame.timestamp_ns = n * 10 * MS;
+    frame.channel_mask = channel_mask;
+    frame.valid_mask = channel_mask;
+    for (int i = 0; i < ACQ_MAX_CHANNELS; i++) {
+        frame.conf[i] = 0x0800;
+        frame.raw[i].clear = (uint16_t)(n + i);
+    }
+    return frame;
+}
+
+static int count_segments(void) {
+    DIR *d = opendir(dir);
+    int n = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        n += (strstr(entry->d_name, RECORDER_SUFFIX) != NULL);
+    }
+    closedir(d);
+    return n;
+}
+
+typedef struct {
+    int frames;
+    int limit;
+    uint64_t first_seq;
+    uint64_t last_seq;
+    uint64_t channels;
+    int ordered;
+} scan_result_t;
+
+static int collect(const acq_frame_t *frame, void *user) {
+    scan_result_t *r = user;
+    if (r->frames == 0) {
+        r->first_seq = frame->seq;
+        r->ordered = 1;
+    } else if (frame->seq <= r->last_seq) {
+        r->ordered = 0;
+    }
+    r->last_seq = frame->seq;
+    r->channels |= frame->channel_mask;
+    r->frames++;
+    return r->limit > 0 && r->frames >= r->limit;
+}
+
+void setUp(void) {
+    strcpy(dir, "/tmp/test_recorder_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+}
+
+void tearDown(void) {
+    recorder_close(&rec);
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    TEST_ASSERT_EQUAL_INT(0, system(cmd));
+}
+
+/* Tests */
+void test_open_rejects_bad_arguments(void) {
+    TEST_ASSERT_EQUAL_INT(RECORDER_ERR, recorder_open(&rec, NULL, 0, 0));
+    TEST_ASSERT_EQUAL_INT(RECORDER_ERR, recorder_open(&rec, dir, RECORDER_HEADER_SIZE, 0));
+    TEST_ASSERT_EQUAL_INT(RECORDER_ERR, recorder_open(&rec, dir, 0, -1));
+    TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_open(&rec, dir, SMALL_SEGMENT, 0));
+    TEST_ASSERT_EQUAL_INT(0, count_segments());              // created on the first frame
+}
+
+void test_rotates_segments_and_scans_everything(void) {
+    TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_open(&rec, dir, SMALL_SEGMENT, 0));
+    for (int n = 0; n < 500; n++) {
+        acq_frame_t frame = make_frame((uint64_t)n, 0xFF);
+        TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_append(&rec, &frame));
+    }
+
+    /* 136 bytes per frame, 30 per 4 KiB segment */
+    TEST_ASSERT_EQUAL_UINT64(17, rec.segments);
+    TEST_ASSERT_EQUAL_INT(17, count_segments());
+
+    /* The segment being written is readable too */
+    scan_result_t r = {0};
+    TEST_ASSERT_EQUAL_INT(500, recorder_scan(dir, 0, UINT64_MAX, UINT64_MAX, collect, &r));
+    TEST_ASSERT_EQUAL_UINT64(1, r.first_seq);
+    TEST_ASSERT_EQUAL_UINT64(500, r.last_seq);
+    TEST_ASSERT_TRUE(r.ordered);
+}
+
+void test_range_scan_by_time_and_channel(void) {
+    TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_open(&rec, dir, SMALL_SEGMENT, 0));
+    for (int n = 0; n < 300; n++) {
+        acq_frame_t frame = make_frame((uint64_t)n, (n % 2) ? 0x3 : 0xC);
+        TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_append(&rec, &frame));
+    }
+    recorder_close(&rec);
+
+    /* Frames 100..199 by time, then only those carrying sensor 1 (odd ones) */
+    scan_result_t r = {0};
+    TEST_ASSERT_EQUAL_INT(100, recorder_scan(dir, T0 + 1000 * MS, T0 + 1990 * MS, UINT64_MAX, collect, &r));
+    TEST_ASSERT_EQUAL_UINT64(101, r.first_seq);
+    TEST_ASSERT_EQUAL_UINT64(200, r.last_seq);
+
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT_EQUAL_INT(50, recorder_scan(dir, T0 + 1000 * MS, T0 + 1990 * MS, 0x2, collect, &r));
+    TEST_ASSERT_EQUAL_HEX64(0x2, r.channels);
+    TEST_ASSERT_EQUAL_UINT64(102, r.first_seq);
+
+    memset(&r, 0, sizeof(r));
+    TEST_ASSERT_EQUAL_INT(0, recorder_scan(dir, T0 + 5000 * MS, UINT64_MAX, UINT64_MAX, collect, &r));
+
+    /* The callback can stop the scan */
+    memset(&r, 0, sizeof(r));
+    r.limit = 7;
+    TEST_ASSERT_EQUAL_INT(7, recorder_scan(dir, 0, UINT64_MAX, UINT64_MAX, collect, &r));
+}
+
+void test_keeps_only_the_newest_segments(void) {
+    TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_open(&rec, dir, SMALL_SEGMENT, 3));
+    for (int n = 0; n < 300; n++) {
+        acq_frame_t frame = make_frame((uint64_t)n, 0xFF);
+        TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_append(&rec, &frame));
+    }
+    TEST_ASSERT_EQUAL_INT(3, count_segments());
+
+    scan_result_t r = {0};
+    TEST_ASSERT_TRUE(recorder_scan(dir, 0, UINT64_MAX, UINT64_MAX, collect, &r) > 0);
+    TEST_ASSERT_EQUAL_UINT64(300, r.last_seq);
+    TEST_ASSERT_TRUE(r.first_seq > 200);
+}
+
+void test_reopen_appends_a_new_segment(void) {
+    TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_open(&rec, dir, 0, 0));
+    for (int n = 0; n < 10; n++) {
+        acq_frame_t frame = make_frame((uint64_t)n, 0x1);
+        TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_append(&rec, &frame));
+    }
+    recorder_close(&rec);
+
+    TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_open(&rec, dir, 0, 0));
+    for (int n = 10; n < 20; n++) {
+        acq_frame_t frame = make_frame((uint64_t)n, 0x1);
+        TEST_ASSERT_EQUAL_INT(RECORDER_OK, recorder_append(&rec, &frame));
+    }
+    recorder_close(&rec);
+    TEST_ASSERT_EQUAL_INT(2, count_segments());
+
+    scan_result_t r = {0};
+    TEST_ASSERT_EQUAL_INT(20, recorder_scan(dir, 0, UINT64_MAX, UINT64_MAX, collect, &r));
+    TEST_ASSERT_TRUE(r.ordered);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_open_rejects_bad_arguments);
+    RUN_TEST(test_rotates_segments_and_scans_everything);
+    RUN_TEST(test_range_scan_by_time_and_channel);
+    RUN_TEST(test_keeps_only_the_newest_segments);
+    RUN_TEST(test_reopen_appends_a_new_segment);
+
+    return UNITY_END();
+}
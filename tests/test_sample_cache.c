@@ -0,0 +1,110 @@
+#include "unity.h"
+#include "../src/sample_cache.h"
+#include <stdint.h>
+#include <pthread.h>
+
+/* Latest-value cache: freshness rules and torn-read protection */
+#define MS          1000000ull
+
+static sample_cache_t cache;
+
+static sample_cache_entry_t make_entry(uint64_t timestamp_ns, uint8_t sensitivity, uint16_t counts) {
+    sample_cache_entry_t entry = {0};
+    entry.timestamp_ns = timestamp_ns;
+    entry.sensitivity = sensitivity;
+    entry.conf = counts;
+    entry.raw.clear = counts;
+    entry.raw.red = counts;
+    entry.raw.green = counts;
+    entry.raw.blue = counts;
+    entry.norm.intensity_counts = counts;
+    return entry;
+}
+
+void setUp(void) {
+    sample_cache_init(&cache);
+}
+
+void tearDown(void) {}
+
+/* Tests */
+void test_empty_until_stored(void) {
+    sample_cache_entry_t out;
+    TEST_ASSERT_EQUAL_INT(SAMPLE_CACHE_EMPTY, sample_cache_load(&cache, 3, &out));
+
+    sample_cache_entry_t entry = make_entry(100 * MS, 0, 1234);
+    sample_cache_store(&cache, 3, &entry);
+    TEST_ASSERT_EQUAL_INT(SAMPLE_CACHE_OK, sample_cache_load(&cache, 3, &out));
+    TEST_ASSERT_EQUAL_UINT16(1234, out.raw.green);
+
+    TEST_ASSERT_EQUAL_INT(SAMPLE_CACHE_ERR, sample_cache_load(&cache, SAMPLE_CACHE_SENSORS, &out));
+
+    sample_cache_init(&cache);
+    TEST_ASSERT_EQUAL_INT(SAMPLE_CACHE_EMPTY, sample_cache_load(&cache, 3, &out));
+}
+
+void test_fresh_by_age_and_sensitivity(void) {
+    sample_cache_entry_t a = make_entry(1000 * MS, 0, 1);
+    sample_cache_entry_t b = make_entry(900 * MS, 0, 2);
+    sample_cache_entry_t c = make_entry(1000 * MS, 1, 3);
+    sample_cache_store(&cache, 0, &a);
+    sample_cache_store(&cache, 1, &b);
+    sample_cache_store(&cache, 2, &c);
+
+    /* At t = 1050 ms with 100 ms tolerance: sensor 1 is 150 ms old, sensor 2
+       has the other sensitivity, sensor 3 was never read */
+    sample_cache_entry_t out[SAMPLE_CACHE_SENSORS];
+    uint64_t served = sample_cache_fresh(&cache, 0xF, 0, 100 * MS, 1050 * MS, out);
+    TEST_ASSERT_EQUAL_HEX64(0x1, served);
+    TEST_ASSERT_EQUAL_UINT16(1, out[0].raw.clear);
+
+    TEST_ASSERT_EQUAL_HEX64(0x3, sample_cache_fresh(&cache, 0xF, 0, 200 * MS, 1050 * MS, out));
+    TEST_ASSERT_EQUAL_HEX64(0x4, sample_cache_fresh(&cache, 0xF, 1, 200 * MS, 1050 * MS, out));
+
+    /* Stored after 'now' was sampled: age 0 */
+    TEST_ASSERT_EQUAL_HEX64(0x1, sample_cache_fresh(&cache, 0x1, 0, 0, 990 * MS, out));
+}
+
+static volatile int stop_writer;
+
+static void *writer(void *arg) {
+    (void)arg;
+    uint16_t n = 1;
+    while (!stop_writer) {
+        sample_cache_entry_t entry = make_entry(n, 0, n);
+        sample_cache_store(&cache, 7, &entry);
+        n = (uint16_t)(n == 0xFFFF ? 1 : n + 1);
+    }
+    return NULL;
+}
+
+void test_reader_never_sees_torn_entry(void) {
+    pthread_t thread;
+    stop_writer = 0;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, writer, NULL));
+
+    int torn = 0;
+    for (int i = 0; i < 200000; i++) {
+        sample_cache_entry_t out;
+        if (sample_cache_load(&cache, 7, &out) != SAMPLE_CACHE_OK) {
+            continue;
+        }
+        uint16_t n = out.raw.clear;
+        torn += (out.raw.red != n || out.raw.blue != n || out.conf != n ||
+                 out.norm.intensity_counts != n || out.timestamp_ns != n);
+    }
+
+    stop_writer = 1;
+    pthread_join(thread, NULL);
+    TEST_ASSERT_EQUAL_INT(0, torn);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_empty_until_stored);
+    RUN_TEST(test_fresh_by_age_and_sensitivity);
+    RUN_TEST(test_reader_never_sees_torn_entry);
+
+    return UNITY_END();
+}
@@ -0,0 +1,108 @@
+#include "unity.h"
+#include "../src/sample_timer.h"
+#include <stdint.h>
+#include <time.h>
+
+/* Period boundaries, alignment and overrun accounting of the sampling clock */
+#define PERIOD_NS   5000000ull          // 5 ms
+
+static sample_timer_t timer;
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull) };
+    nanosleep(&ts, NULL);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {
+    sample_timer_close(&timer);
+}
+
+/* Tests */
+void test_ticks_on_period_boundaries(void) {
+    uint64_t first_ns = sample_timer_now_ns() + PERIOD_NS;
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_OK, sample_timer_init(&timer, PERIOD_NS, first_ns));
+
+    /* A loaded machine may overrun a period: the ticks missed are counted
+       and skipped, never shifting the grid */
+    uint64_t tick_ns = 0;
+    uint64_t index = 0;
+    uint64_t missed = 0;
+    for (int i = 0; i < 10; i++) {
+        int ret = sample_timer_wait(&timer, &tick_ns);
+        TEST_ASSERT_TRUE(ret >= 0);
+        index += (uint64_t)ret;
+        missed += (uint64_t)ret;
+        TEST_ASSERT_EQUAL_UINT64(first_ns + index * PERIOD_NS, tick_ns);
+        index++;
+
+        /* Work inside the period does not shift the next tick */
+        sleep_ns(PERIOD_NS / 2);
+    }
+
+    TEST_ASSERT_EQUAL_UINT64(10, timer.stats.ticks);
+    TEST_ASSERT_EQUAL_UINT64(missed, timer.stats.missed);
+    TEST_ASSERT_EQUAL_UINT64(index, timer.stats.ticks + timer.stats.missed);
+    TEST_ASSERT_TRUE(timer.stats.min_late_ns <= timer.stats.mean_late_ns);
+}
+
+void test_overrun_counts_missed_ticks(void) {
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_OK, sample_timer_init(&timer, PERIOD_NS, 0));
+    uint64_t first_ns = timer.next_ns;
+
+    sleep_ns(3 * PERIOD_NS + PERIOD_NS / 2);
+    uint64_t tick_ns = 0;
+    int missed = sample_timer_wait(&timer, &tick_ns);
+    TEST_ASSERT_TRUE(missed >= 2);
+    TEST_ASSERT_EQUAL_UINT64(first_ns + (uint64_t)missed * PERIOD_NS, tick_ns);
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)missed, timer.stats.missed);
+
+    /* The schedule resumes on the same grid */
+    TEST_ASSERT_TRUE(sample_timer_wait(&timer, &tick_ns) >= 0);
+    TEST_ASSERT_EQUAL_UINT64(0, (tick_ns - first_ns) % PERIOD_NS);
+}
+
+void test_align_to_past_phase(void) {
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_OK, sample_timer_init(&timer, PERIOD_NS, 0));
+
+    /* A cycle that started 12.5 periods ago: next boundary is 0.5 periods away */
+    uint64_t phase_ns = sample_timer_now_ns() - 12 * PERIOD_NS - PERIOD_NS / 2;
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_OK, sample_timer_align(&timer, PERIOD_NS, phase_ns));
+
+    uint64_t tick_ns = 0;
+    TEST_ASSERT_TRUE(sample_timer_wait(&timer, &tick_ns) >= 0);
+    TEST_ASSERT_EQUAL_UINT64(0, (tick_ns - phase_ns) % PERIOD_NS);
+    TEST_ASSERT_TRUE(tick_ns >= phase_ns + 13 * PERIOD_NS);
+}
+
+void test_jitter_statistics(void) {
+    sample_timer_stats_t stats = {0};
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, (float)sample_timer_jitter_ns(&stats));
+
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_OK, sample_timer_init(&timer, PERIOD_NS, 0));
+    for (int i = 0; i < 5; i++) {
+        sample_timer_wait(&timer, NULL);
+    }
+    TEST_ASSERT_TRUE(sample_timer_jitter_ns(&timer.stats) >= 0.0);
+
+    sample_timer_reset_stats(&timer);
+    TEST_ASSERT_EQUAL_UINT64(0, timer.stats.ticks);
+}
+
+void test_invalid_arguments(void) {
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_ERR_ARG, sample_timer_init(&timer, 0, 0));
+    TEST_ASSERT_EQUAL_INT(SAMPLE_TIMER_ERR_ARG, sample_timer_wait(NULL, NULL));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_ticks_on_period_boundaries);
+    RUN_TEST(test_overrun_counts_missed_ticks);
+    RUN_TEST(test_align_to_past_phase);
+    RUN_TEST(test_jitter_statistics);
+    RUN_TEST(test_invalid_arguments);
+
+    return UNITY_END();
+}
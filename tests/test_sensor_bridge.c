@@ -0,0 +1,253 @@
+#include "unity.h"
+#include "../src/sensor_bridge.c"
+#include "../src/i2c_sim.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Bridge entry points against the simulated bus (built into the test, so
+   the session internals are visible) */
+#define TEST_BUS    "sim:"
+#define TEST_RING   "/pi_sensor_ring_test"
+
+void setUp(void) {
+    sensor_session_shutdown();
+    TEST_ASSERT_EQUAL_INT(0, sensor_session_init(TEST_BUS));
+}
+
+void tearDown(void) {
+    sensor_session_shutdown();
+    sensor_ring_detach();
+    shm_ring_unlink(TEST_RING);
+    unsetenv("SENSOR_BUS");
+}
+
+/* Number of the 8 samples in 'out' with status 'status' */
+static int count_status(const SensorSample *out, int32_t status) {
+    int n = 0;
+    for (int i = 0; i < 8; i++) {
+        n += (out[i].status == status);
+    }
+    return n;
+}
+
+/* Tests */
+void test_cached_read_keeps_hits_of_mixed_mask(void) {
+    SensorSample first[8];
+    SensorSample out[8];
+
+    /* Sensors 0..3 read now, 4..7 never */
+    TEST_ASSERT_EQUAL_INT(4, sensor_read_batch_cached(0x0F, 0, 0, first, 8, 0));
+
+    /* 0..3 come from the cache, only 4..7 are swept */
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch_cached(0xFF, 0, 60000, out, 8, 0));
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL_INT(i, out[i].channel);
+        TEST_ASSERT_EQUAL_INT(BRIDGE_OK, out[i].status);
+    }
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT64(first[i].timestamp_ns, out[i].timestamp_ns);
+        TEST_ASSERT_EQUAL_UINT16(first[i].raw_clear, out[i].raw_clear);
+    }
+    TEST_ASSERT_TRUE(out[4].timestamp_ns > first[3].timestamp_ns);
+}
+
+void test_cancel_releases_finished_sweep(void) {
+    int handles[BRIDGE_MAX_ASYNC];
+    for (int k = 0; k < BRIDGE_MAX_ASYNC; k++) {
+        handles[k] = sensor_sweep_start(0x01, 0, 0, NULL, NULL);
+        TEST_ASSERT_TRUE(handles[k] >= 0);
+    }
+    TEST_ASSERT_EQUAL_INT(-1, sensor_sweep_start(0x01, 0, 0, NULL, NULL));
+
+    /* Never collected: cancelling frees the slot at once */
+    TEST_ASSERT_EQUAL_INT(1, sensor_sweep_wait(handles[0], -1));
+    TEST_ASSERT_EQUAL_INT(0, sensor_sweep_cancel(handles[0]));
+    TEST_ASSERT_EQUAL_INT(-1, sensor_sweep_poll(handles[0]));
+    TEST_ASSERT_EQUAL_INT(-1, sensor_sweep_cancel(handles[0]));
+
+    handles[0] = sensor_sweep_start(0x01, 0, 0, NULL, NULL);
+    TEST_ASSERT_TRUE(handles[0] >= 0);
+    for (int k = 0; k < BRIDGE_MAX_ASYNC; k++) {
+        TEST_ASSERT_EQUAL_INT(1, sensor_sweep_wait(handles[k], -1));
+        TEST_ASSERT_EQUAL_INT(0, sensor_sweep_cancel(handles[k]));
+    }
+}
+
+void test_cancel_running_sweep(void) {
+    SensorSample out[8];
+    int handle = sensor_sweep_start(0xFF, 0, 0, NULL, NULL);
+    TEST_ASSERT_TRUE(handle >= 0);
+    TEST_ASSERT_EQUAL_INT(0, sensor_sweep_poll(handle));
+
+    /* The handle is gone at once; the slot follows when the sweep ends */
+    TEST_ASSERT_EQUAL_INT(0, sensor_sweep_cancel(handle));
+    TEST_ASSERT_EQUAL_INT(-1, sensor_sweep_poll(handle));
+    TEST_ASSERT_EQUAL_INT(-1, sensor_sweep_wait(handle, 0));
+    TEST_ASSERT_EQUAL_INT(-1, sensor_sweep_complete(handle, out, 8));
+
+    /* The worker frees the slot once its sweep is over */
+    int busy = 1;
+    uint64_t deadline_ns = sweep_now_ns() + 10000000000ull;
+    while (busy && sweep_now_ns() < deadline_ns) {
+        pthread_mutex_lock(&async_lock);
+        busy = (async_slots[handle % BRIDGE_MAX_ASYNC].state != ASYNC_FREE);
+        pthread_mutex_unlock(&async_lock);
+        sweep_sleep_until_ns(sweep_now_ns() + 1000000ull);
+    }
+    TEST_ASSERT_FALSE(busy);
+}
+
+void test_session_reused_across_calls(void) {
+    SensorSample out[8];
+    i2c_sim_stats_t first;
+    i2c_sim_stats_t second;
+    int fd = session.group.bus[0].fd;
+    i2c_sim_reset_stats(fd);
+
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_OK));
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &first));
+    i2c_sim_reset_stats(fd);
+
+    /* Same bus, no reopen, and the sensors are not configured again */
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_OK));
+    TEST_ASSERT_TRUE(session.open);
+    TEST_ASSERT_EQUAL_INT(fd, session.group.bus[0].fd);
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &second));
+    TEST_ASSERT_TRUE(second.transfers < first.transfers);
+}
+
+void test_back_to_back_reads_wait_for_new_samples(void) {
+    SensorSample first[8];
+    SensorSample second[8];
+    uint64_t fresh_ns[8];
+    sweep_ctx_t *ctx = &session.group.bus[0].sweep;
+
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, first, 8, 0));
+    for (int i = 0; i < 8; i++) {
+        fresh_ns[i] = sweep_fresh_ns(ctx, i);
+        TEST_ASSERT_TRUE(fresh_ns[i] > first[i].timestamp_ns);
+    }
+
+    /* Asked again within the same integration cycle: the counts latched
+       then would come back, so the read waits for the next cycle */
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, second, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(second, BRIDGE_OK));
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_TRUE(second[i].timestamp_ns >= fresh_ns[i]);
+    }
+
+    /* The cache holds the new sample, not the old one with a new time */
+    sample_cache_entry_t entry;
+    TEST_ASSERT_EQUAL_INT(SAMPLE_CACHE_OK, sample_cache_load(&session.cache, 0, &entry));
+    TEST_ASSERT_EQUAL_UINT64(second[0].timestamp_ns, entry.timestamp_ns);
+}
+
+void test_session_recovers_from_bus_errors(void) {
+    SensorSample out[8];
+    int fd = session.group.bus[0].fd;
+    i2c_sim_config_t cfg;
+    i2c_sim_default_config(&cfg);
+
+    /* Every transfer NACKs: the sweep fails, the session stays open */
+    cfg.nack_probability = 1.0f;
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_configure(fd, &cfg));
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_ERR_BUS));
+
+    /* Bus healthy again: muxes and sensors are set up anew */
+    cfg.nack_probability = 0.0f;
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_configure(fd, &cfg));
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_OK));
+    TEST_ASSERT_EQUAL_INT(fd, session.group.bus[0].fd);
+}
+
+void test_session_reopens_after_failed_open(void) {
+    SensorSample out[8];
+    sensor_session_shutdown();
+
+    /* The bus cannot be opened: every sensor fails, nothing stays open */
+    setenv("SENSOR_BUS", "/dev/i2c-does-not-exist", 1);
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_ERR_BUS));
+    TEST_ASSERT_FALSE(session.open);
+
+    /* The next call tries again */
+    setenv("SENSOR_BUS", TEST_BUS, 1);
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_OK));
+    TEST_ASSERT_TRUE(session.open);
+}
+
+void test_session_refuses_too_many_buses(void) {
+    SensorSample out[8];
+    sensor_session_shutdown();
+
+    /* One bus more than a group holds: nothing is opened, not the first six */
+    setenv("SENSOR_BUS", "sim:;sim:;sim:;sim:;sim:;sim:;sim:", 1);
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_ERR_BUS));
+    TEST_ASSERT_FALSE(session.open);
+}
+
+void test_ring_is_group_writable(void) {
+    shm_ring_t *created = shm_ring_create(TEST_RING, NULL);
+    TEST_ASSERT_NOT_NULL(created);
+
+    struct stat st;
+    int fd = shm_open(TEST_RING, O_RDONLY, 0);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(0, fstat(fd, &st));
+    close(fd);
+    TEST_ASSERT_EQUAL_HEX32(SHM_RING_MODE, st.st_mode & 0777);
+
+    TEST_ASSERT_EQUAL_INT(0, sensor_ring_attach(TEST_RING));
+    shm_ring_close(created);
+}
+
+void test_unattachable_ring_keeps_bus_closed(void) {
+    SensorSample out[8];
+    sensor_session_shutdown();
+    setenv("SENSOR_BUS", TEST_BUS, 1);
+
+    /* A ring the bridge cannot use (here: not a ring at all) */
+    int fd = shm_open(TEST_RING, O_CREAT | O_RDWR, 0600);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(0, ftruncate(fd, (off_t)sizeof(shm_ring_t)));
+    close(fd);
+
+    /* The daemon owns the bus: no fallback to opening it here */
+    TEST_ASSERT_EQUAL_INT(-2, sensor_ring_attach(TEST_RING));
+    TEST_ASSERT_EQUAL_INT(-1, sensor_session_init(NULL));
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_ERR_BUS));
+    TEST_ASSERT_FALSE(session.open);
+
+    /* Daemon gone: the bus is ours again */
+    shm_ring_unlink(TEST_RING);
+    TEST_ASSERT_EQUAL_INT(-1, sensor_ring_attach(TEST_RING));
+    TEST_ASSERT_EQUAL_INT(8, sensor_read_batch(0xFF, 0, out, 8, 0));
+    TEST_ASSERT_EQUAL_INT(8, count_status(out, BRIDGE_OK));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_session_reused_across_calls);
+    RUN_TEST(test_back_to_back_reads_wait_for_new_samples);
+    RUN_TEST(test_session_recovers_from_bus_errors);
+    RUN_TEST(test_session_reopens_after_failed_open);
+    RUN_TEST(test_session_refuses_too_many_buses);
+    RUN_TEST(test_ring_is_group_writable);
+    RUN_TEST(test_unattachable_ring_keeps_bus_closed);
+    RUN_TEST(test_cached_read_keeps_hits_of_mixed_mask);
+    RUN_TEST(test_cancel_releases_finished_sweep);
+    RUN_TEST(test_cancel_running_sweep);
+
+    return UNITY_END();
+}
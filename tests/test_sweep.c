@@ -0,0 +1,394 @@
+#include "unity.h"
+#include "../src/i2c_driver_pi.h"
+#include "../src/i2c_sim.h"
+#include "../src/sweep.h"
+#include "../src/metrics.h"
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Sweeps against the simulated bus: real driver, mux and sensor code */
+#define MUX_ADDR    0x70
+#define TEST_IT_MS  50.0f
+
+static const veml3328_cfg_t test_cfg = {
+    .gain_factor = 1.0f,
+    .dg_factor   = 1.0f,
+    .sens_factor = 0.0f,
+    .it_ms       = TEST_IT_MS,
+    .ds_it_ms    = 100.0f,
+    .dark_offset = 0
+};
+
+static int fd = -1;
+static sweep_ctx_t ctx;
+static veml3328_cfg_t cfg[SWEEP_NUM_CHANNELS];
+
+static void open_sim(const char *path) {
+    if (fd >= 0) {
+        i2c_close_bus(fd);
+    }
+    fd = i2c_open_bus(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    sweep_init(&ctx, fd, MUX_ADDR, VEML3328_I2C_ADDR);
+}
+
+void setUp(void) {
+    for (int ch = 0; ch < SWEEP_NUM_CHANNELS; ch++) {
+        cfg[ch] = test_cfg;
+    }
+    open_sim("sim:");
+}
+
+void tearDown(void) {
+    i2c_close_bus(fd);
+    fd = -1;
+}
+
+/* Tests */
+void test_sweep_reads_all_channels(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS] = {0};
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+
+    /* Channel 0 is red, channel 4 blue in the simulator's default scene */
+    TEST_ASSERT_TRUE(raw[0].red > raw[0].blue);
+    TEST_ASSERT_TRUE(raw[4].blue > raw[4].red);
+    TEST_ASSERT_EQUAL_UINT16(100, raw[0].clear);    // 2 counts/ms * 50 ms
+}
+
+void test_sweep_pipelined_waits_once(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    uint64_t start_ns = sweep_now_ns();
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    uint64_t elapsed_ms = (sweep_now_ns() - start_ns) / 1000000ull;
+
+    /* Eight sequential sweeps would take 8 * IT */
+    TEST_ASSERT_TRUE(elapsed_ms >= (uint64_t)TEST_IT_MS);
+    TEST_ASSERT_TRUE(elapsed_ms < 2 * (uint64_t)TEST_IT_MS);
+}
+
+void test_sweep_broadcasts_shared_config(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    i2c_sim_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+
+    /* 1 mask select + 1 CONF write, then the harvest: the select of
+       sensor 0, and 8 transactions of reads ended by the next select */
+    TEST_ASSERT_EQUAL_UINT64(2 + 1 + 8, stats.transfers);
+}
+
+void test_sweep_repeat_skips_config(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    i2c_sim_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    i2c_sim_reset_stats(fd);
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+
+    /* No CONF writes; the sweep starts on the routed channel: one
+       harvest transaction per sensor */
+    TEST_ASSERT_EQUAL_UINT64(8, stats.transfers);
+}
+
+void test_sweep_absent_sensor(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    open_sim("sim:present=0xF7");       // nothing on channel 3
+
+    TEST_ASSERT_EQUAL_INT(0xF7, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+}
+
+void test_sweep_bus_errors(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    open_sim("sim:nack=1");
+
+    TEST_ASSERT_EQUAL_INT(0, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+}
+
+/* Two muxes: each sensor must be read alone although all share one address */
+static void open_two_muxes(void) {
+    i2c_close_bus(fd);
+    fd = i2c_open_bus("sim:muxes=2");
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    topo_t topo;
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_from_spec(&topo, fd, "auto"));
+    TEST_ASSERT_EQUAL_INT(2, topo.num_muxes);
+    sweep_init_topology(&ctx, fd, &topo, VEML3328_I2C_ADDR);
+}
+
+void test_multi_mux_reads_every_sensor(void) {
+    veml3328_cfg_t cfg16[16];
+    veml3328_raw_data_t raw[16] = {0};
+    uint64_t done = 0;
+    for (int i = 0; i < 16; i++) {
+        cfg16[i] = test_cfg;
+    }
+    open_two_muxes();
+
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_run_sensors(&ctx, 0xFFFF, cfg16, raw, NULL, &done));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFF, done);
+
+    /* The second mux sees 10% more light: a mix of both would read less */
+    TEST_ASSERT_EQUAL_UINT16(100, raw[0].clear);
+    TEST_ASSERT_EQUAL_UINT16(110, raw[8].clear);
+    TEST_ASSERT_EQUAL_UINT16(440, raw[15].clear);     // bright white channel 7
+}
+
+void test_multi_mux_minimal_switching(void) {
+    veml3328_cfg_t cfg16[16];
+    veml3328_raw_data_t raw[16];
+    uint64_t done = 0;
+    i2c_sim_stats_t stats;
+    for (int i = 0; i < 16; i++) {
+        cfg16[i] = test_cfg;
+    }
+    open_two_muxes();
+
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_run_sensors(&ctx, 0xFFFF, cfg16, raw, NULL, &done));
+    i2c_sim_reset_stats(fd);
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_run_sensors(&ctx, 0xFFFF, cfg16, raw, NULL, &done));
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+
+    /* Reads of 16 sensors, each ended by the selects of the next one
+       (one disable between the muxes): one transaction per sensor */
+    TEST_ASSERT_EQUAL_UINT64(16, stats.transfers);
+}
+
+void test_multi_mux_broadcast_config(void) {
+    veml3328_cfg_t cfg16[16];
+    veml3328_raw_data_t raw[16];
+    uint64_t done = 0;
+    i2c_sim_stats_t stats;
+    for (int i = 0; i < 16; i++) {
+        cfg16[i] = test_cfg;
+    }
+    open_two_muxes();
+    i2c_sim_reset_stats(fd);            // forget the discovery probes
+
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_configure_all(&ctx, 0xFFFF, &test_cfg));
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+
+    /* Both muxes opened on every channel, then a single CONF write */
+    TEST_ASSERT_EQUAL_UINT64(3, stats.transfers);
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_run_sensors(&ctx, 0xFFFF, cfg16, raw, NULL, &done));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFF, done);
+}
+
+void test_driver_rejects_unregistered_fd(void) {
+    uint8_t reg = VEML3328_REG_ID;
+    uint8_t rx[2];
+    int other = open("/dev/null", O_RDWR);
+    TEST_ASSERT_TRUE(other >= 0);
+
+    /* Not opened through i2c_open_bus: never adopted, never ioctl'd */
+    errno = 0;
+    TEST_ASSERT_EQUAL_INT(-1, i2c_write_read(other, VEML3328_I2C_ADDR, &reg, 1, rx, 2));
+    TEST_ASSERT_EQUAL_INT(EBADF, errno);
+    TEST_ASSERT_EQUAL_INT(-1, i2c_bus_set_limits(other, 100, -1));
+    TEST_ASSERT_EQUAL_INT(EBADF, errno);
+    TEST_ASSERT_EQUAL_INT(-1, i2c_bus_set_retry(other, 1, 10));
+    TEST_ASSERT_EQUAL_INT(EBADF, errno);
+    TEST_ASSERT_EQUAL_INT(-1, i2c_bus_set_retry(fd, -1, 10));
+    TEST_ASSERT_EQUAL_INT(EINVAL, errno);
+    TEST_ASSERT_EQUAL_INT(0, i2c_bus_combined(other));
+    close(other);
+}
+
+void test_apply_cfg_rejects_bad_sensor(void) {
+    int changed = 1;
+    TEST_ASSERT_EQUAL_INT(TCA_INVALID_CHANNEL, sweep_apply_cfg(&ctx, -1, &test_cfg, &changed));
+    TEST_ASSERT_EQUAL_INT(0, changed);
+    TEST_ASSERT_EQUAL_INT(TCA_INVALID_CHANNEL, sweep_apply_cfg(&ctx, SWEEP_NUM_CHANNELS, &test_cfg, &changed));
+    TEST_ASSERT_EQUAL_INT(TCA_INVALID_CHANNEL, sweep_apply_cfg(&ctx, SWEEP_MAX_SENSORS, &test_cfg, &changed));
+    TEST_ASSERT_EQUAL_HEX64(0, ctx.conf_valid);
+}
+
+void test_sim_rejects_bad_path(void) {
+    TEST_ASSERT_TRUE(i2c_open_bus("sim:muxes=9") < 0);
+    TEST_ASSERT_TRUE(i2c_open_bus("sim:bogus=1") < 0);
+}
+
+void test_poll_serves_cached_until_fresh(void) {
+    veml3328_raw_data_t first[SWEEP_NUM_CHANNELS];
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t read_ns[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    uint64_t cached = 0;
+    i2c_sim_stats_t stats;
+
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, first, NULL));
+    i2c_sim_reset_stats(fd);
+
+    /* Nothing new integrated yet: no bus traffic, the same sample */
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_poll_sensors(&ctx, 0xFF, cfg, raw, read_ns, &done, &cached));
+    TEST_ASSERT_EQUAL_HEX64(0xFF, done);
+    TEST_ASSERT_EQUAL_HEX64(0xFF, cached);
+    TEST_ASSERT_EQUAL_MEMORY(first, raw, sizeof(first));
+    TEST_ASSERT_EQUAL_UINT64(ctx.sample_ns[0], read_ns[0]);
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+    TEST_ASSERT_EQUAL_UINT64(0, stats.transfers);
+
+    /* Once the next cycle ends every sensor is read again */
+    uint64_t fresh_ns = 0;
+    for (int i = 0; i < SWEEP_NUM_CHANNELS; i++) {
+        TEST_ASSERT_TRUE(sweep_fresh_ns(&ctx, i) > ctx.sample_ns[i]);
+        if (sweep_fresh_ns(&ctx, i) > fresh_ns) {
+            fresh_ns = sweep_fresh_ns(&ctx, i);
+        }
+    }
+    sweep_sleep_until_ns(fresh_ns);
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_poll_sensors(&ctx, 0xFF, cfg, raw, read_ns, &done, &cached));
+    TEST_ASSERT_EQUAL_HEX64(0xFF, done);
+    TEST_ASSERT_EQUAL_HEX64(0, cached);
+    TEST_ASSERT_TRUE(read_ns[0] >= fresh_ns);
+}
+
+void test_poll_after_reconfig_does_not_wait(void) {
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    uint64_t cached = 0;
+
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    uint16_t old_conf = ctx.conf[0];
+    for (int ch = 0; ch < SWEEP_NUM_CHANNELS; ch++) {
+        cfg[ch].it_ms = 2 * TEST_IT_MS;
+    }
+
+    /* The new CONF is written, the previous sample comes back at once */
+    uint64_t start_ns = sweep_now_ns();
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_poll_sensors(&ctx, 0xFF, cfg, raw, NULL, &done, &cached));
+    TEST_ASSERT_TRUE(sweep_now_ns() - start_ns < 10000000ull);
+    TEST_ASSERT_EQUAL_HEX64(0xFF, cached);
+    TEST_ASSERT_EQUAL_HEX16(old_conf, ctx.sample_conf[0]);
+    TEST_ASSERT_TRUE(ctx.conf[0] != old_conf);
+    TEST_ASSERT_EQUAL_UINT64(ctx.applied_ns[0] + ctx.period_ns[0], sweep_fresh_ns(&ctx, 0));
+
+    /* A blocking read only waits for what is left of the new cycle */
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    uint64_t elapsed_ns = sweep_now_ns() - start_ns;
+    TEST_ASSERT_TRUE(elapsed_ns >= ctx.period_ns[0]);
+    TEST_ASSERT_TRUE(elapsed_ns < ctx.period_ns[0] + 20000000ull);
+    TEST_ASSERT_EQUAL_HEX16(ctx.conf[0], ctx.sample_conf[0]);
+}
+
+void test_poll_waits_without_sample(void) {
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    uint64_t cached = 0;
+
+    /* Nothing to fall back on: the first read waits for valid data */
+    uint64_t start_ns = sweep_now_ns();
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_poll_sensors(&ctx, 0xFF, cfg, raw, NULL, &done, &cached));
+    TEST_ASSERT_TRUE(sweep_now_ns() - start_ns >= (uint64_t)(TEST_IT_MS * 1000000.0f));
+    TEST_ASSERT_EQUAL_HEX64(0xFF, done);
+    TEST_ASSERT_EQUAL_HEX64(0, cached);
+    TEST_ASSERT_EQUAL_UINT16(100, raw[0].clear);
+}
+
+void test_breaker_isolates_failing_sensor(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    i2c_sim_stats_t stats;
+    open_sim("sim:present=0xF7");       // nothing on channel 3
+
+    for (int n = 0; n < SWEEP_TRIP_AFTER; n++) {
+        TEST_ASSERT_EQUAL_HEX64(0, ctx.tripped);
+        TEST_ASSERT_EQUAL_INT(0xF7, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    }
+    TEST_ASSERT_EQUAL_HEX64(0x08, ctx.tripped);
+
+    /* Left out: the other sensors are read without a single NACK */
+    i2c_sim_reset_stats(fd);
+    TEST_ASSERT_EQUAL_INT(0xF7, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+    TEST_ASSERT_EQUAL_UINT64(0, stats.nacks);
+}
+
+void test_breaker_reprobes_and_recovers(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    open_sim("sim:present=0xF7");
+    sweep_set_breaker(&ctx, 1, 10000000ull, 40000000ull);
+
+    TEST_ASSERT_EQUAL_INT(0xF7, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0x08, ctx.tripped);
+
+    /* A failed probe doubles the interval */
+    sweep_sleep_until_ns(ctx.probe_at_ns[3]);
+    TEST_ASSERT_EQUAL_INT(0xF7, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0x08, ctx.tripped);
+    TEST_ASSERT_EQUAL_UINT64(20000000ull, ctx.probe_wait_ns[3]);
+
+    /* The sensor comes back: the probe readmits it, the next sweep reads it */
+    i2c_sim_config_t sim;
+    i2c_sim_default_config(&sim);
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_configure(fd, &sim));
+    sweep_sleep_until_ns(ctx.probe_at_ns[3]);
+    TEST_ASSERT_EQUAL_INT(0xF7, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_HEX64(0, ctx.tripped);
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+}
+
+void test_retries_ride_out_transient_nacks(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    i2c_sim_stats_t stats;
+    open_sim("sim:nack=0.3,seed=7");
+    TEST_ASSERT_EQUAL_INT(0, i2c_bus_set_retry(fd, 6, 10));
+
+    for (int n = 0; n < 5; n++) {
+        TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    }
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+    TEST_ASSERT_TRUE(stats.nacks > 0);
+    TEST_ASSERT_EQUAL_HEX64(0, ctx.tripped);
+}
+
+void test_sweep_records_latencies(void) {
+    veml3328_raw_data_t raw[SWEEP_NUM_CHANNELS];
+    metrics_snapshot_t snap;
+    metrics_reset();
+
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+    TEST_ASSERT_EQUAL_INT(0xFF, sweep_run(&ctx, 0xFF, cfg, raw, NULL));
+
+    /* One sample per sweep, integration wait included */
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_SWEEP, &snap));
+    TEST_ASSERT_EQUAL_UINT64(2, snap.count);
+    TEST_ASSERT_TRUE(snap.max_ns >= (uint64_t)(TEST_IT_MS * 1000000.0f));
+
+    /* The broadcast CONF write routed every channel at once */
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_MUX_SELECT, &snap));
+    TEST_ASSERT_TRUE(snap.count >= 1);
+
+    /* The simulated bus takes combined transactions: reads are compiled */
+    TEST_ASSERT_EQUAL_INT(0, metrics_snapshot(METRIC_I2C_TRANSFER, &snap));
+    TEST_ASSERT_TRUE(snap.count >= 2);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_sweep_reads_all_channels);
+    RUN_TEST(test_sweep_pipelined_waits_once);
+    RUN_TEST(test_sweep_broadcasts_shared_config);
+    RUN_TEST(test_sweep_repeat_skips_config);
+    RUN_TEST(test_sweep_absent_sensor);
+    RUN_TEST(test_sweep_bus_errors);
+    RUN_TEST(test_multi_mux_reads_every_sensor);
+    RUN_TEST(test_multi_mux_minimal_switching);
+    RUN_TEST(test_multi_mux_broadcast_config);
+    RUN_TEST(test_poll_serves_cached_until_fresh);
+    RUN_TEST(test_poll_after_reconfig_does_not_wait);
+    RUN_TEST(test_poll_waits_without_sample);
+    RUN_TEST(test_breaker_isolates_failing_sensor);
+    RUN_TEST(test_breaker_reprobes_and_recovers);
+    RUN_TEST(test_retries_ride_out_transient_nacks);
+    RUN_TEST(test_sweep_records_latencies);
+    RUN_TEST(test_driver_rejects_unregistered_fd);
+    RUN_TEST(test_apply_cfg_rejects_bad_sensor);
+    RUN_TEST(test_sim_rejects_bad_path);
+
+    return UNITY_END();
+}
@@ -0,0 +1,210 @@
+#include "unity.h"
+#include "../src/i2c_driver_pi.h"
+#include "../src/i2c_sim.h"
+#include "../src/sweep_prog.h"
+#include <stdint.h>
+#include <string.h>
+
+/* Compiled sweeps against the simulated bus: batching, decoding and fallback */
+#define MUX_ADDR    0x70
+
+static const veml3328_cfg_t test_cfg = {
+    .gain_factor = 1.0f,
+    .dg_factor   = 1.0f,
+    .sens_factor = 0.0f,
+    .it_ms       = 50.0f,
+    .ds_it_ms    = 100.0f,
+    .dark_offset = 0
+};
+
+static int fd = -1;
+static sweep_ctx_t ctx;
+static sweep_prog_t prog;
+static const uint8_t order8[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+/* Open 'path' and configure all of its sensors with a classic sweep */
+static void open_sim(const char *path, uint64_t mask) {
+    veml3328_cfg_t cfg[SWEEP_MAX_SENSORS];
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done;
+    for (int i = 0; i < SWEEP_MAX_SENSORS; i++) {
+        cfg[i] = test_cfg;
+    }
+
+    if (fd >= 0) {
+        i2c_close_bus(fd);
+    }
+    fd = i2c_open_bus(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    topo_t topo;
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_from_spec(&topo, fd, "auto"));
+    sweep_init_topology(&ctx, fd, &topo, VEML3328_I2C_ADDR);
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_run_sensors(&ctx, mask, cfg, raw, NULL, &done));
+    i2c_sim_reset_stats(fd);
+}
+
+void setUp(void) {
+    open_sim("sim:", 0xFF);
+}
+
+void tearDown(void) {
+    i2c_close_bus(fd);
+    fd = -1;
+}
+
+/* Tests */
+void test_build_rejects_bad_arguments(void) {
+    uint8_t bad[1] = {8};               // one mux: sensors 0..7 only
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_ERR, sweep_prog_build(NULL, &ctx, order8, 8));
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_ERR, sweep_prog_build(&prog, &ctx, order8, SWEEP_MAX_SENSORS + 1));
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_ERR, sweep_prog_build(&prog, &ctx, bad, 1));
+}
+
+void test_batches_end_at_mux_writes(void) {
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_OK, sweep_prog_build(&prog, &ctx, order8, 8));
+
+    /* The select of sensor 0, then each sensor's reads followed by the
+       select of the next: no read ever follows a mux write in a batch */
+    TEST_ASSERT_EQUAL_INT(9, prog.num_batches);
+    int msgs = 0;
+    for (int b = 0; b < prog.num_batches; b++) {
+        const sweep_prog_batch_t *batch = &prog.batch[b];
+        TEST_ASSERT_TRUE(batch->num_msgs <= I2C_MAX_MSGS);
+        int switched = 0;
+        for (int i = batch->first_msg; i < batch->first_msg + batch->num_msgs; i++) {
+            if (prog.msgs[i].addr == MUX_ADDR) {
+                switched = 1;
+            } else {
+                TEST_ASSERT_FALSE(switched);
+            }
+        }
+        TEST_ASSERT_EQUAL_INT(b < 8, batch->switches);
+        msgs += batch->num_msgs;
+    }
+    TEST_ASSERT_EQUAL_INT(prog.num_msgs, msgs);
+
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    i2c_sim_stats_t stats;
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_prog_run(&prog, &ctx, raw, NULL, &done));
+    TEST_ASSERT_EQUAL_HEX64(0xFF, done);
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+    TEST_ASSERT_EQUAL_UINT64(9, stats.transfers);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.nacks);
+}
+
+void test_sim_switches_mux_at_stop(void) {
+    uint8_t reg = VEML3328_REG_clear;
+    uint8_t rx[2] = {0};
+    uint8_t control = tca_encode_channel(2);
+    i2c_xfer_msg_t msgs[3] = {
+        { MUX_ADDR, 0, 1, &control },
+        { VEML3328_I2C_ADDR, 0, 1, &reg },
+        { VEML3328_I2C_ADDR, I2C_XFER_RD, 2, rx },
+    };
+
+    /* Nothing routed: the read NACKs although the write came first */
+    TEST_ASSERT_EQUAL_INT(0, tca_disable_all(fd, MUX_ADDR));
+    TEST_ASSERT_TRUE(i2c_transfer(fd, msgs, 3) != 0);
+
+    /* The STOP ending the failed transfer still switched the mux */
+    uint8_t routed = 0;
+    TEST_ASSERT_EQUAL_INT(0, tca_read_control(fd, MUX_ADDR, &routed));
+    TEST_ASSERT_EQUAL_HEX8(tca_encode_channel(2), routed);
+
+    /* Channel 2 routed, write to channel 6: the read still gets channel 2 */
+    veml3328_raw_data_t ch2;
+    TEST_ASSERT_EQUAL_INT(VEML3328_OK, veml3328_read_all(fd, VEML3328_I2C_ADDR, &ch2));
+    control = tca_encode_channel(6);
+    TEST_ASSERT_EQUAL_INT(0, i2c_transfer(fd, msgs, 3));
+    TEST_ASSERT_EQUAL_UINT16(ch2.clear, (uint16_t)(rx[0] | (rx[1] << 8)));
+    TEST_ASSERT_EQUAL_INT(0, tca_read_control(fd, MUX_ADDR, &routed));
+    TEST_ASSERT_EQUAL_HEX8(tca_encode_channel(6), routed);
+}
+
+void test_decodes_like_single_reads(void) {
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t read_ns[SWEEP_MAX_SENSORS] = {0};
+    uint64_t done = 0;
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_OK, sweep_prog_build(&prog, &ctx, order8, 8));
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_prog_run(&prog, &ctx, raw, read_ns, &done));
+
+    /* The sensors hold the same latched cycle for a single read */
+    for (int i = 0; i < 8; i++) {
+        veml3328_raw_data_t single;
+        TEST_ASSERT_EQUAL_INT(TCA_OK, sweep_select_channel(&ctx, i));
+        TEST_ASSERT_EQUAL_INT(VEML3328_OK, veml3328_read_all(fd, VEML3328_I2C_ADDR, &single));
+        TEST_ASSERT_EQUAL_MEMORY(&single, &raw[i], sizeof(single));
+        TEST_ASSERT_TRUE(read_ns[i] != 0);
+    }
+}
+
+void test_absent_sensor_only_loses_itself(void) {
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    open_sim("sim:present=0xF7", 0xFF);     // nothing on channel 3
+
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_OK, sweep_prog_build(&prog, &ctx, order8, 8));
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_prog_run(&prog, &ctx, raw, NULL, &done));
+    TEST_ASSERT_EQUAL_HEX64(0xF7, done);
+    TEST_ASSERT_FALSE(ctx.conf_valid & (1ull << 3));
+
+    /* 9 batches; the failed one (reads of 3, select of 4) is redone as
+       a select + a read of sensor 3, then a select of sensor 4 */
+    i2c_sim_stats_t stats;
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+    TEST_ASSERT_EQUAL_UINT64(9 + 2 + 1, stats.transfers);
+}
+
+void test_stale_program_is_not_run(void) {
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS];
+    uint64_t done = 0;
+    TEST_ASSERT_EQUAL_INT(TCA_OK, sweep_select_channel(&ctx, 0));
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_OK, sweep_prog_build(&prog, &ctx, order8 + 1, 7));
+
+    /* Someone else moved the mux after the program was built */
+    TEST_ASSERT_EQUAL_INT(TCA_OK, sweep_select_channel(&ctx, 5));
+    i2c_sim_reset_stats(fd);
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_ERR_STALE, sweep_prog_run(&prog, &ctx, raw, NULL, &done));
+
+    i2c_sim_stats_t stats;
+    TEST_ASSERT_EQUAL_INT(0, i2c_sim_get_stats(fd, &stats));
+    TEST_ASSERT_EQUAL_UINT64(0, stats.transfers);
+}
+
+void test_multi_mux_routes_each_sensor(void) {
+    veml3328_raw_data_t raw[SWEEP_MAX_SENSORS] = {0};
+    uint64_t done = 0;
+    uint8_t order[16];
+    open_sim("sim:muxes=2", 0xFFFF);
+    for (int k = 0; k < 16; k++) {
+        order[k] = (uint8_t)(15 - k);
+    }
+
+    TEST_ASSERT_EQUAL_INT(SWEEP_PROG_OK, sweep_prog_build(&prog, &ctx, order, 16));
+    TEST_ASSERT_EQUAL_INT(SWEEP_OK, sweep_prog_run(&prog, &ctx, raw, NULL, &done));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFF, done);
+
+    /* The second mux sees 10% more light: a mix of both would read less */
+    TEST_ASSERT_EQUAL_UINT16(100, raw[0].clear);
+    TEST_ASSERT_EQUAL_UINT16(110, raw[8].clear);
+
+    /* The cache follows the last batch: 0x70 channel 0 routed, 0x71 off */
+    TEST_ASSERT_EQUAL_HEX8(0x01, ctx.mux[0].control);
+    TEST_ASSERT_EQUAL_HEX8(0x00, ctx.mux[1].control);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_build_rejects_bad_arguments);
+    RUN_TEST(test_batches_end_at_mux_writes);
+    RUN_TEST(test_sim_switches_mux_at_stop);
+    RUN_TEST(test_decodes_like_single_reads);
+    RUN_TEST(test_absent_sensor_only_loses_itself);
+    RUN_TEST(test_stale_program_is_not_run);
+    RUN_TEST(test_multi_mux_routes_each_sensor);
+
+    return UNITY_END();
+}
@@ -7,11 +7,13 @@ static int dummy_i2c_fd;
 static uint8_t dummy_last_dev_addr;
 static uint8_t dummy_last_data;
 static int dummy_fail_write;
+static int dummy_write_count;
 
 int i2c_write_byte(int i2c_fd, uint8_t dev_addr_7bit, uint8_t data) {
     dummy_i2c_fd = i2c_fd;
     dummy_last_dev_addr = dev_addr_7bit;
     dummy_last_data = data;
+    dummy_write_count++;
     if (dummy_fail_write) {
         return -1;  // Simulate failure
     }
@@ -37,7 +39,8 @@ void setUp(void) {
     dummy_last_dev_addr = 0;
     dummy_last_data     = 0;
     dummy_fail_write    = 0;
-    
+    dummy_write_count   = 0;
+
 }
 
 void tearDown(void) {}
@@ -99,6 +102,70 @@ void test_tca_read_control_null(void) {
     TEST_ASSERT_EQUAL_INT(TCA_ERR_I2C_READ, ret);
 }
 
+void test_select_mask(void) {
+    int ret = tca_select_mask(3, 0x70, 0xFF);
+    TEST_ASSERT_EQUAL_INT(TCA_OK, ret);
+    TEST_ASSERT_EQUAL_HEX8(0xFF, dummy_last_data);
+}
+
+void test_handle_elides_redundant_writes(void) {
+    tca9548a_t tca;
+    tca_handle_init(&tca, 5, 0x70);
+
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_select_channel(&tca, 3));
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_select_channel(&tca, 3));
+    TEST_ASSERT_EQUAL_INT(1, dummy_write_count);
+    TEST_ASSERT_EQUAL_HEX8(0x08, dummy_last_data);
+
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_select_channel(&tca, 4));
+    TEST_ASSERT_EQUAL_INT(2, dummy_write_count);
+    TEST_ASSERT_EQUAL_HEX8(0x10, dummy_last_data);
+
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_disable_all(&tca));
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_disable_all(&tca));
+    TEST_ASSERT_EQUAL_INT(3, dummy_write_count);
+}
+
+void test_handle_first_write_not_elided(void) {
+    tca9548a_t tca;
+    tca_handle_init(&tca, 5, 0x70);
+
+    /* Power-on state is unknown, so disabling must still hit the bus */
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_disable_all(&tca));
+    TEST_ASSERT_EQUAL_INT(1, dummy_write_count);
+}
+
+void test_handle_mask_select(void) {
+    tca9548a_t tca;
+    tca_handle_init(&tca, 5, 0x71);
+
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_select_mask(&tca, 0xA5));
+    TEST_ASSERT_EQUAL_HEX8(0x71, dummy_last_dev_addr);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, dummy_last_data);
+    TEST_ASSERT_EQUAL_HEX8(0xA5, tca.control);
+}
+
+void test_handle_failure_invalidates(void) {
+    tca9548a_t tca;
+    tca_handle_init(&tca, 5, 0x70);
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_select_channel(&tca, 1));
+
+    dummy_fail_write = 1;
+    TEST_ASSERT_EQUAL_INT(TCA_ERR_I2C_WRITE, tca_handle_select_channel(&tca, 2));
+
+    /* The retry of the previous routing must be written again */
+    dummy_fail_write = 0;
+    dummy_write_count = 0;
+    TEST_ASSERT_EQUAL_INT(TCA_OK, tca_handle_select_channel(&tca, 1));
+    TEST_ASSERT_EQUAL_INT(1, dummy_write_count);
+}
+
+void test_handle_invalid_channel(void) {
+    tca9548a_t tca;
+    tca_handle_init(&tca, 5, 0x70);
+    TEST_ASSERT_EQUAL_INT(TCA_INVALID_CHANNEL, tca_handle_select_channel(&tca, 8));
+    TEST_ASSERT_EQUAL_INT(0, dummy_write_count);
+}
 
 int main(void) {
     UNITY_BEGIN();
@@ -110,6 +177,12 @@ int main(void) {
     RUN_TEST(test_i2c_write_failure);
     RUN_TEST(test_tca_read_control_ok);
     RUN_TEST(test_tca_read_control_null);
+    RUN_TEST(test_select_mask);
+    RUN_TEST(test_handle_elides_redundant_writes);
+    RUN_TEST(test_handle_first_write_not_elided);
+    RUN_TEST(test_handle_mask_select);
+    RUN_TEST(test_handle_failure_invalidates);
+    RUN_TEST(test_handle_invalid_channel);
 
 
     return UNITY_END();
@@ -0,0 +1,140 @@
+#include "unity.h"
+#include "../src/topology.h"
+#include <stdint.h>
+
+/* Dummy functions for i2c backend tests: muxes answer at the addresses in dummy_present */
+static uint8_t dummy_present;       // bit n set: mux at 0x70 + n answers
+
+int i2c_write_byte(int i2c_fd, uint8_t dev_addr_7bit, uint8_t data) {
+    (void)i2c_fd;
+    (void)dev_addr_7bit;
+    (void)data;
+    return 0;
+}
+
+int i2c_read_byte(int i2c_fd, uint8_t dev_addr_7bit, uint8_t *out) {
+    (void)i2c_fd;
+    if (out == NULL || dev_addr_7bit < 0x70 || dev_addr_7bit > 0x77) {
+        return -1;
+    }
+    *out = 0;
+    return (dummy_present & (1u << (dev_addr_7bit - 0x70))) ? 0 : -1;
+}
+
+void setUp(void) {
+    dummy_present = 0;
+}
+
+void tearDown(void) {}
+
+/* Tests */
+void test_init_sorts_addresses(void) {
+    topo_t topo;
+    const uint8_t addrs[] = { 0x74, 0x70, 0x72 };
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_init(&topo, addrs, 3));
+    TEST_ASSERT_EQUAL_INT(3, topo.num_muxes);
+    TEST_ASSERT_EQUAL_HEX8(0x70, topo.mux_addr[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x72, topo.mux_addr[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x74, topo.mux_addr[2]);
+    TEST_ASSERT_EQUAL_INT(24, topo_num_sensors(&topo));
+}
+
+void test_init_rejects_invalid(void) {
+    topo_t topo;
+    const uint8_t duplicate[] = { 0x71, 0x71 };
+    const uint8_t out_of_range[] = { 0x78 };
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_INVALID, topo_init(&topo, duplicate, 2));
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_INVALID, topo_init(&topo, out_of_range, 1));
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_INVALID, topo_init(&topo, duplicate, 0));
+}
+
+void test_from_spec(void) {
+    topo_t topo;
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_from_spec(&topo, 3, NULL));
+    TEST_ASSERT_EQUAL_INT(1, topo.num_muxes);
+    TEST_ASSERT_EQUAL_HEX8(TCA_ADDRESS_BASE, topo.mux_addr[0]);
+
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_from_spec(&topo, 3, "0x71,0x77"));
+    TEST_ASSERT_EQUAL_INT(2, topo.num_muxes);
+    TEST_ASSERT_EQUAL_HEX8(0x77, topo.mux_addr[1]);
+
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_INVALID, topo_from_spec(&topo, 3, "0x71;0x72"));
+}
+
+void test_discover(void) {
+    topo_t topo;
+    dummy_present = 0x89;       // 0x70, 0x73, 0x77
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_from_spec(&topo, 3, "auto"));
+    TEST_ASSERT_EQUAL_INT(3, topo.num_muxes);
+    TEST_ASSERT_EQUAL_HEX8(0x73, topo.mux_addr[1]);
+
+    dummy_present = 0;
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_NOT_FOUND, topo_discover(&topo, 3));
+}
+
+void test_sensor_mapping(void) {
+    topo_t topo;
+    const uint8_t addrs[] = { 0x70, 0x75 };
+    topo_init(&topo, addrs, 2);
+
+    TEST_ASSERT_EQUAL_INT(13, topo_sensor_index(&topo, 0x75, 5));
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_NOT_FOUND, topo_sensor_index(&topo, 0x71, 0));
+
+    uint8_t mux;
+    int channel;
+    TEST_ASSERT_EQUAL_INT(TOPO_OK, topo_sensor_location(&topo, 13, &mux, &channel));
+    TEST_ASSERT_EQUAL_HEX8(0x75, mux);
+    TEST_ASSERT_EQUAL_INT(5, channel);
+    TEST_ASSERT_EQUAL_INT(TOPO_ERR_NOT_FOUND, topo_sensor_location(&topo, 16, &mux, &channel));
+    TEST_ASSERT_EQUAL_HEX64(0xFFFF, topo_all_sensors(&topo));
+}
+
+void test_schedule_groups_by_mux(void) {
+    topo_t topo;
+    const uint8_t addrs[] = { 0x70, 0x71, 0x72 };
+    topo_init(&topo, addrs, 3);
+
+    uint8_t order[TOPO_MAX_SENSORS];
+    uint64_t mask = (1ull << 17) | (1ull << 2) | (1ull << 9) | (1ull << 0) | (1ull << 10);
+    TEST_ASSERT_EQUAL_INT(5, topo_schedule(&topo, mask, -1, order));
+    const uint8_t expected[] = { 0, 2, 9, 10, 17 };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, order, 5);
+}
+
+void test_schedule_starts_at_routed_sensor(void) {
+    topo_t topo;
+    const uint8_t addrs[] = { 0x70, 0x71 };
+    topo_init(&topo, addrs, 2);
+
+    /* Sensor 12 (0x71 channel 4) is still routed from the previous sweep */
+    uint8_t order[TOPO_MAX_SENSORS];
+    uint64_t mask = (1ull << 1) | (1ull << 8) | (1ull << 12);
+    TEST_ASSERT_EQUAL_INT(3, topo_schedule(&topo, mask, 12, order));
+    const uint8_t expected[] = { 12, 8, 1 };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, order, 3);
+}
+
+void test_schedule_ignores_sensors_outside_topology(void) {
+    topo_t topo;
+    const uint8_t addr = 0x70;
+    topo_init(&topo, &addr, 1);
+
+    uint8_t order[TOPO_MAX_SENSORS];
+    TEST_ASSERT_EQUAL_INT(1, topo_schedule(&topo, (1ull << 3) | (1ull << 40), 40, order));
+    TEST_ASSERT_EQUAL_UINT8(3, order[0]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_init_sorts_addresses);
+    RUN_TEST(test_init_rejects_invalid);
+    RUN_TEST(test_from_spec);
+    RUN_TEST(test_discover);
+    RUN_TEST(test_sensor_mapping);
+    RUN_TEST(test_schedule_groups_by_mux);
+    RUN_TEST(test_schedule_starts_at_routed_sensor);
+    RUN_TEST(test_schedule_ignores_sensors_outside_topology);
+
+    return UNITY_END();
+}
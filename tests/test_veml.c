@@ -10,6 +10,7 @@ static uint8_t dummy_written_buf[8];
 static int dummy_written_length;
 static uint8_t dummy_read_buf[8];
 static int dummy_fail = 0;
+static int dummy_read_regs_calls = 0;
 
 int i2c_write_bytes(int fd, uint8_t addr, const uint8_t *buf, int length) {
     if (dummy_fail) {
@@ -50,6 +51,24 @@ int i2c_write_read(int fd, uint8_t dev_addr, const uint8_t *wbuf, int wlen, uint
     }
 }
 
+int i2c_read_regs(int fd, uint8_t dev_addr, const uint8_t *regs, int num_regs, uint8_t *rbuf, int reg_length) {
+    (void)fd;
+    (void)dev_addr;
+
+    dummy_read_regs_calls++;
+    if (!regs || num_regs <= 0 || !rbuf || reg_length != 2) {
+        return -1;
+    }
+
+    for (int i = 0; i < num_regs; i++) {
+        uint16_t val = dummy_reg_values[regs[i]];
+        rbuf[2 * i]     = (uint8_t)(val & 0xFF);
+        rbuf[2 * i + 1] = (uint8_t)(val >> 8);
+    }
+
+    return dummy_fail ? -1 : 0;
+}
+
 
 /* Test Functions */
 void test_write_reg (void) {
@@ -88,6 +107,27 @@ void test_read_raw (void) {
     TEST_ASSERT_EQUAL_UINT16(50, data.blue);
 }
 
+void test_read_raw_single_transaction (void) {
+    dummy_reg_values[VEML3328_REG_clear] = 0x1234;
+    dummy_reg_values[VEML3328_REG_BLUE]  = 0xBEEF;
+
+    veml3328_raw_data_t data;
+    int ret = veml3328_read_all(0, VEML3328_I2C_ADDR, &data);
+    TEST_ASSERT_EQUAL_INT(VEML3328_OK, ret);
+
+    TEST_ASSERT_EQUAL_INT(1, dummy_read_regs_calls);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, data.clear);
+    TEST_ASSERT_EQUAL_HEX16(0xBEEF, data.blue);
+}
+
+void test_read_raw_failure (void) {
+    dummy_fail = 1;
+
+    veml3328_raw_data_t data;
+    int ret = veml3328_read_all(0, VEML3328_I2C_ADDR, &data);
+    TEST_ASSERT_EQUAL_INT(VEML3328_ERR_I2C, ret);
+}
+
 void test_norm (void) {
     veml3328_raw_data_t raw = {
         .clear = 100,
@@ -120,6 +160,44 @@ void test_config (void) {
     TEST_ASSERT_EQUAL_HEX16(0x0000, (dummy_written_buf[1] | (dummy_written_buf[2] << 8))); // Config value
 }
 
+void test_encode_decode_roundtrip (void) {
+    veml3328_cfg_t cfg = {
+        .gain_factor = 4.0f,
+        .dg_factor   = 2.0f,
+        .sens_factor = 1.0f,
+        .it_ms       = 200.0f,
+        .ds_it_ms    = 100.0f,
+        .dark_offset = 7
+    };
+
+    veml3328_cfg_t out;
+    int ret = veml3328_decode_cfg(veml3328_encode_cfg(&cfg), 100.0f, 7, &out);
+    TEST_ASSERT_EQUAL_INT(VEML3328_OK, ret);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.0f, out.gain_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f, out.dg_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, out.sens_factor);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 200.0f, out.it_ms);
+    TEST_ASSERT_EQUAL_UINT16(7, out.dark_offset);
+}
+
+void test_cfg_exposure(void) {
+    veml3328_cfg_t cfg = {
+        .gain_factor = 4.0f,
+        .dg_factor   = 2.0f,
+        .sens_factor = 0.0f,
+        .it_ms       = 100.0f,
+        .ds_it_ms    = 100.0f,
+        .dark_offset = 0
+    };
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 800.0f, veml3328_cfg_exposure(&cfg));
+
+    /* Unsupported values snap like the CONF encoding does; low sensitivity is 1/3 */
+    cfg.it_ms = 300.0f;
+    cfg.sens_factor = 1.0f;
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 400.0f * 8.0f / 3.0f, veml3328_cfg_exposure(&cfg));
+}
+
 void test_wavelength_red_pure(void) {
     float wl = veml3328_estimate_wavelength(255, 0, 0);
     TEST_ASSERT_FLOAT_WITHIN(0.001f, VEML3328_WAVELENGTH_RED, wl);
@@ -154,6 +232,7 @@ void setUp(void) {
 
     dummy_written_length = 0;
     dummy_fail = 0;
+    dummy_read_regs_calls = 0;
     current_reg = 0;
 }
 
@@ -167,8 +246,12 @@ int main(void) {
     RUN_TEST(test_write_reg);
     RUN_TEST(test_read_reg);
     RUN_TEST(test_read_raw);
+    RUN_TEST(test_read_raw_single_transaction);
+    RUN_TEST(test_read_raw_failure);
     RUN_TEST(test_norm);
     RUN_TEST(test_config);
+    RUN_TEST(test_encode_decode_roundtrip);
+    RUN_TEST(test_cfg_exposure);
     RUN_TEST(test_wavelength_red_pure);
     RUN_TEST(test_wavelength_green_pure);
     RUN_TEST(test_wavelength_blue_pure);
@@ -0,0 +1,112 @@
+#include "unity.h"
+#include "../src/wire_frame.h"
+#include <stdint.h>
+#include <string.h>
+
+/* Binary wire format: layout, round trip and truncated input */
+static acq_frame_t frame;
+static uint8_t buf[WIRE_FRAME_MAX_SIZE * 2];
+
+void setUp(void) {
+    memset(&frame, 0, sizeof(frame));
+    memset(buf, 0xAA, sizeof(buf));
+
+    frame.seq = 0x0102030405060708ull;
+    frame.timestamp_ns = 123456789;
+    frame.wall_ns = 1700000000000000000ull;
+    frame.sensitivity = 1;
+    frame.channel_mask = 0x8000000000000005ull;         // sensors 0, 2 and 63
+    frame.valid_mask = 0x8000000000000001ull;           // sensor 2 failed
+    frame.spread_ns = 1500000;
+    for (int i = 0; i < ACQ_MAX_CHANNELS; i++) {
+        frame.conf[i] = (uint16_t)(0x4000 + i);
+        frame.raw[i] = (veml3328_raw_data_t){ (uint16_t)(1000 + i), (uint16_t)(2000 + i),
+                                              (uint16_t)(3000 + i), (uint16_t)(4000 + i) };
+    }
+}
+
+void tearDown(void) {}
+
+/* Tests */
+void test_size_counts_records(void) {
+    TEST_ASSERT_EQUAL_UINT(WIRE_FRAME_HEADER_SIZE, wire_frame_size(0));
+    TEST_ASSERT_EQUAL_UINT(WIRE_FRAME_HEADER_SIZE + 8 * WIRE_FRAME_RECORD_SIZE, wire_frame_size(0xFF));
+    TEST_ASSERT_EQUAL_UINT(WIRE_FRAME_MAX_SIZE, wire_frame_size(UINT64_MAX));
+}
+
+void test_encode_layout_is_little_endian(void) {
+    int n = wire_frame_encode(&frame, UINT64_MAX, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_HEADER_SIZE + 3 * WIRE_FRAME_RECORD_SIZE, n);
+
+    TEST_ASSERT_EQUAL_MEMORY("VMLF", buf, 4);
+    TEST_ASSERT_EQUAL_UINT8(WIRE_FRAME_VERSION, buf[4]);
+    TEST_ASSERT_EQUAL_UINT8(1, buf[5]);
+    TEST_ASSERT_EQUAL_UINT8(0x08, buf[8]);              // seq, low byte first
+    TEST_ASSERT_EQUAL_UINT8(0x01, buf[15]);
+    TEST_ASSERT_EQUAL_UINT8(0x80, buf[39]);             // channel_mask, sensor 63
+
+    /* Second record is sensor 2: failed, so zeroed */
+    const uint8_t *rec0 = buf + WIRE_FRAME_HEADER_SIZE;
+    const uint8_t *rec1 = rec0 + WIRE_FRAME_RECORD_SIZE;
+    TEST_ASSERT_EQUAL_UINT16(0x4000, rec0[0] | (rec0[1] << 8));
+    TEST_ASSERT_EQUAL_UINT16(1000, rec0[2] | (rec0[3] << 8));
+    for (int i = 0; i < WIRE_FRAME_RECORD_SIZE; i++) {
+        TEST_ASSERT_EQUAL_UINT8(0, rec1[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT8(0xAA, buf[n]);              // nothing written past the frame
+}
+
+void test_round_trip_of_selected_sensors(void) {
+    int n = wire_frame_encode(&frame, 0x8000000000000001ull, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_HEADER_SIZE + 2 * WIRE_FRAME_RECORD_SIZE, n);
+
+    acq_frame_t out;
+    TEST_ASSERT_EQUAL_INT(n, wire_frame_decode(buf, (size_t)n, &out));
+    TEST_ASSERT_EQUAL_UINT64(frame.seq, out.seq);
+    TEST_ASSERT_EQUAL_UINT64(frame.timestamp_ns, out.timestamp_ns);
+    TEST_ASSERT_EQUAL_UINT64(frame.wall_ns, out.wall_ns);
+    TEST_ASSERT_EQUAL_UINT32(frame.spread_ns, out.spread_ns);
+    TEST_ASSERT_EQUAL_UINT8(1, out.sensitivity);
+    TEST_ASSERT_EQUAL_HEX64(0x8000000000000001ull, out.channel_mask);
+    TEST_ASSERT_EQUAL_HEX64(0x8000000000000001ull, out.valid_mask);
+    TEST_ASSERT_EQUAL_UINT16(frame.conf[63], out.conf[63]);
+    TEST_ASSERT_EQUAL_MEMORY(&frame.raw[63], &out.raw[63], sizeof(veml3328_raw_data_t));
+    TEST_ASSERT_EQUAL_UINT16(0, out.raw[2].clear);      // not carried
+}
+
+void test_concatenated_frames_are_self_delimiting(void) {
+    int a = wire_frame_encode(&frame, 0x1, buf, sizeof(buf));
+    frame.seq++;
+    int b = wire_frame_encode(&frame, UINT64_MAX, buf + a, sizeof(buf) - (size_t)a);
+    TEST_ASSERT_GREATER_THAN(0, b);
+
+    acq_frame_t out;
+    TEST_ASSERT_EQUAL_INT(a, wire_frame_decode(buf, (size_t)(a + b), &out));
+    TEST_ASSERT_EQUAL_INT(b, wire_frame_decode(buf + a, (size_t)b, &out));
+    TEST_ASSERT_EQUAL_UINT64(frame.seq, out.seq);
+}
+
+void test_short_or_foreign_buffers_are_rejected(void) {
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_ERR, wire_frame_encode(&frame, UINT64_MAX, buf, WIRE_FRAME_HEADER_SIZE));
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_ERR, wire_frame_encode(NULL, UINT64_MAX, buf, sizeof(buf)));
+
+    int n = wire_frame_encode(&frame, UINT64_MAX, buf, sizeof(buf));
+    acq_frame_t out;
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_ERR, wire_frame_decode(buf, (size_t)n - 1, &out));
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_ERR, wire_frame_decode(buf, 10, &out));
+
+    buf[0] = 'X';
+    TEST_ASSERT_EQUAL_INT(WIRE_FRAME_ERR_FORMAT, wire_frame_decode(buf, (size_t)n, &out));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_size_counts_records);
+    RUN_TEST(test_encode_layout_is_little_endian);
+    RUN_TEST(test_round_trip_of_selected_sensors);
+    RUN_TEST(test_concatenated_frames_are_self_delimiting);
+    RUN_TEST(test_short_or_foreign_buffers_are_rejected);
+
+    return UNITY_END();
+}